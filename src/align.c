@@ -33,64 +33,289 @@
 
 #include "common.h"
 #include "xrandr-align.h"
+#include "profile.h"
+#include "transform.h"
+#include "trace.h"
+#include "target.h"
 #include <string.h>
 #include <X11/extensions/Xrandr.h>
 
+/* Looks up the IDs of the named (or numbered) input devices in a
+   single device list */
 int
-align (Display *display,
-       int argc,
-       const char *argv[],
-       const char *funcname,
-       const char *usage)
+find_inputs (Display *display,
+	     int xi2,
+	     const char **names,
+	     int count,
+	     XID *ids)
 {
-  RROutput outputid;
-  XRROutputInfo *output;
+  int ret = EXIT_SUCCESS;
+  int i;
+
+#if HAVE_XI2
+  if (xi2) {
+    XIDeviceInfo *info;
+    int ndevices;
+
+    XPROF (display, "XIQueryDevice",
+	   info = XIQueryDevice (display, XIAllDevices, &ndevices));
+    for (i = 0; i < count && ret != EXIT_FAILURE; i++) {
+      XIDeviceInfo *dev = xi2_find_device_in_list (info, ndevices, names[i]);
+      if (dev) {
+	ids[i] = dev->deviceid;
+      } else {
+	fprintf (stderr, "unable to find device %s\n", names[i]);
+	ret = EXIT_FAILURE;
+      }
+    }
+    XIFreeDeviceInfo (info);
+  } else
+#endif
+  {
+    XDeviceInfo *devices;
+    int ndevices;
+
+    XPROF (display, "XListInputDevices",
+	   devices = XListInputDevices (display, &ndevices));
+    for (i = 0; i < count && ret != EXIT_FAILURE; i++) {
+      XDeviceInfo *dev = find_device_in_list (devices, ndevices, names[i], False, 0, 0, False);
+      if (dev) {
+	ids[i] = dev->id;
+      } else {
+	fprintf (stderr, "unable to find device %s\n", names[i]);
+	ret = EXIT_FAILURE;
+      }
+    }
+    XFreeDeviceList (devices);
+  }
+
+  return ret;
+}
+
+static void
+print_matrix (const char *input_name,
+	      const float matrix[9])
+{
+  int i;
+
+  fprintf (stderr, "Debug: set-float-prop %s Coordinate Transformation Matrix", input_name);
+  for (i = 0; i < 9; i++) {
+    fprintf (stderr, " %8.6f", matrix[i]);
+  }
+  fprintf (stderr, "\n");
+}
+
+/* Runs each distinct pre- or post-script of the bindings once */
+static int
+run_binding_scripts (binding *bindings,
+		     int count,
+		     int post)
+{
+  int i, j;
+
+  for (i = 0; i < count; i++) {
+    const char *script = post ? bindings[i].post_script : bindings[i].pre_script;
+    for (j = 0; j < i; j++) {
+      if (strcmp (script, post ? bindings[j].post_script : bindings[j].pre_script) == 0) {
+	break;
+      }
+    }
+    if (j == i && run_script (script) == EXIT_FAILURE) {
+      return EXIT_FAILURE;
+    }
+  }
+
+  return EXIT_SUCCESS;
+}
+
+/* Aligns all the given bindings with the screen configuration of the
+   cache (refreshed if it is dirty) and the input device list fetched
+   once. The matrices
+   are written back-to-back under a single server grab. The results
+   are stored to retals if it is given (the CRTC of a disabled output
+   is left 0), the resolved targets to rettargets (left empty from
+   the first one that failed). */
+int
+align_bindings (context *ctx,
+		screen_cache *sc,
+		binding *bindings,
+		int count,
+		alignment *retals,
+		target *rettargets)
+{
+  Display *display = ctx->display;
+  const char **names;
+  alignment *als;
+  target *targets;
+  RRCrtc *crtcs;
+  XID *ids;
   int ret;
-  const char *inputarg;
-  int screen;
-  const char *pre_script;
-  const char *post_script;
+  int i, j;
 
-  ret = get_screen (display, argc, argv, funcname, usage, &screen);
-  if (ret == EXIT_FAILURE) {
-    return ret;
+  screen_refresh (display, sc);
+  names = calloc (count, sizeof (const char *));
+  if (retals) {
+    als = retals;
+    memset (als, 0, count * sizeof (alignment));
+  } else {
+    als = calloc (count, sizeof (alignment));
   }
+  if (rettargets) {
+    targets = rettargets;
+    memset (targets, 0, count * sizeof (target));
+  } else {
+    targets = calloc (count, sizeof (target));
+  }
+  crtcs = calloc (count, sizeof (RRCrtc));
+  ids = calloc (count, sizeof (XID));
 
-  ret = get_argval (argc, argv, "input", funcname, usage, "Virtual core pointer", &inputarg);
-  if (ret == EXIT_FAILURE) {
-    return ret;
+  for (i = 0; i < count; i++) {
+    names[i] = bindings[i].input;
   }
+  ret = find_inputs (display, ctx->conn.xi2, names, count, ids);
 
-  ret = get_output (display, argc, argv, funcname, usage, &outputid, &output);
-  if (ret == EXIT_FAILURE) {
-    return ret;
+  for (i = 0; i < count && ret != EXIT_FAILURE; i++) {
+    const char *outname = strlen (bindings[i].output) ? bindings[i].output : "(primary)";
+
+    if (target_find (display, sc->root, sc->res, sc->infos, bindings[i].output, &targets[i]) == EXIT_FAILURE) {
+      memset (&targets[i], 0, sizeof (target));
+      ret = EXIT_FAILURE;
+      break;
+    }
+
+    if (ctx->verbose) {
+      fprintf (stderr, "Output: %s, input: %s\n", outname, bindings[i].input);
+    }
+
+    crtcs[i] = target_crtc (&targets[i]);
+    if (!crtcs[i]) {
+      fprintf (stderr, "Output %s is disabled: skip it\n", outname);
+      continue;
+    }
+
+    /* The single outputs sharing a CRTC share the matrix */
+    for (j = 0; j < i; j++) {
+      if (crtcs[j] == crtcs[i] &&
+	  target_is_single (&targets[j]) && target_is_single (&targets[i])) {
+	break;
+      }
+    }
+    if (j < i) {
+      als[i] = als[j];
+    } else {
+      ret = compute_target_transform (ctx, sc, &targets[i], &als[i]);
+    }
+  }
+
+  if (ret != EXIT_FAILURE) {
+    ret = run_binding_scripts (bindings, count, 0);
+  }
+
+  if (ret != EXIT_FAILURE) {
+    Atom prop = ctx->conn.matrix_atom;
+
+    XPROF (display, "XGrabServer", XGrabServer (display));
+    for (i = 0; i < count && ret != EXIT_FAILURE; i++) {
+      if (crtcs[i]) {
+	als[i].deviceid = ids[i];
+	correct_matrix (ctx, bindings[i].input, als[i].matrix);
+	if (ctx->verbose) {
+	  print_matrix (bindings[i].input, als[i].matrix);
+	}
+	ret = change_float_prop (ctx, ids[i], prop, als[i].matrix, 9);
+	if (ret != EXIT_FAILURE) {
+	  trace_alignment (&als[i]);
+	}
+      }
+    }
+    XPROF (display, "XUngrabServer", XUngrabServer (display));
+    XPROF (display, "XFlush", XFlush (display));
   }
 
-  ret = get_argval (argc, argv, "pre-script", funcname, usage, "", &pre_script);
+  if (ret != EXIT_FAILURE) {
+    ret = run_binding_scripts (bindings, count, 1);
+  }
+
+  free (ids);
+  free (crtcs);
+  if (!rettargets) {
+    free (targets);
+  }
+  if (!retals) {
+    free (als);
+  }
+  free (names);
+
+  return ret;
+}
+
+static int
+align_all (context *ctx)
+{
+  Display *display = ctx->display;
+  Window root = RootWindow (display, ctx->opts.screen);
+  screen_cache sc;
+  binding *bindings;
+  int count;
+  int ret;
+
+  if (ctx->opts.autobind) {
+    bindings = NULL;
+    count = 0;
+    ret = auto_bindings (ctx, root, &bindings, &count);
+  } else {
+    ret = get_bindings (&ctx->opts, &bindings, &count);
+  }
   if (ret == EXIT_FAILURE) {
     return ret;
   }
 
-  ret = get_argval (argc, argv, "post-script", funcname, usage, "", &post_script);
+  if (count > 0) {
+    memset (&sc, 0, sizeof (sc));
+    sc.root = root;
+    sc.dirty = 1;
+    ret = align_bindings (ctx, &sc, bindings, count, NULL, NULL);
+    screen_free (&sc);
+  } else {
+    fprintf (stderr, "No bindings to align\n");
+    ret = EXIT_FAILURE;
+  }
+
+  free_bindings (bindings, count);
+  return ret;
+}
+
+int
+align (context *ctx)
+{
+  Display *display = ctx->display;
+  const options *opts = &ctx->opts;
+  RROutput outputid;
+  XRROutputInfo *output;
+  const char *inputarg;
+  int ret;
+
+  if (opts->all || opts->autobind || opts->noutputs > 1 || opts->ninputs > 1 ||
+      (opts->noutputs == 1 && target_is_group (opts->outputs[0]))) {
+    return align_all (ctx);
+  }
+
+  inputarg = opts->ninputs > 0 ? opts->inputs[0] : "Virtual core pointer";
+
+  ret = get_output (display, opts, &outputid, &output);
   if (ret == EXIT_FAILURE) {
     return ret;
   }
 
-  if (ret != EXIT_FAILURE) {
-    Window root;
-
-    if (verbose) {
-      fprintf (stderr, "Output: %s\n", output->name);
-    }
-    
-    root = RootWindow (display, screen);
+  if (ctx->verbose) {
+    fprintf (stderr, "Output: %s\n", output->name);
+  }
 
-    ret = run_script (pre_script);
+  ret = run_script (opts->pre_script);
+  if (ret != EXIT_FAILURE) {
+    ret = apply_transform (ctx, RootWindow (display, opts->screen), output->crtc, inputarg);
     if (ret != EXIT_FAILURE) {
-	    ret = apply_transform (display, root, output->crtc, inputarg);
-	    if (ret != EXIT_FAILURE) {
-		    ret = run_script (post_script);
-	    }
+      ret = run_script (opts->post_script);
     }
   }
 
@@ -99,137 +324,158 @@ align (Display *display,
 }
 
 int
-apply_transform (Display *display,
+compute_transform (context *ctx,
+		   XRRScreenResources *res,
+		   XRRScreenConfiguration *sconf,
+		   RRCrtc crtcnum,
+		   alignment *al)
+{
+  Display *display = ctx->display;
+  int ret;
+  XRRCrtcInfo *crtc;
+  XRRCrtcTransformAttributes *transform;
+  Status status;
+
+  XPROF (display, "XRRGetCrtcInfo",
+	 crtc = XRRGetCrtcInfo (display, res, crtcnum));
+  if (!crtc) {
+    fprintf (stderr, "Unable to get the CRTC %lu\n", (unsigned long) crtcnum);
+    return EXIT_FAILURE;
+  }
+
+  XPROF (display, "XRRGetCrtcTransform",
+	 status = XRRGetCrtcTransform (display, crtcnum, &transform));
+  if (!status) {
+    fprintf (stderr, "Unable to get the current transformation\n");
+    ret = EXIT_FAILURE;
+  } else {
+    ret = compute_crtc_transform (ctx, res, sconf, crtcnum, crtc,
+				  &transform->currentTransform, al);
+    XFree (transform);
+  }
+  XRRFreeCrtcInfo (crtc);
+
+  return ret;
+}
+
+/* Computes the matrix of the CRTC from its replies already fetched:
+   no request is issued, nothing is allocated */
+int
+compute_crtc_transform (context *ctx,
+			XRRScreenResources *res,
+			XRRScreenConfiguration *sconf,
+			RRCrtc crtcnum,
+			const XRRCrtcInfo *crtc,
+			const XTransform *current,
+			alignment *al)
+{
+  transform_geometry geometry;
+  XRRScreenSize *ssize;
+  int nsizes;
+  Rotation srot;
+  int ret;
+
+  ssize = XRRConfigSizes(sconf, &nsizes) + XRRConfigCurrentConfiguration (sconf, &srot);
+
+  if (ctx->verbose) {
+    fprintf (stderr, "Screen: (%u, %u) 0x%02x\n", ssize->width, ssize->height, srot);
+    fprintf (stderr, "CRTC: (%i, %i) (%u, %u) 0x%02x\n", crtc->x, crtc->y, crtc->width, crtc->height, crtc->rotation);
+  }
+
+  ret = transform_geometry_init (&geometry, srot, ssize->width, ssize->height,
+				 crtc, current);
+  if (ret != EXIT_FAILURE) {
+    transform_matrix (&geometry, al->matrix);
+
+    al->timestamp = res->timestamp;
+    al->config_timestamp = res->configTimestamp;
+    al->crtc = crtcnum;
+    al->x = crtc->x;
+    al->y = crtc->y;
+    al->width = crtc->width;
+    al->height = crtc->height;
+    al->rotation = crtc->rotation;
+  }
+
+  return ret;
+}
+
+int
+apply_transform (context *ctx,
 		 Window root,
 		 RRCrtc crtcnum,
 		 const char *input_name)
 {
+  alignment al;
+
+  return apply_transform_ext (ctx, root, crtcnum, input_name, &al);
+}
+
+int
+apply_transform_ext (context *ctx,
+		     Window root,
+		     RRCrtc crtcnum,
+		     const char *input_name,
+		     alignment *al)
+{
+  Display *display = ctx->display;
+  XRRScreenConfiguration *sconf;
+  XRRScreenResources *res;
   int ret;
 
-  ret = EXIT_SUCCESS;
+  XPROF (display, "XRRGetScreenResourcesCurrent",
+	 res = XRRGetScreenResourcesCurrent (display, root));
+  XPROF (display, "XRRGetScreenInfo",
+	 sconf = XRRGetScreenInfo (display, root));
+
+  ret = compute_transform (ctx, res, sconf, crtcnum, al);
+
+  XRRFreeScreenResources (res);
+  XRRFreeScreenConfigInfo (sconf);
 
   if (ret != EXIT_FAILURE) {
-    XRRScreenConfiguration *sconf;
-    XRRScreenResources *res;
-    XRRCrtcInfo *crtc;
-    XRRCrtcTransformAttributes *transform;
-    Status status;
-    double amx[3][3];
-    double sina, cosa;
-    double hscale, vscale, hoffs, voffs;
-    XRRScreenSize *ssize;
-    int nsizes;
-    Rotation srot;
-    
-    res = XRRGetScreenResourcesCurrent (display, root);
-    sconf = XRRGetScreenInfo (display, root);
-    ssize = XRRConfigSizes(sconf, &nsizes) + XRRConfigCurrentConfiguration (sconf, &srot);
-    crtc = XRRGetCrtcInfo (display, res, crtcnum);
-  
-    if (verbose) {
-      fprintf (stderr, "Screen: (%u, %u) 0x%02x\n", ssize->width, ssize->height, srot);
-      fprintf (stderr, "CRTC: (%i, %i) (%u, %u) 0x%02x\n", crtc->x, crtc->y, crtc->width, crtc->height, crtc->rotation);
-    }
+    ret = write_transform (ctx, input_name, al);
+  }
 
-    switch (srot) {
-    case RR_Rotate_0:
-    case RR_Rotate_180:
-      hscale = (double)crtc->width/(double)ssize->width;
-      vscale = (double)crtc->height/(double)ssize->height;
-      break;
-    case RR_Rotate_90:
-    case RR_Rotate_270:
-      hscale = (double)crtc->width/(double)ssize->height;
-      vscale = (double)crtc->height/(double)ssize->width;
-      break;
-    default:
-      ret = EXIT_FAILURE;
-      fprintf (stderr, "The screen rotation/reflection 0x%02x is not supported yet. Sorry.\n", srot);
-    }
+  return ret;
+}
 
-    switch (crtc->rotation) {
-    case RR_Rotate_0:
-      sina = 0;
-      cosa = 1;
-      hoffs = 0;
-      voffs = 0;
-      break;
-    case RR_Rotate_90:
-      sina = 1;
-      cosa = 0;
-      hoffs = 1;
-      voffs = 0;
-      break;
-    case RR_Rotate_180:
-      sina = 0;
-      cosa = -1;
-      hoffs = 1;
-      voffs = 1;
-      break;
-    case RR_Rotate_270:
-      sina = -1;
-      cosa = 0;
-      hoffs = 0;
-      voffs = 1;
-      break;
-    default:
-      ret = EXIT_FAILURE;
-      fprintf (stderr, "The rotation/reflection 0x%02x is not supported yet. Sorry.\n", crtc->rotation);
-    }
+/* Looks up the input device and writes the computed matrix to it,
+   corrected with the stored calibration of the device */
+int
+write_transform (context *ctx,
+		 const char *input_name,
+		 alignment *al)
+{
+  XID deviceid;
+  int ret;
 
-    if (ret != EXIT_FAILURE) {
-      amx[0][0] = cosa*hscale;
-      amx[0][1] = -sina*hscale;
-      amx[0][2] = hoffs*hscale + crtc->x/ssize->width;
-      amx[1][0] = sina*vscale;
-      amx[1][1] = cosa*vscale;
-      amx[1][2] = voffs*vscale + crtc->y/ssize->height;
-      amx[2][0] = 0;
-      amx[2][1] = 0;
-      amx[2][2] = 1;
-
-      status = XRRGetCrtcTransform (display, crtcnum, &transform);
-      if (!status) {
-	fprintf (stderr, "Unable to get the current transformation\n");
-	ret = EXIT_FAILURE;
-      }
-    }
+  ret = find_inputs (ctx->display, ctx->conn.xi2, &input_name, 1, &deviceid);
+  if (ret != EXIT_FAILURE) {
+    ret = write_transform_id (ctx, input_name, deviceid, al);
+  }
 
-    if (ret != EXIT_FAILURE) {
-      static char strmx[3][3][8];
-      static const char *args[11];
-      double mx[3][3];
-      int i, j;
-
-      for (j = 0; j < 3; j++) {
-	for (i = 0; i < 3; i++) {
-	  XFixed fv = transform->currentTransform.matrix[j][i];
-          mx[j][i] = XFixedToDouble (fv);
-        }
-      }
+  return ret;
+}
 
-      args[0] = input_name;
-      args[1] = "Coordinate Transformation Matrix";
-      for (j = 0; j < 3; j++) {
-	for (i = 0; i < 3; i++) {
-          double v = mx[0][i]*amx[j][0] + mx[1][i]*amx[j][1] + mx[2][i]*amx[j][2];
-	  snprintf (strmx[j][i], 8, "%8.6f", v);
-	  args[2 + i + j*3] = strmx[j][i];
-	}
-      }
-      if (verbose) {
-	fprintf (stderr, "Debug: set-float-prop");
-	for (i = 0; i < 11; i++) {
-	  fprintf (stderr, " %s", args[i]);
-	}
-	fprintf (stderr, "\n");
-      }
-      ret = set_float_prop(display, 11, args, "set-float-prop", ": error calling function, please report a bug.");
-      XFree (transform);
-    }
-    XRRFreeCrtcInfo (crtc);
-    XRRFreeScreenResources (res);
-    XRRFreeScreenConfigInfo (sconf);
+/* Writes the matrix to the device already looked up by the caller:
+   no device list is fetched, nothing is allocated */
+int
+write_transform_id (context *ctx,
+		    const char *input_name,
+		    XID deviceid,
+		    alignment *al)
+{
+  int ret;
+
+  al->deviceid = deviceid;
+  correct_matrix (ctx, input_name, al->matrix);
+  if (ctx->verbose) {
+    print_matrix (input_name, al->matrix);
+  }
+  ret = change_float_prop (ctx, deviceid, ctx->conn.matrix_atom, al->matrix, 9);
+  if (ret != EXIT_FAILURE) {
+    trace_alignment (al);
   }
 
   return ret;
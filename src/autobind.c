@@ -0,0 +1,388 @@
+/*
+ * Original xinput:
+ * Copyright 1996 by Frederic Lepied, France. <Frederic.Lepied@sugix.frmug.org>
+ *
+ * Original xrandr:
+ * Copyright © 2001 Keith Packard, member of The XFree86 Project, Inc.
+ * Copyright © 2002 Hewlett Packard Company, Inc.
+ * Copyright © 2006 Intel Corporation
+ *
+ * xrandr-align:
+ *
+ * Copyright © 2012 Paul Wolneykien <manowar@altlinux.org>, ALT Linux Ltd.
+ *
+ * Permission to use, copy, modify, distribute, and sell this software and its
+ * documentation for any purpose is  hereby granted without fee, provided that
+ * the  above copyright   notice appear  in   all  copies and  that both  that
+ * copyright  notice   and   this  permission   notice  appear  in  supporting
+ * documentation, and that   the  name of  the authors  not  be  used  in
+ * advertising or publicity pertaining to distribution of the software without
+ * specific,  written      prior  permission.     The authors  make  no
+ * representations about the suitability of this software for any purpose.  It
+ * is provided "as is" without express or implied warranty.
+ *
+ * THE AUTHORS DISCLAIM ALL   WARRANTIES WITH REGARD  TO  THIS SOFTWARE,
+ * INCLUDING ALL IMPLIED   WARRANTIES OF MERCHANTABILITY  AND   FITNESS, IN NO
+ * EVENT  SHALL THE AUTHORS  BE   LIABLE   FOR ANY  SPECIAL, INDIRECT   OR
+ * CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM LOSS OF USE,
+ * DATA  OR PROFITS, WHETHER  IN  AN ACTION OF  CONTRACT,  NEGLIGENCE OR OTHER
+ * TORTIOUS  ACTION, ARISING    OUT OF OR   IN  CONNECTION  WITH THE USE    OR
+ * PERFORMANCE OF THIS SOFTWARE.
+ *
+ */
+
+#include "common.h"
+#include "xrandr-align.h"
+#include "profile.h"
+#include <math.h>
+#include <string.h>
+
+/* The maximum mismatch score of a device and an output to bind them */
+#define AUTOBIND_MAX_SCORE 0.5
+
+typedef struct
+{
+  char name[256];
+  int width, height;	/* mm, 0 if unknown */
+} autobind_output;
+
+typedef struct
+{
+  char name[256];
+  char ref[256];	/* the name or the ID if the name is not unique */
+  XID id;
+  int width, height;	/* mm, 0 if unknown */
+} autobind_input;
+
+/* Reads the physical size of the monitor from its EDID: the preferred
+   detailed timing has it in mm, the basic parameters in cm */
+static int
+edid_size (Display *display,
+	   RROutput outputid,
+	   int *width,
+	   int *height,
+	   char *monitor,
+	   size_t size)
+{
+  static const unsigned char header[8] = { 0, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0 };
+  Atom edid_atom, type;
+  unsigned char *edid;
+  unsigned long nitems, after;
+  int format;
+  int i;
+  int ret = EXIT_FAILURE;
+
+  edid = NULL;
+  XPROF (display, "XInternAtom",
+	 edid_atom = XInternAtom (display, RR_PROPERTY_RANDR_EDID, True));
+  if (edid_atom == None) {
+    return EXIT_FAILURE;
+  }
+
+  XPROF (display, "XRRGetOutputProperty",
+	 XRRGetOutputProperty (display, outputid, edid_atom, 0, 32, False, False,
+			       AnyPropertyType, &type, &format, &nitems, &after, &edid));
+  if (!edid) {
+    return EXIT_FAILURE;
+  }
+
+  if (format == 8 && nitems >= 128 && memcmp (edid, header, sizeof (header)) == 0) {
+    const unsigned char *dtd = edid + 54;
+
+    if (dtd[0] || dtd[1]) {
+      *width = dtd[12] | ((dtd[14] & 0xf0) << 4);
+      *height = dtd[13] | ((dtd[14] & 0x0f) << 8);
+    } else {
+      *width = *height = 0;
+    }
+    if (!*width || !*height) {
+      *width = edid[21] * 10;
+      *height = edid[22] * 10;
+    }
+
+    /* Display product name descriptor */
+    for (i = 0; i < 4 && size > 0; i++) {
+      const unsigned char *d = edid + 54 + i*18;
+      if (d[0] == 0 && d[1] == 0 && d[3] == 0xfc) {
+	int n;
+	for (n = 0; n < 13 && d[5 + n] != '\n' && n < size - 1; n++) {
+	  monitor[n] = d[5 + n];
+	}
+	monitor[n] = '\0';
+      }
+    }
+
+    ret = (*width && *height) ? EXIT_SUCCESS : EXIT_FAILURE;
+  }
+
+  XFree (edid);
+  return ret;
+}
+
+/* Lists the active outputs with their physical sizes */
+static int
+list_outputs (context *ctx,
+	      XRRScreenResources *res,
+	      autobind_output **retoutputs)
+{
+  Display *display = ctx->display;
+  autobind_output *outputs;
+  int count = 0;
+  int i;
+
+  outputs = calloc (res->noutput, sizeof (autobind_output));
+  for (i = 0; i < res->noutput; i++) {
+    XRROutputInfo *info;
+    char monitor[16] = "";
+
+    XPROF (display, "XRRGetOutputInfo",
+	   info = XRRGetOutputInfo (display, res, res->outputs[i]));
+    if (!info) {
+      continue;
+    }
+    if (info->connection == RR_Connected && info->crtc) {
+      autobind_output *o = &outputs[count++];
+      snprintf (o->name, sizeof (o->name), "%s", info->name);
+      if (edid_size (display, res->outputs[i], &o->width, &o->height,
+		     monitor, sizeof (monitor)) == EXIT_FAILURE) {
+	o->width = info->mm_width;
+	o->height = info->mm_height;
+      }
+      if (ctx->verbose) {
+	fprintf (stderr, "Output %s (%s): %ix%i mm\n", o->name,
+		 monitor[0] ? monitor : "no EDID", o->width, o->height);
+      }
+    }
+    XRRFreeOutputInfo (info);
+  }
+
+  *retoutputs = outputs;
+  return count;
+}
+
+/* Lists the absolute pointing devices with their physical sizes, as
+   given by the axis resolution (counts per meter) */
+static int
+list_inputs (context *ctx,
+	     autobind_input **retinputs)
+{
+  Display *display = ctx->display;
+  XDeviceInfo *devices;
+  autobind_input *inputs;
+  int ndevices;
+  int count = 0;
+  int i, j;
+
+  XPROF (display, "XListInputDevices",
+	 devices = XListInputDevices (display, &ndevices));
+  if (!devices) {
+    *retinputs = NULL;
+    return 0;
+  }
+
+  inputs = calloc (ndevices, sizeof (autobind_input));
+  for (i = 0; i < ndevices; i++) {
+    XAnyClassPtr any = (XAnyClassPtr) devices[i].inputclassinfo;
+
+    if (devices[i].use < IsXExtensionDevice ||
+	!check_valuator (&devices[i], Absolute, 2, False)) {
+      continue;
+    }
+
+    for (j = 0; j < devices[i].num_classes; j++) {
+      if (any->class == ValuatorClass) {
+	XValuatorInfoPtr v = (XValuatorInfoPtr) any;
+	XAxisInfoPtr a = (XAxisInfoPtr) ((char *) v + sizeof (XValuatorInfo));
+
+	/* Signed axes are the gravity sensors, not touch panels */
+	if (v->mode == Absolute && v->num_axes >= 2 &&
+	    a[0].min_value >= 0 && a[1].min_value >= 0) {
+	  autobind_input *in = &inputs[count++];
+	  snprintf (in->name, sizeof (in->name), "%s", devices[i].name);
+	  in->id = devices[i].id;
+	  if (a[0].resolution > 0 && a[1].resolution > 0) {
+	    in->width = (int) ((double) (a[0].max_value - a[0].min_value) * 1000 / a[0].resolution);
+	    in->height = (int) ((double) (a[1].max_value - a[1].min_value) * 1000 / a[1].resolution);
+	  }
+	  if (ctx->verbose) {
+	    fprintf (stderr, "Input %s: %ix%i mm\n", in->name, in->width, in->height);
+	  }
+	  break;
+	}
+      }
+      any = (XAnyClassPtr) ((char *) any + any->length);
+    }
+  }
+
+  /* Identical devices (i.e. two panels of the same model) are told
+     apart by their IDs only */
+  for (i = 0; i < count; i++) {
+    for (j = 0; j < count; j++) {
+      if (j != i && strcmp (inputs[j].name, inputs[i].name) == 0) {
+	break;
+      }
+    }
+    if (j < count) {
+      snprintf (inputs[i].ref, sizeof (inputs[i].ref), "%lu", (unsigned long) inputs[i].id);
+      if (ctx->verbose) {
+	fprintf (stderr, "Input %s is bound by its ID %s\n", inputs[i].name, inputs[i].ref);
+      }
+    } else {
+      snprintf (inputs[i].ref, sizeof (inputs[i].ref), "%s", inputs[i].name);
+    }
+  }
+
+  XFreeDeviceList (devices);
+  *retinputs = inputs;
+  return count;
+}
+
+/* The relative mismatch of the size and the aspect ratio */
+static double
+match_score (const autobind_input *in,
+	     const autobind_output *out)
+{
+  double aspect_in, aspect_out;
+
+  aspect_in = (double) in->width / in->height;
+  aspect_out = (double) out->width / out->height;
+
+  return fabs (in->width - out->width) / out->width +
+    fabs (in->height - out->height) / out->height +
+    fabs (aspect_in - aspect_out) / aspect_out;
+}
+
+/* Built-in panels are the usual place of the touch screens whose
+   size is unknown */
+static int
+is_internal (const char *name)
+{
+  return strncmp (name, "LVDS", 4) == 0 ||
+    strncmp (name, "eDP", 3) == 0 ||
+    strncmp (name, "DSI", 3) == 0;
+}
+
+static void
+add_binding (context *ctx,
+	     binding **bindings,
+	     int *count,
+	     const char *output,
+	     const char *input)
+{
+  binding *b;
+
+  *bindings = realloc (*bindings, (*count + 1) * sizeof (binding));
+  b = &(*bindings)[(*count)++];
+  b->output = strdup (output);
+  b->input = strdup (input);
+  b->pre_script = strdup (ctx->opts.pre_script);
+  b->post_script = strdup (ctx->opts.post_script);
+
+  if (ctx->verbose) {
+    fprintf (stderr, "Auto binding: \"%s\" \"%s\"\n", output, input);
+  }
+}
+
+/* Binds the absolute input devices to the active outputs of the
+   screen by their physical sizes. The bindings are appended to the
+   given list. */
+int
+auto_bindings (context *ctx,
+	       Window root,
+	       binding **bindings,
+	       int *count)
+{
+  Display *display = ctx->display;
+  XRRScreenResources *res;
+  autobind_output *outputs;
+  autobind_input *inputs;
+  int noutputs, ninputs;
+  int *out_used, *in_used;
+  int i, o;
+
+  XPROF (display, "XRRGetScreenResourcesCurrent",
+	 res = XRRGetScreenResourcesCurrent (display, root));
+  if (!res) {
+    return EXIT_FAILURE;
+  }
+  noutputs = list_outputs (ctx, res, &outputs);
+  XRRFreeScreenResources (res);
+  ninputs = list_inputs (ctx, &inputs);
+
+  out_used = calloc (noutputs + 1, sizeof (int));
+  in_used = calloc (ninputs + 1, sizeof (int));
+
+  /* Greedily take the best matching pair of the devices and outputs
+     of the known sizes */
+  for (;;) {
+    double best = AUTOBIND_MAX_SCORE;
+    int bi = -1, bo = -1;
+
+    for (i = 0; i < ninputs; i++) {
+      if (in_used[i] || !inputs[i].width || !inputs[i].height) {
+	continue;
+      }
+      for (o = 0; o < noutputs; o++) {
+	double score;
+	if (out_used[o] || !outputs[o].width || !outputs[o].height) {
+	  continue;
+	}
+	score = match_score (&inputs[i], &outputs[o]);
+	if (score < best) {
+	  best = score;
+	  bi = i;
+	  bo = o;
+	}
+      }
+    }
+    if (bi < 0) {
+      break;
+    }
+
+    add_binding (ctx, bindings, count, outputs[bo].name, inputs[bi].ref);
+    in_used[bi] = out_used[bo] = 1;
+  }
+
+  /* The rest of the unknown size goes to the only free output or to
+     the built-in one. A device of a known size matching no output is
+     an external one (i.e. a pen tablet): it is not put on the panel
+     silently. */
+  for (i = 0; i < ninputs; i++) {
+    int free_count = 0, free_o = -1, internal_o = -1;
+
+    if (in_used[i]) {
+      continue;
+    }
+    if (inputs[i].width && inputs[i].height) {
+      fprintf (stderr, "No output matches the size of %s (%ix%i mm): specify it explicitly\n",
+	       inputs[i].name, inputs[i].width, inputs[i].height);
+      continue;
+    }
+    for (o = 0; o < noutputs; o++) {
+      if (!out_used[o]) {
+	free_count++;
+	free_o = o;
+	if (internal_o < 0 && is_internal (outputs[o].name)) {
+	  internal_o = o;
+	}
+      }
+    }
+    o = free_count == 1 ? free_o : internal_o;
+    if (o < 0) {
+      fprintf (stderr, "Unable to bind %s to an output: specify it explicitly\n", inputs[i].name);
+      continue;
+    }
+
+    add_binding (ctx, bindings, count, outputs[o].name, inputs[i].ref);
+    in_used[i] = out_used[o] = 1;
+  }
+
+  free (in_used);
+  free (out_used);
+  free (inputs);
+  free (outputs);
+
+  return EXIT_SUCCESS;
+}
+
+/* end of autobind.c */
@@ -0,0 +1,680 @@
+/*
+ * Original xinput:
+ * Copyright 1996 by Frederic Lepied, France. <Frederic.Lepied@sugix.frmug.org>
+ *
+ * Original xrandr:
+ * Copyright © 2001 Keith Packard, member of The XFree86 Project, Inc.
+ * Copyright © 2002 Hewlett Packard Company, Inc.
+ * Copyright © 2006 Intel Corporation
+ *
+ * xrandr-align:
+ *
+ * Copyright © 2012 Paul Wolneykien <manowar@altlinux.org>, ALT Linux Ltd.
+ *
+ * Permission to use, copy, modify, distribute, and sell this software and its
+ * documentation for any purpose is  hereby granted without fee, provided that
+ * the  above copyright   notice appear  in   all  copies and  that both  that
+ * copyright  notice   and   this  permission   notice  appear  in  supporting
+ * documentation, and that   the  name of  the authors  not  be  used  in
+ * advertising or publicity pertaining to distribution of the software without
+ * specific,  written      prior  permission.     The authors  make  no
+ * representations about the suitability of this software for any purpose.  It
+ * is provided "as is" without express or implied warranty.
+ *
+ * THE AUTHORS DISCLAIM ALL   WARRANTIES WITH REGARD  TO  THIS SOFTWARE,
+ * INCLUDING ALL IMPLIED   WARRANTIES OF MERCHANTABILITY  AND   FITNESS, IN NO
+ * EVENT  SHALL THE AUTHORS  BE   LIABLE   FOR ANY  SPECIAL, INDIRECT   OR
+ * CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM LOSS OF USE,
+ * DATA  OR PROFITS, WHETHER  IN  AN ACTION OF  CONTRACT,  NEGLIGENCE OR OTHER
+ * TORTIOUS  ACTION, ARISING    OUT OF OR   IN  CONNECTION  WITH THE USE    OR
+ * PERFORMANCE OF THIS SOFTWARE.
+ *
+ */
+
+#include "common.h"
+#include "xrandr-align.h"
+#include "profile.h"
+#include <errno.h>
+#include <math.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <X11/keysym.h>
+
+#define CALIBRATION_POINTS_MAX 9
+#define CALIBRATION_INSET 0.1
+
+/* The correction is an affine transformation of the normalized
+ * device coordinates, stored as the first two rows of a 3x3 matrix:
+ *
+ *   "DEVICE" a b c d e f
+ *
+ * It is applied before the alignment matrix: M' = M * C. The
+ * corrections are kept in the context of each display. */
+
+static int
+calibration_path (char *path,
+		  size_t size)
+{
+  const char *home = getenv ("HOME");
+
+  if (!home || strlen (home) == 0) {
+    return EXIT_FAILURE;
+  }
+  if (snprintf (path, size, "%s/.xrandr-align/calibration", home) >= size) {
+    return EXIT_FAILURE;
+  }
+
+  return EXIT_SUCCESS;
+}
+
+/* Sets the path of the calibration file once: the --calibration
+   option or the default file, empty if neither can be used */
+static const char *
+locate_calibration (context *ctx)
+{
+  calibration *cal = &ctx->cal;
+  const char *filearg = ctx->opts.calibration;
+
+  if (!cal->located) {
+    if (filearg && strlen (filearg) > 0) {
+      if (snprintf (cal->path, sizeof (cal->path), "%s", filearg) >= sizeof (cal->path)) {
+	fprintf (stderr, "The calibration file name is too long: %s\n", filearg);
+	cal->path[0] = '\0';
+      }
+    } else if (calibration_path (cal->path, sizeof (cal->path)) == EXIT_FAILURE) {
+      cal->path[0] = '\0';
+    }
+    cal->located = 1;
+  }
+
+  return cal->path;
+}
+
+static void
+free_corrections (calibration *cal)
+{
+  int i;
+
+  for (i = 0; i < cal->count; i++) {
+    free (cal->corrections[i].input);
+  }
+  free (cal->corrections);
+  cal->corrections = NULL;
+  cal->count = 0;
+}
+
+void
+free_calibration (calibration *cal)
+{
+  free_corrections (cal);
+  cal->loaded = 0;
+}
+
+static void
+load_corrections (calibration *cal)
+{
+  FILE *f;
+  char line[1024];
+  int size = 0;
+
+  f = fopen (cal->path, "r");
+  if (!f) {
+    return;
+  }
+
+  while (fgets (line, sizeof (line), f)) {
+    char *p = line;
+    char *input;
+    double c[6];
+
+    while (*p == ' ' || *p == '\t') {
+      p++;
+    }
+    if (*p != '"' || !(input = read_quoted (&p))) {
+      continue;
+    }
+    if (sscanf (p, "%lf %lf %lf %lf %lf %lf", &c[0], &c[1], &c[2], &c[3], &c[4], &c[5]) != 6) {
+      fprintf (stderr, "%s: invalid calibration of %s, skipped\n", cal->path, input);
+      continue;
+    }
+    if (cal->count == size) {
+      size = size ? 2 * size : 4;
+      cal->corrections = realloc (cal->corrections, size * sizeof (correction));
+    }
+    cal->corrections[cal->count].input = strdup (input);
+    memcpy (cal->corrections[cal->count].c, c, sizeof (c));
+    cal->count++;
+  }
+  fclose (f);
+}
+
+/* Loads the calibration file on the first use and again when it was
+   replaced (a new inode, as save_correction() does) or modified. A
+   single stat() per alignment otherwise. */
+static void
+refresh_corrections (context *ctx)
+{
+  calibration *cal = &ctx->cal;
+  struct stat st;
+
+  if (strlen (locate_calibration (ctx)) == 0) {
+    return;
+  }
+  if (stat (cal->path, &st) != 0) {
+    memset (&st, 0, sizeof (st));
+  }
+  if (cal->loaded && st.st_mtime == cal->mtime &&
+      st.st_size == cal->size && st.st_ino == cal->ino) {
+    return;
+  }
+
+  free_corrections (cal);
+  load_corrections (cal);
+  if (ctx->verbose && cal->loaded) {
+    fprintf (stderr, "Reloaded %i corrections from %s\n", cal->count, cal->path);
+  }
+  cal->loaded = 1;
+  cal->mtime = st.st_mtime;
+  cal->size = st.st_size;
+  cal->ino = st.st_ino;
+}
+
+static correction *
+find_correction (context *ctx,
+		 const char *input_name)
+{
+  calibration *cal = &ctx->cal;
+  int i;
+
+  refresh_corrections (ctx);
+  for (i = 0; i < cal->count; i++) {
+    if (strcmp (cal->corrections[i].input, input_name) == 0) {
+      return &cal->corrections[i];
+    }
+  }
+
+  return NULL;
+}
+
+/* Composes the stored correction of the input (if any) into the
+   alignment matrix */
+void
+correct_matrix (context *ctx,
+		const char *input_name,
+		float matrix[9])
+{
+  correction *corr;
+  double m[9];
+  int i, j;
+
+  corr = find_correction (ctx, input_name);
+  if (!corr) {
+    return;
+  }
+
+  for (i = 0; i < 9; i++) {
+    m[i] = matrix[i];
+  }
+  for (j = 0; j < 3; j++) {
+    matrix[j*3 + 0] = m[j*3 + 0]*corr->c[0] + m[j*3 + 1]*corr->c[3];
+    matrix[j*3 + 1] = m[j*3 + 0]*corr->c[1] + m[j*3 + 1]*corr->c[4];
+    matrix[j*3 + 2] = m[j*3 + 0]*corr->c[2] + m[j*3 + 1]*corr->c[5] + m[j*3 + 2];
+  }
+
+  if (ctx->verbose) {
+    fprintf (stderr, "Correction of %s: %f %f %f %f %f %f\n", input_name,
+	     corr->c[0], corr->c[1], corr->c[2], corr->c[3], corr->c[4], corr->c[5]);
+  }
+}
+
+/* Replaces (or adds) the correction line of the input in the file */
+static int
+save_correction (const char *path,
+		 const char *input_name,
+		 const double c[6])
+{
+  char tmppath[1100];
+  char line[1024];
+  FILE *in, *out;
+  char *slash;
+
+  slash = strrchr (path, '/');
+  if (slash) {
+    char dir[1024];
+    snprintf (dir, sizeof (dir), "%.*s", (int) (slash - path), path);
+    if (mkdir (dir, 0755) != 0 && errno != EEXIST) {
+      perror (dir);
+      return EXIT_FAILURE;
+    }
+  }
+
+  snprintf (tmppath, sizeof (tmppath), "%s.new", path);
+  out = fopen (tmppath, "w");
+  if (!out) {
+    perror (tmppath);
+    return EXIT_FAILURE;
+  }
+
+  in = fopen (path, "r");
+  if (in) {
+    while (fgets (line, sizeof (line), in)) {
+      char copy[1024];
+      char *p = copy;
+      char *input;
+      strcpy (copy, line);
+      while (*p == ' ' || *p == '\t') {
+	p++;
+      }
+      if (*p == '"' && (input = read_quoted (&p)) && strcmp (input, input_name) == 0) {
+	continue;
+      }
+      fputs (line, out);
+    }
+    fclose (in);
+  }
+
+  fprintf (out, "\"%s\" %f %f %f %f %f %f\n", input_name, c[0], c[1], c[2], c[3], c[4], c[5]);
+  if (fclose (out) != 0 || rename (tmppath, path) != 0) {
+    perror (path);
+    return EXIT_FAILURE;
+  }
+
+  return EXIT_SUCCESS;
+}
+
+/* Solves the 3x3 linear system A x = b by Cramer's rule */
+static int
+solve3 (double a[3][3],
+	const double b[3],
+	double x[3])
+{
+  double det;
+  int i, k;
+
+  det = a[0][0]*(a[1][1]*a[2][2] - a[1][2]*a[2][1]) -
+    a[0][1]*(a[1][0]*a[2][2] - a[1][2]*a[2][0]) +
+    a[0][2]*(a[1][0]*a[2][1] - a[1][1]*a[2][0]);
+  if (fabs (det) < 1e-12) {
+    return EXIT_FAILURE;
+  }
+
+  for (k = 0; k < 3; k++) {
+    double m[3][3];
+    memcpy (m, a, sizeof (m));
+    for (i = 0; i < 3; i++) {
+      m[i][k] = b[i];
+    }
+    x[k] = (m[0][0]*(m[1][1]*m[2][2] - m[1][2]*m[2][1]) -
+	    m[0][1]*(m[1][0]*m[2][2] - m[1][2]*m[2][0]) +
+	    m[0][2]*(m[1][0]*m[2][1] - m[1][1]*m[2][0])) / det;
+  }
+
+  return EXIT_SUCCESS;
+}
+
+/* Least squares fit of the affine transformation C: raw -> expected,
+   c holding its two rows. Fails if the points are collinear. */
+int
+fit_affine (const double raw[][2],
+	    const double expected[][2],
+	    int n,
+	    double c[6])
+{
+  double a[3][3];
+  double bx[3], by[3];
+  int i, j, k;
+
+  memset (a, 0, sizeof (a));
+  memset (bx, 0, sizeof (bx));
+  memset (by, 0, sizeof (by));
+  for (i = 0; i < n; i++) {
+    double r[3] = { raw[i][0], raw[i][1], 1 };
+    for (j = 0; j < 3; j++) {
+      for (k = 0; k < 3; k++) {
+	a[j][k] += r[j]*r[k];
+      }
+      bx[j] += r[j]*expected[i][0];
+      by[j] += r[j]*expected[i][1];
+    }
+  }
+
+  if (solve3 (a, bx, c) == EXIT_FAILURE ||
+      solve3 (a, by, c + 3) == EXIT_FAILURE) {
+    return EXIT_FAILURE;
+  }
+
+  return EXIT_SUCCESS;
+}
+
+/* Maps a normalized screen point back to the device space through
+   the inverse of the (affine) alignment matrix */
+int
+unalign_point (const float m[9],
+	       double sx,
+	       double sy,
+	       double *dx,
+	       double *dy)
+{
+  double det = m[0]*m[4] - m[1]*m[3];
+
+  if (fabs (det) < 1e-12) {
+    return EXIT_FAILURE;
+  }
+
+  sx -= m[2];
+  sy -= m[5];
+  *dx = ( m[4]*sx - m[1]*sy) / det;
+  *dy = (-m[3]*sx + m[0]*sy) / det;
+
+  return EXIT_SUCCESS;
+}
+
+#if HAVE_XI2
+static const double target_positions[CALIBRATION_POINTS_MAX][2] =
+{
+  { CALIBRATION_INSET, CALIBRATION_INSET },
+  { 1 - CALIBRATION_INSET, CALIBRATION_INSET },
+  { 1 - CALIBRATION_INSET, 1 - CALIBRATION_INSET },
+  { CALIBRATION_INSET, 1 - CALIBRATION_INSET },
+  { 0.5, 0.5 },
+  { 0.5, CALIBRATION_INSET },
+  { 1 - CALIBRATION_INSET, 0.5 },
+  { 0.5, 1 - CALIBRATION_INSET },
+  { CALIBRATION_INSET, 0.5 }
+};
+
+static void
+draw_target (Display *display,
+	     Window win,
+	     GC gc,
+	     int width,
+	     int height,
+	     int k,
+	     int n)
+{
+  int x = (int) (target_positions[k][0] * width);
+  int y = (int) (target_positions[k][1] * height);
+  char msg[64];
+
+  XClearWindow (display, win);
+  XDrawLine (display, win, gc, x - 20, y, x + 20, y);
+  XDrawLine (display, win, gc, x, y - 20, x, y + 20);
+  XDrawArc (display, win, gc, x - 10, y - 10, 20, 20, 0, 360*64);
+  snprintf (msg, sizeof (msg), "Touch the target %i of %i (Esc to cancel)", k + 1, n);
+  XDrawString (display, win, gc, width/2 - 3*strlen (msg), height/3, msg, strlen (msg));
+  XFlush (display);
+}
+
+/* Reads the first two valuators out of the raw event, if present */
+static void
+raw_position (XIRawEvent *raw,
+	      double pos[2])
+{
+  double *val = raw->raw_values;
+  int i;
+
+  for (i = 0; i < raw->valuators.mask_len * 8 && i < 2; i++) {
+    if (XIMaskIsSet (raw->valuators.mask, i)) {
+      pos[i] = *(val++);
+    }
+  }
+}
+
+static int
+collect_points (context *ctx,
+		Window root,
+		int deviceid,
+		const XRRCrtcInfo *crtc,
+		const double range[2][2],
+		double raw[][2],
+		int n)
+{
+  XSetWindowAttributes attr;
+  XIEventMask mask;
+  unsigned char bits[XIMaskLen (XI_LASTEVENT)];
+  Display *display = ctx->display;
+  Window win;
+  GC gc;
+  double pos[2] = { 0, 0 };
+  Time last = 0;
+  int k = 0;
+  int ret = EXIT_SUCCESS;
+
+  attr.override_redirect = True;
+  attr.background_pixel = BlackPixel (display, DefaultScreen (display));
+  win = XCreateWindow (display, root, crtc->x, crtc->y, crtc->width, crtc->height, 0,
+		       CopyFromParent, InputOutput, CopyFromParent,
+		       CWOverrideRedirect | CWBackPixel, &attr);
+  XSelectInput (display, win, ExposureMask | KeyPressMask);
+  gc = XCreateGC (display, win, 0, NULL);
+  XSetForeground (display, gc, WhitePixel (display, DefaultScreen (display)));
+  XMapRaised (display, win);
+  XGrabKeyboard (display, win, False, GrabModeAsync, GrabModeAsync, CurrentTime);
+
+  memset (bits, 0, sizeof (bits));
+  XISetMask (bits, XI_RawMotion);
+  XISetMask (bits, XI_RawButtonRelease);
+#ifdef XI_RawTouchEnd
+  XISetMask (bits, XI_RawTouchBegin);
+  XISetMask (bits, XI_RawTouchUpdate);
+  XISetMask (bits, XI_RawTouchEnd);
+#endif
+  mask.deviceid = deviceid;
+  mask.mask_len = sizeof (bits);
+  mask.mask = bits;
+  XPROF (display, "XISelectEvents",
+	 XISelectEvents (display, root, &mask, 1));
+
+  while (k < n && ret != EXIT_FAILURE) {
+    XEvent e;
+    XGenericEventCookie *cookie = &e.xcookie;
+
+    XNextEvent (display, &e);
+    if (e.type == Expose && e.xexpose.count == 0) {
+      draw_target (display, win, gc, crtc->width, crtc->height, k, n);
+    } else if (e.type == KeyPress &&
+	       XLookupKeysym (&e.xkey, 0) == XK_Escape) {
+      fprintf (stderr, "Calibration cancelled\n");
+      ret = EXIT_FAILURE;
+    } else if (cookie->type == GenericEvent &&
+	       cookie->extension == ctx->conn.xi_opcode &&
+	       XGetEventData (display, cookie)) {
+      XIRawEvent *r = cookie->data;
+      switch (r->evtype) {
+      case XI_RawMotion:
+#ifdef XI_RawTouchEnd
+      case XI_RawTouchBegin:
+      case XI_RawTouchUpdate:
+#endif
+	raw_position (r, pos);
+	break;
+      case XI_RawButtonRelease:
+#ifdef XI_RawTouchEnd
+      case XI_RawTouchEnd:
+#endif
+	raw_position (r, pos);
+	/* Debounce: a touch may come as both the touch and the
+	   emulated button events */
+	if (r->time - last > 300) {
+	  raw[k][0] = (pos[0] - range[0][0]) / (range[0][1] - range[0][0]);
+	  raw[k][1] = (pos[1] - range[1][0]) / (range[1][1] - range[1][0]);
+	  if (ctx->verbose) {
+	    fprintf (stderr, "Point %i: raw (%f, %f) normalized (%f, %f)\n", k + 1,
+		     pos[0], pos[1], raw[k][0], raw[k][1]);
+	  }
+	  last = r->time;
+	  k++;
+	  if (k < n) {
+	    draw_target (display, win, gc, crtc->width, crtc->height, k, n);
+	  }
+	}
+	break;
+      }
+      XFreeEventData (display, cookie);
+    }
+  }
+
+  mask.mask_len = 0;
+  XISelectEvents (display, root, &mask, 1);
+  XUngrabKeyboard (display, CurrentTime);
+  XFreeGC (display, gc);
+  XDestroyWindow (display, win);
+  XFlush (display);
+
+  return ret;
+}
+
+static int
+valuator_ranges (Display *display,
+		 int deviceid,
+		 double range[2][2])
+{
+  XIDeviceInfo *info;
+  int ndevices;
+  int found = 0;
+  int i;
+
+  XPROF (display, "XIQueryDevice",
+	 info = XIQueryDevice (display, deviceid, &ndevices));
+  if (!info) {
+    return EXIT_FAILURE;
+  }
+  for (i = 0; i < info->num_classes; i++) {
+    if (info->classes[i]->type == XIValuatorClass) {
+      XIValuatorClassInfo *v = (XIValuatorClassInfo *) info->classes[i];
+      if (v->number < 2 && v->max > v->min) {
+	range[v->number][0] = v->min;
+	range[v->number][1] = v->max;
+	found |= 1 << v->number;
+      }
+    }
+  }
+  XIFreeDeviceInfo (info);
+
+  return found == 3 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+int
+calibrate (context *ctx)
+{
+  Display *display = ctx->display;
+  const options *opts = &ctx->opts;
+  RROutput outputid;
+  XRROutputInfo *output;
+  XRRScreenResources *res;
+  XRRScreenConfiguration *sconf;
+  XRRCrtcInfo *crtc;
+  const char *inputarg;
+  const char *pointsarg;
+  const char *path;
+  char *end;
+  int screen = opts->screen;
+  int npoints;
+  Window root;
+  alignment al;
+  float matrix[9];
+  double range[2][2];
+  double raw[CALIBRATION_POINTS_MAX][2];
+  double expected[CALIBRATION_POINTS_MAX][2];
+  double c[6];
+  int i;
+  int ret;
+
+  if (opts->ninputs != 1) {
+    return usage_error (opts);
+  }
+  inputarg = opts->inputs[0];
+
+  ret = get_argval (opts->argc, opts->argv, "points", opts->funcname, opts->usage, "5", &pointsarg);
+  if (ret == EXIT_FAILURE) {
+    return ret;
+  }
+  npoints = strtol (pointsarg, &end, 0);
+  if (*end != '\0' || npoints < 3 || npoints > CALIBRATION_POINTS_MAX) {
+    fprintf (stderr, "The number of points should be from 3 to %i\n", CALIBRATION_POINTS_MAX);
+    return EXIT_FAILURE;
+  }
+
+  path = locate_calibration (ctx);
+  if (strlen (path) == 0) {
+    fprintf (stderr, "Unable to locate the calibration file\n");
+    return EXIT_FAILURE;
+  }
+
+  if (!ctx->conn.xi2) {
+    fprintf (stderr, "Calibration requires XInput 2\n");
+    return EXIT_FAILURE;
+  }
+
+  ret = get_output (display, opts, &outputid, &output);
+  if (ret == EXIT_FAILURE) {
+    return ret;
+  }
+  if (!output->crtc) {
+    fprintf (stderr, "Output %s is disabled\n", output->name);
+    XRRFreeOutputInfo (output);
+    return EXIT_FAILURE;
+  }
+
+  root = RootWindow (display, screen);
+  XPROF (display, "XRRGetScreenResourcesCurrent",
+	 res = XRRGetScreenResourcesCurrent (display, root));
+  XPROF (display, "XRRGetScreenInfo",
+	 sconf = XRRGetScreenInfo (display, root));
+  XPROF (display, "XRRGetCrtcInfo",
+	 crtc = XRRGetCrtcInfo (display, res, output->crtc));
+
+  /* The uncorrected alignment maps the expected screen points back
+     to the device space */
+  ret = compute_transform (ctx, res, sconf, output->crtc, &al);
+  if (ret != EXIT_FAILURE) {
+    memcpy (matrix, al.matrix, sizeof (matrix));
+    ret = write_transform (ctx, inputarg, &al);
+  }
+  if (ret != EXIT_FAILURE) {
+    ret = valuator_ranges (display, al.deviceid, range);
+    if (ret == EXIT_FAILURE) {
+      fprintf (stderr, "Device %s has no absolute X and Y axes\n", inputarg);
+    }
+  }
+
+  for (i = 0; i < npoints && ret != EXIT_FAILURE; i++) {
+    double sx = (crtc->x + target_positions[i][0] * crtc->width) / DisplayWidth (display, screen);
+    double sy = (crtc->y + target_positions[i][1] * crtc->height) / DisplayHeight (display, screen);
+    ret = unalign_point (matrix, sx, sy, &expected[i][0], &expected[i][1]);
+  }
+
+  if (ret != EXIT_FAILURE) {
+    ret = collect_points (ctx, root, al.deviceid, crtc, range, raw, npoints);
+  }
+
+  if (ret != EXIT_FAILURE) {
+    ret = fit_affine (raw, expected, npoints, c);
+    if (ret == EXIT_FAILURE) {
+      fprintf (stderr, "The touched points are degenerate, please try again\n");
+    }
+  }
+
+  if (ret != EXIT_FAILURE) {
+    printf ("\"%s\" %f %f %f %f %f %f\n", inputarg, c[0], c[1], c[2], c[3], c[4], c[5]);
+    ret = save_correction (path, inputarg, c);
+  }
+
+  /* Realign with the new correction, reloaded as the file changed */
+  if (ret != EXIT_FAILURE) {
+    ret = compute_transform (ctx, res, sconf, output->crtc, &al);
+    if (ret != EXIT_FAILURE) {
+      ret = write_transform (ctx, inputarg, &al);
+    }
+  }
+
+  XRRFreeCrtcInfo (crtc);
+  XRRFreeScreenConfigInfo (sconf);
+  XRRFreeScreenResources (res);
+  XRRFreeOutputInfo (output);
+
+  return ret;
+}
+#endif
+
+/* end of calibrate.c */
@@ -32,7 +32,10 @@
  */
 
 #include "string.h"
+#include <ctype.h>
+#include <time.h>
 #include "common.h"
+#include "profile.h"
 
 int
 get_argval (int argc,
@@ -69,43 +72,155 @@ get_argval (int argc,
 }
 
 int
-get_screen (Display *display,
-	    int	argc,
-	    const char *argv[],
-	    const char *funcname,
-	    const char *usage,
-	    int *retscreen)
+get_argvals (int argc,
+	     const char *argv[],
+	     const char *argname,
+	     const char *funcname,
+	     const char *usage,
+	     const char **outvals,
+	     int *count)
+{
+  int i;
+
+  *count = 0;
+  for (i = 0; i < argc; i++) {
+    if (strlen (argv[i]) > 2 &&
+	strncmp (argv[i], "--", 2) == 0 &&
+	strncmp (argv[i] + 2, argname, strlen(argname)) == 0) {
+      const char *val;
+      if (get_argval (1, argv + i, argname, funcname, usage, NULL, &val) == EXIT_FAILURE) {
+	return EXIT_FAILURE;
+      }
+      outvals[(*count)++] = val;
+    }
+  }
+
+  return EXIT_SUCCESS;
+}
+
+int
+get_argflag (int argc,
+	     const char *argv[],
+	     const char *argname)
+{
+  int i;
+
+  for (i = 0; i < argc; i++) {
+    if (strncmp (argv[i], "--", 2) == 0 &&
+	strcmp (argv[i] + 2, argname) == 0) {
+      return 1;
+    }
+  }
+
+  return 0;
+}
+
+static int
+parse_screen (Display *display,
+	      options *opts)
 {
   long screen;
   const char *screenarg;
   int ret;
 
-  ret = get_argval (argc, argv, "screen", funcname, usage, "-1", &screenarg);
-  if (ret != EXIT_FAILURE) {
+  ret = get_argval (opts->argc, opts->argv, "screen", opts->funcname, opts->usage, "-1", &screenarg);
+  if (ret == EXIT_FAILURE) {
+    return ret;
+  }
+
+  if (strcmp (screenarg, "all") == 0) {
+    opts->all_screens = 1;
+    screen = -1;
+  } else {
     char *endptr;
     screen = strtol (screenarg, &endptr, 0);
     if (endptr == screenarg) {
       fprintf (stderr, "Invalid number: %s\n", screenarg);
-      ret = EXIT_FAILURE;
+      return EXIT_FAILURE;
     }
   }
 
-  if (ret != EXIT_FAILURE) {
-    if (screen < 0) {
-      screen = DefaultScreen (display);
-    } else if (screen >= ScreenCount (display)) {
-      fprintf (stderr, "Invalid screen number %ld (display has %d)\n",
-	       screen, ScreenCount (display));
-      ret = EXIT_FAILURE;
-    }
+  if (screen < 0) {
+    screen = DefaultScreen (display);
+  } else if (screen >= ScreenCount (display)) {
+    fprintf (stderr, "Invalid screen number %ld (display has %d)\n",
+	     screen, ScreenCount (display));
+    return EXIT_FAILURE;
   }
 
+  opts->screen = (int) screen;
+  return EXIT_SUCCESS;
+}
+
+/* Parses the options common to the functions once */
+int
+parse_options (Display *display,
+	       int argc,
+	       const char *argv[],
+	       const char *funcname,
+	       const char *usage,
+	       options *opts)
+{
+  int ret;
+
+  memset (opts, 0, sizeof (options));
+  opts->argc = argc;
+  opts->argv = argv;
+  opts->funcname = funcname;
+  opts->usage = usage;
+  opts->outputs = calloc (argc + 1, sizeof (const char *));
+  opts->inputs = calloc (argc + 1, sizeof (const char *));
+
+  ret = parse_screen (display, opts);
+  if (ret != EXIT_FAILURE) {
+    ret = get_argvals (argc, argv, "output", funcname, usage, opts->outputs, &opts->noutputs);
+  }
+  if (ret != EXIT_FAILURE) {
+    ret = get_argvals (argc, argv, "input", funcname, usage, opts->inputs, &opts->ninputs);
+  }
+  if (ret != EXIT_FAILURE) {
+    ret = get_argval (argc, argv, "pre-script", funcname, usage, "", &opts->pre_script);
+  }
   if (ret != EXIT_FAILURE) {
-    *retscreen = (int)screen;
+    ret = get_argval (argc, argv, "post-script", funcname, usage, "", &opts->post_script);
+  }
+  if (ret != EXIT_FAILURE) {
+    ret = get_argval (argc, argv, "config", funcname, usage, "", &opts->config);
+  }
+  if (ret != EXIT_FAILURE) {
+    ret = get_argval (argc, argv, "state", funcname, usage, "", &opts->state);
+  }
+  if (ret != EXIT_FAILURE) {
+    ret = get_argval (argc, argv, "calibration", funcname, usage, "", &opts->calibration);
+  }
+
+  opts->all = get_argflag (argc, argv, "all");
+  opts->autobind = get_argflag (argc, argv, "auto");
+  opts->no_state = get_argflag (argc, argv, "no-state");
+
+  if (ret == EXIT_FAILURE) {
+    free_options (opts);
   }
   return ret;
 }
 
+void
+free_options (options *opts)
+{
+  free (opts->outputs);
+  free (opts->inputs);
+  opts->outputs = opts->inputs = NULL;
+  opts->noutputs = opts->ninputs = 0;
+}
+
+/* Prints the usage of the function and fails */
+int
+usage_error (const options *opts)
+{
+  fprintf (stderr, "Usage: %s %s\n", opts->funcname, opts->usage);
+  return EXIT_FAILURE;
+}
+
 int
 check_output (XRRScreenResources *res,
 	      int outid)
@@ -122,76 +237,121 @@ check_output (XRRScreenResources *res,
 }
 
 int
-get_output (Display *display,
-	    int	argc,
-	    const char *argv[],
-	    const char *funcname,
-	    const char *usage,
-	    RROutput *retoutputid,
-	    XRROutputInfo **retoutput)
+find_output (Display *display,
+	     Window root,
+	     XRRScreenResources *res,
+	     XRROutputInfo **infos,
+	     const char *outname)
 {
-  int ret;
-  int screen;
-  const char *outname;
-
-  ret = get_argval (argc, argv, "output", funcname, usage, "", &outname);
-  if (ret == EXIT_FAILURE) {
-    return ret;
-  }
+  int o;
 
-  ret = get_screen (display, argc, argv, funcname, usage, &screen);
-  if (ret != EXIT_FAILURE) {
-    XRRScreenResources *res;
-    Window root;
-    int outnum;
-
-    root = RootWindow (display, screen);
-    res = XRRGetScreenResourcesCurrent (display, root);
-
-    *retoutput = NULL;
-    if (strlen (outname) == 0) {
-      outnum = XRRGetOutputPrimary (display, root);
-      if (!check_output (res, outnum)) {
-	outnum = res->outputs[0];
+  o = -1;
+  if (res->noutput == 0) {
+    fprintf (stderr, "No outputs available\n");
+  } else if (strlen (outname) == 0) {
+    RROutput primary;
+    XPROF (display, "XRRGetOutputPrimary",
+	   primary = XRRGetOutputPrimary (display, root));
+    /* Fall back to the first output if there is no primary one */
+    for (o = res->noutput - 1; o > 0; o--) {
+      if (res->outputs[o] == primary) {
+	break;
       }
-      *retoutput = XRRGetOutputInfo (display, res, outnum);
-      *retoutputid = outnum;
-    } else {
-      char *endptr;
-      outnum = (int) strtol (outname, &endptr, 0);
-      if (endptr != NULL && strlen (endptr) != 0) {
-	int o;
-	ret = EXIT_FAILURE;
-	for (o = 0; o < res->noutput; o++) {
-	  XRROutputInfo *out = XRRGetOutputInfo (display, res, res->outputs[o]);
-	  if (strncmp (out->name, outname, 256) == 0) {
-	    *retoutput = out;
-      	    *retoutputid = res->outputs[o];
-	    ret = EXIT_SUCCESS;
-	  } else {
-	    XRRFreeOutputInfo (out);
-	  }
+    }
+  } else {
+    char *endptr;
+    RROutput outnum;
+    outnum = (RROutput) strtol (outname, &endptr, 0);
+    if (endptr != NULL && strlen (endptr) != 0) {
+      for (o = 0; o < res->noutput; o++) {
+	if (!infos[o]) {
+	  XPROF (display, "XRRGetOutputInfo",
+		 infos[o] = XRRGetOutputInfo (display, res, res->outputs[o]));
 	}
-	if (*retoutput == NULL) {
-	  fprintf (stderr, "Output '%s' not found\n", outname);
-	  ret = EXIT_FAILURE;
+	if (strncmp (infos[o]->name, outname, 256) == 0) {
+	  break;
 	}
-      } else {
-	if (check_output (res, outnum)) {
-	  *retoutput = XRRGetOutputInfo (display, res, outnum);
-	  *retoutputid = outnum;
-	} else {
-	  fprintf (stderr, "Output with id=%i not found\n", outnum);
-	  ret = EXIT_FAILURE;
+      }
+      if (o == res->noutput) {
+	fprintf (stderr, "Output '%s' not found\n", outname);
+	o = -1;
+      }
+    } else {
+      for (o = 0; o < res->noutput; o++) {
+	if (res->outputs[o] == outnum) {
+	  break;
 	}
       }
+      if (o == res->noutput) {
+	fprintf (stderr, "Output with id=%i not found\n", (int) outnum);
+	o = -1;
+      }
     }
-    XRRFreeScreenResources (res);
   }
 
+  if (o >= 0 && !infos[o]) {
+    XPROF (display, "XRRGetOutputInfo",
+	   infos[o] = XRRGetOutputInfo (display, res, res->outputs[o]));
+  }
+
+  return o;
+}
+
+void
+free_output_infos (XRRScreenResources *res,
+		   XRROutputInfo **infos)
+{
+  int o;
+
+  for (o = 0; o < res->noutput; o++) {
+    if (infos[o]) {
+      XRRFreeOutputInfo (infos[o]);
+    }
+  }
+  free (infos);
+}
+
+int
+get_output (Display *display,
+	    const options *opts,
+	    RROutput *retoutputid,
+	    XRROutputInfo **retoutput)
+{
+  XRRScreenResources *res;
+  XRROutputInfo **infos;
+  const char *outname;
+  Window root;
+  int ret = EXIT_SUCCESS;
+  int o;
+
+  outname = opts->noutputs > 0 ? opts->outputs[0] : "";
+
+  root = RootWindow (display, opts->screen);
+  XPROF (display, "XRRGetScreenResourcesCurrent",
+	 res = XRRGetScreenResourcesCurrent (display, root));
+  infos = calloc (res->noutput, sizeof (XRROutputInfo *));
+
+  *retoutput = NULL;
+  o = find_output (display, root, res, infos, outname);
+  if (o >= 0) {
+    *retoutput = infos[o];
+    *retoutputid = res->outputs[o];
+    infos[o] = NULL;
+  } else {
+    ret = EXIT_FAILURE;
+  }
+
+  free_output_infos (res, infos);
+  XRRFreeScreenResources (res);
+
   return ret;
 }
 
+/* The script runs of the thread (a daemon per display) */
+static __thread unsigned long script_runs;
+static __thread unsigned long script_failures;
+static __thread double script_seconds;
+
 int
 run_script (const char *script)
 {
@@ -199,10 +359,18 @@ run_script (const char *script)
   int retcode;
 
   if (script != NULL && strlen (script) > 0) {
-    if ((retcode = system (script)) == 0) {
+    struct timespec start, end;
+
+    clock_gettime (CLOCK_MONOTONIC, &start);
+    retcode = system (script);
+    clock_gettime (CLOCK_MONOTONIC, &end);
+    script_runs++;
+    script_seconds += (end.tv_sec - start.tv_sec) + (end.tv_nsec - start.tv_nsec) / 1e9;
+    if (retcode == 0) {
       ret = EXIT_SUCCESS;
     } else {
       ret = EXIT_FAILURE;
+      script_failures++;
       fprintf (stderr, "Error running `%s` (%i)\n", script, retcode);
     }
   } else {
@@ -211,3 +379,251 @@ run_script (const char *script)
 
   return ret;
 }
+
+void
+script_stats (unsigned long *runs,
+	      unsigned long *failures,
+	      double *seconds)
+{
+  *runs = script_runs;
+  *failures = script_failures;
+  *seconds = script_seconds;
+}
+
+static char *
+strip (char *str)
+{
+  char *end;
+
+  while (isspace (*str)) {
+    str++;
+  }
+  end = str + strlen (str);
+  while (end > str && isspace (*(end - 1))) {
+    *(--end) = '\0';
+  }
+
+  return str;
+}
+
+char *
+read_quoted (char **str)
+{
+  char *val, *end;
+
+  while (isspace (**str)) {
+    (*str)++;
+  }
+  if (**str != '"' || !(end = strchr (*str + 1, '"')) || end == *str + 1) {
+    return NULL;
+  }
+
+  val = *str + 1;
+  *end = '\0';
+  *str = end + 1;
+
+  return val;
+}
+
+/* The keys of the binding options */
+static const char *const binding_keys[] = { "pre", "post" };
+
+/* Tells if one of the keys followed by ':' starts at q */
+static int
+is_binding_key (const char *q)
+{
+  int i;
+
+  for (i = 0; i < sizeof (binding_keys) / sizeof (binding_keys[0]); i++) {
+    size_t len = strlen (binding_keys[i]);
+    if (strncmp (q, binding_keys[i], len) == 0 && q[len] == ':') {
+      return 1;
+    }
+  }
+
+  return 0;
+}
+
+/* Parses the "key:value key:value" tail of a binding line. A value
+   extends up to the next key, so it may contain spaces and words
+   such as "status:ok" or "http:" that are not keys. */
+static void
+read_options (char *tail, binding *b)
+{
+  char *key, *val, *p;
+
+  key = NULL;
+  val = NULL;
+  p = tail;
+  while (1) {
+    char *next = NULL;
+    char *q;
+
+    /* Look for the next "key:" at a word start */
+    for (q = p; *q; q++) {
+      if ((q == tail || isspace (*(q - 1))) && is_binding_key (q)) {
+	next = q;
+	break;
+      }
+    }
+
+    /* Nothing but the keys is expected before the first one */
+    if (!key && next != tail) {
+      if (next) {
+	*(next - 1) = '\0';
+      }
+      val = strip (tail);
+      if (*val) {
+	fprintf (stderr, "Unknown binding options ignored: %s\n", val);
+      }
+    }
+
+    if (key) {
+      if (next) {
+	*(next - 1) = '\0';
+      }
+      val = strip (val);
+      if (strcmp (key, "pre") == 0) {
+	free (b->pre_script);
+	b->pre_script = strdup (val);
+      } else if (strcmp (key, "post") == 0) {
+	free (b->post_script);
+	b->post_script = strdup (val);
+      }
+    }
+
+    if (!next) {
+      break;
+    }
+    key = next;
+    val = strchr (next, ':');
+    *(val++) = '\0';
+    p = val;
+  }
+}
+
+int
+read_bindings (const char *filename,
+	       const char *pre_script,
+	       const char *post_script,
+	       binding **retbindings,
+	       int *retcount)
+{
+  FILE *f;
+  char line[1024];
+  int lineno;
+  binding *bindings;
+  int count, size;
+
+  f = fopen (filename, "r");
+  if (!f) {
+    perror (filename);
+    return EXIT_FAILURE;
+  }
+
+  bindings = NULL;
+  count = size = 0;
+  lineno = 0;
+  while (fgets (line, sizeof (line), f)) {
+    char *p = line;
+    char *output, *input;
+
+    lineno++;
+    while (isspace (*p)) {
+      p++;
+    }
+    if (*p != '"') {
+      continue;
+    }
+
+    output = read_quoted (&p);
+    input = output ? read_quoted (&p) : NULL;
+    if (!input) {
+      fprintf (stderr, "%s:%i: invalid binding, skipped\n", filename, lineno);
+      continue;
+    }
+
+    if (count == size) {
+      size = size ? 2 * size : 8;
+      bindings = realloc (bindings, size * sizeof (binding));
+    }
+    bindings[count].output = strdup (output);
+    bindings[count].input = strdup (input);
+    bindings[count].pre_script = strdup (pre_script);
+    bindings[count].post_script = strdup (post_script);
+    read_options (p, &bindings[count]);
+    count++;
+  }
+  fclose (f);
+
+  *retbindings = bindings;
+  *retcount = count;
+
+  return EXIT_SUCCESS;
+}
+
+/* Collects the output/input bindings either from the configuration
+   file (--all --config=FILE) or from the --output and --input
+   options. */
+int
+get_bindings (const options *opts,
+	      binding **retbindings,
+	      int *retcount)
+{
+  binding *bindings;
+  int count;
+  int ret;
+
+  if (opts->all) {
+    if (strlen (opts->config) == 0) {
+      return usage_error (opts);
+    }
+    ret = read_bindings (opts->config, opts->pre_script, opts->post_script, &bindings, &count);
+    if (ret == EXIT_FAILURE) {
+      return ret;
+    }
+  } else {
+    int noutputs = opts->noutputs;
+    int ninputs = opts->ninputs;
+    int i;
+
+    /* The k-th output goes with the k-th input. A single output
+       (or input) is shared by all the inputs (or outputs). */
+    count = noutputs > ninputs ? noutputs : ninputs;
+    if (count == 0) {
+      count = 1;
+    }
+    if ((noutputs > 1 && noutputs != count) ||
+	(ninputs > 1 && ninputs != count)) {
+      return usage_error (opts);
+    }
+
+    bindings = calloc (count, sizeof (binding));
+    for (i = 0; i < count; i++) {
+      bindings[i].output = strdup (noutputs == 0 ? "" : opts->outputs[noutputs > 1 ? i : 0]);
+      bindings[i].input = strdup (ninputs == 0 ? "Virtual core pointer" : opts->inputs[ninputs > 1 ? i : 0]);
+      bindings[i].pre_script = strdup (opts->pre_script);
+      bindings[i].post_script = strdup (opts->post_script);
+    }
+  }
+
+  *retbindings = bindings;
+  *retcount = count;
+
+  return EXIT_SUCCESS;
+}
+
+void
+free_bindings (binding *bindings,
+	       int count)
+{
+  int i;
+
+  for (i = 0; i < count; i++) {
+    free (bindings[i].output);
+    free (bindings[i].input);
+    free (bindings[i].pre_script);
+    free (bindings[i].post_script);
+  }
+  free (bindings);
+}
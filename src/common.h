@@ -46,25 +46,114 @@ get_argval (int argc,
 	    const char **outval);
 
 int
-get_screen (Display *display,
-	    int argc,
-	    const char *argv[],
-	    const char *funcname,
-	    const char *usage,
-	    int *retscreen);
+get_argvals (int argc,
+	     const char *argv[],
+	     const char *argname,
+	     const char *funcname,
+	     const char *usage,
+	     const char **outvals,
+	     int *count);
+
+int
+get_argflag (int argc,
+	     const char *argv[],
+	     const char *argname);
+
+/* The options shared by the functions. They are parsed once before
+   the function is called; the function specific ones are read from
+   the kept argv. */
+typedef struct
+{
+  int argc;
+  const char **argv;
+  const char *funcname;
+  const char *usage;
+  int screen;		/* the given or the default screen */
+  int all_screens;	/* --screen=all */
+  const char **outputs;
+  int noutputs;
+  const char **inputs;
+  int ninputs;
+  const char *pre_script;
+  const char *post_script;
+  const char *config;
+  const char *state;
+  const char *calibration;	/* the calibration file, "" for the default */
+  int all;
+  int autobind;
+  int no_state;
+} options;
+
+int
+parse_options (Display *display,
+	       int argc,
+	       const char *argv[],
+	       const char *funcname,
+	       const char *usage,
+	       options *opts);
+
+void
+free_options (options *opts);
+
+int
+usage_error (const options *opts);
 
 int
 check_output (XRRScreenResources *res,
 	      int outid);
 
+int
+find_output (Display *display,
+	     Window root,
+	     XRRScreenResources *res,
+	     XRROutputInfo **infos,
+	     const char *outname);
+
+void
+free_output_infos (XRRScreenResources *res,
+		   XRROutputInfo **infos);
+
 int
 get_output (Display *display,
-	    int	argc,
-	    const char *argv[],
-	    const char *funcname,
-	    const char *usage,
+	    const options *opts,
 	    RROutput *retoutputid,
 	    XRROutputInfo **retoutput);
 
 int
 run_script (const char *script);
+
+void
+script_stats (unsigned long *runs,
+	      unsigned long *failures,
+	      double *seconds);
+
+/* An output/input pair as listed in the monitor configuration file:
+ *
+ *   "OUTPUT" "INPUT" [pre:PRE-SCRIPT] [post:POST-SCRIPT]
+ */
+typedef struct
+{
+  char *output;
+  char *input;
+  char *pre_script;
+  char *post_script;
+} binding;
+
+char *
+read_quoted (char **str);
+
+int
+read_bindings (const char *filename,
+	       const char *pre_script,
+	       const char *post_script,
+	       binding **retbindings,
+	       int *retcount);
+
+int
+get_bindings (const options *opts,
+	      binding **retbindings,
+	      int *retcount);
+
+void
+free_bindings (binding *bindings,
+	       int count);
@@ -0,0 +1,457 @@
+/*
+ * Original xinput:
+ * Copyright 1996 by Frederic Lepied, France. <Frederic.Lepied@sugix.frmug.org>
+ *
+ * Original xrandr:
+ * Copyright © 2001 Keith Packard, member of The XFree86 Project, Inc.
+ * Copyright © 2002 Hewlett Packard Company, Inc.
+ * Copyright © 2006 Intel Corporation
+ *
+ * xrandr-align:
+ *
+ * Copyright © 2012 Paul Wolneykien <manowar@altlinux.org>, ALT Linux Ltd.
+ *
+ * Permission to use, copy, modify, distribute, and sell this software and its
+ * documentation for any purpose is  hereby granted without fee, provided that
+ * the  above copyright   notice appear  in   all  copies and  that both  that
+ * copyright  notice   and   this  permission   notice  appear  in  supporting
+ * documentation, and that   the  name of  the authors  not  be  used  in
+ * advertising or publicity pertaining to distribution of the software without
+ * specific,  written      prior  permission.     The authors  make  no
+ * representations about the suitability of this software for any purpose.  It
+ * is provided "as is" without express or implied warranty.
+ *
+ * THE AUTHORS DISCLAIM ALL   WARRANTIES WITH REGARD  TO  THIS SOFTWARE,
+ * INCLUDING ALL IMPLIED   WARRANTIES OF MERCHANTABILITY  AND   FITNESS, IN NO
+ * EVENT  SHALL THE AUTHORS  BE   LIABLE   FOR ANY  SPECIAL, INDIRECT   OR
+ * CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM LOSS OF USE,
+ * DATA  OR PROFITS, WHETHER  IN  AN ACTION OF  CONTRACT,  NEGLIGENCE OR OTHER
+ * TORTIOUS  ACTION, ARISING    OUT OF OR   IN  CONNECTION  WITH THE USE    OR
+ * PERFORMANCE OF THIS SOFTWARE.
+ *
+ */
+
+#include "common.h"
+#include "xrandr-align.h"
+#include "control.h"
+#include "trace.h"
+#include <errno.h>
+#include <signal.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/select.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/time.h>
+#include <sys/un.h>
+
+/* ${XDG_RUNTIME_DIR:-/tmp/xrandr-align-UID}/xrandr-align/DAEMON-DISPLAY */
+int
+control_path (Display *display,
+	      const char *daemon,
+	      char *path,
+	      size_t size)
+{
+  const char *runtime = getenv ("XDG_RUNTIME_DIR");
+  const char *dpy;
+  struct stat st;
+  char *p;
+  int len;
+
+  if (runtime && strlen (runtime) > 0) {
+    len = snprintf (path, size, "%s/xrandr-align", runtime);
+  } else {
+    len = snprintf (path, size, "/tmp/xrandr-align-%u", (unsigned int) getuid ());
+  }
+  if (len >= size) {
+    return EXIT_FAILURE;
+  }
+  if (mkdir (path, 0700) != 0 && errno != EEXIST) {
+    perror (path);
+    return EXIT_FAILURE;
+  }
+
+  /* The /tmp one may be made by another user first: trust only a
+     real directory of ours, closed to the others */
+  if (lstat (path, &st) != 0) {
+    perror (path);
+    return EXIT_FAILURE;
+  }
+  if (!S_ISDIR (st.st_mode) || st.st_uid != getuid () ||
+      (st.st_mode & 0777) != 0700) {
+    fprintf (stderr, "%s is not a private directory of the user\n", path);
+    return EXIT_FAILURE;
+  }
+
+  dpy = display ? DisplayString (display) : getenv ("DISPLAY");
+  p = path + len;
+  len += snprintf (p, size - len, "/%s-%s", daemon, dpy ? dpy : "");
+  if (len >= size) {
+    return EXIT_FAILURE;
+  }
+  for (p++; *p; p++) {
+    if (*p == '/') {
+      *p = '_';
+    }
+  }
+
+  return EXIT_SUCCESS;
+}
+
+/* The daemon part of the socket name: DAEMON or DAEMON-NAME with
+   --name=NAME, for the processes of the same display */
+int
+control_name (const options *opts,
+	      const char *daemon,
+	      char *name,
+	      size_t size)
+{
+  const char *namearg;
+
+  if (get_argval (opts->argc, opts->argv, "name", opts->funcname, opts->usage, NULL, &namearg) == EXIT_FAILURE) {
+    return EXIT_FAILURE;
+  }
+  if (snprintf (name, size, namearg ? "%s-%s" : "%s", daemon, namearg) >= size) {
+    fprintf (stderr, "The daemon name is too long: %s\n", namearg);
+    return EXIT_FAILURE;
+  }
+
+  return EXIT_SUCCESS;
+}
+
+static int
+control_connect (const char *path)
+{
+  struct sockaddr_un addr;
+  int fd;
+
+  fd = socket (AF_UNIX, SOCK_STREAM, 0);
+  if (fd < 0) {
+    return -1;
+  }
+
+  memset (&addr, 0, sizeof (addr));
+  addr.sun_family = AF_UNIX;
+  snprintf (addr.sun_path, sizeof (addr.sun_path), "%s", path);
+  if (connect (fd, (struct sockaddr *) &addr, sizeof (addr)) != 0) {
+    close (fd);
+    return -1;
+  }
+
+  return fd;
+}
+
+/* Opens the control socket of the daemon unless --no-control is
+   given. The daemon runs on without it if the socket can't be made. */
+control_server *
+control_open (context *ctx,
+	      const char *daemon,
+	      control_handler handler,
+	      void *data)
+{
+  const options *opts = &ctx->opts;
+  control_server *srv;
+  struct sockaddr_un addr;
+  const char *patharg;
+  char name[64];
+  struct sigaction sa;
+  int fd;
+  int ret;
+
+  if (get_argflag (opts->argc, opts->argv, "no-control")) {
+    return NULL;
+  }
+  if (get_argval (opts->argc, opts->argv, "control", opts->funcname, opts->usage, "", &patharg) == EXIT_FAILURE ||
+      control_name (opts, daemon, name, sizeof (name)) == EXIT_FAILURE) {
+    return NULL;
+  }
+
+  srv = calloc (1, sizeof (control_server));
+  srv->fd = -1;
+  srv->handler = handler;
+  srv->data = data;
+
+  if (strlen (patharg) > 0) {
+    if (strlen (patharg) >= sizeof (srv->path)) {
+      fprintf (stderr, "The control socket path is too long: %s\n", patharg);
+      free (srv);
+      return NULL;
+    }
+    snprintf (srv->path, sizeof (srv->path), "%s", patharg);
+  } else if (control_path (ctx->display, name, srv->path, sizeof (srv->path)) == EXIT_FAILURE) {
+    fprintf (stderr, "Unable to locate the control socket\n");
+    free (srv);
+    return NULL;
+  }
+
+  /* A stale socket is left by a daemon killed before, a live one
+     belongs to another daemon */
+  fd = control_connect (srv->path);
+  if (fd >= 0) {
+    fprintf (stderr, "Another daemon listens on %s: control disabled\n", srv->path);
+    close (fd);
+    free (srv);
+    return NULL;
+  }
+  unlink (srv->path);
+
+  fd = socket (AF_UNIX, SOCK_STREAM, 0);
+  memset (&addr, 0, sizeof (addr));
+  addr.sun_family = AF_UNIX;
+  snprintf (addr.sun_path, sizeof (addr.sun_path), "%s", srv->path);
+
+  /* The umask is shared by the threads of the other displays: the
+     socket is made in the private directory and closed to the others
+     before it listens */
+  ret = -1;
+  if (fd >= 0) {
+    ret = bind (fd, (struct sockaddr *) &addr, sizeof (addr));
+  }
+  if (ret != 0 || chmod (srv->path, 0600) != 0 || listen (fd, 4) != 0) {
+    perror (srv->path);
+    if (fd >= 0) {
+      close (fd);
+    }
+    if (ret == 0) {
+      unlink (srv->path);
+    }
+    free (srv);
+    return NULL;
+  }
+
+  /* A client gone before its reply must not kill the daemon: the
+     write fails with EPIPE instead */
+  memset (&sa, 0, sizeof (sa));
+  sigemptyset (&sa.sa_mask);
+  sa.sa_handler = SIG_IGN;
+  sigaction (SIGPIPE, &sa, NULL);
+
+  srv->fd = fd;
+  if (ctx->verbose) {
+    fprintf (stderr, "Control socket: %s\n", srv->path);
+  }
+
+  return srv;
+}
+
+void
+control_close (control_server *srv)
+{
+  if (!srv) {
+    return;
+  }
+
+  close (srv->fd);
+  unlink (srv->path);
+  free (srv);
+}
+
+/* Splits the command line in place */
+int
+control_split_args (char *line,
+		    char *argv[])
+{
+  int argc = 0;
+  char *tok, *save;
+
+  for (tok = strtok_r (line, " \t\r\n", &save); tok && argc < CONTROL_ARGS_MAX;
+       tok = strtok_r (NULL, " \t\r\n", &save)) {
+    argv[argc++] = tok;
+  }
+
+  return argc;
+}
+
+/* Serves one client: a single command per connection. A client
+   stalling for more than a second is dropped. */
+void
+control_serve (control_server *srv)
+{
+  struct timeval tv = { 1, 0 };
+  char line[CONTROL_LINE_MAX];
+  char *argv[CONTROL_ARGS_MAX];
+  FILE *in, *out;
+  int argc;
+  int fd;
+
+  fd = accept (srv->fd, NULL, NULL);
+  if (fd < 0) {
+    return;
+  }
+  setsockopt (fd, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof (tv));
+  setsockopt (fd, SOL_SOCKET, SO_SNDTIMEO, &tv, sizeof (tv));
+
+  in = fdopen (fd, "r");
+  out = fdopen (dup (fd), "w");
+  if (!in || !out) {
+    if (in) {
+      fclose (in);
+    } else {
+      close (fd);
+    }
+    if (out) {
+      fclose (out);
+    }
+    return;
+  }
+
+  if (fgets (line, sizeof (line), in)) {
+    argc = control_split_args (line, argv);
+    srv->commands++;
+    if (argc == 0) {
+      fprintf (out, "ERR empty command\n");
+    } else if (strcmp (argv[0], "ping") == 0) {
+      fprintf (out, "OK\n");
+    } else if (strcmp (argv[0], "trace-dump") == 0) {
+      if (argc < 2) {
+	trace_print (out);
+	fprintf (out, "OK\n");
+      } else if (trace_dump (argv[1]) == EXIT_SUCCESS) {
+	fprintf (out, "OK\n");
+      } else {
+	fprintf (out, "ERR unable to write %s\n", argv[1]);
+      }
+    } else if (srv->handler (srv->data, argc, argv, out) == EXIT_FAILURE) {
+      fprintf (out, "ERR\n");
+    } else {
+      fprintf (out, "OK\n");
+    }
+  }
+
+  fclose (out);
+  fclose (in);
+}
+
+/* Waits for the next X event serving the control clients
+   meanwhile. Returns 1 with the event read, 0 if one of the nfds
+   additional descriptors (-1 for none) has become readable first or
+   if the data read from the X connection had no events (errors). */
+int
+control_next_event (control_server *srv,
+		    Display *display,
+		    const int *extra,
+		    int nfds,
+		    XEvent *event)
+{
+  int xfd = ConnectionNumber (display);
+  int i;
+
+  while (!XPending (display)) {
+    fd_set fds;
+    int maxfd = xfd;
+
+    FD_ZERO (&fds);
+    FD_SET (xfd, &fds);
+    if (srv) {
+      FD_SET (srv->fd, &fds);
+      if (srv->fd > maxfd) {
+	maxfd = srv->fd;
+      }
+    }
+    for (i = 0; i < nfds; i++) {
+      if (extra[i] >= 0) {
+	FD_SET (extra[i], &fds);
+	if (extra[i] > maxfd) {
+	  maxfd = extra[i];
+	}
+      }
+    }
+    if (select (maxfd + 1, &fds, NULL, NULL, NULL) < 0) {
+      if (errno == EINTR) {
+	continue;
+      }
+      break;
+    }
+    if (srv && FD_ISSET (srv->fd, &fds)) {
+      control_serve (srv);
+    }
+    for (i = 0; i < nfds; i++) {
+      if (extra[i] >= 0 && FD_ISSET (extra[i], &fds)) {
+	return 0;
+      }
+    }
+    if (FD_ISSET (xfd, &fds)) {
+      if (!XPending (display)) {
+	return 0;
+      }
+      break;
+    }
+  }
+
+  XNextEvent (display, event);
+  return 1;
+}
+
+/* The client: sends the command to the daemon and prints the reply */
+int
+control (context *ctx)
+{
+  const options *opts = &ctx->opts;
+  const char *daemon;
+  const char *patharg;
+  char name[64];
+  char path[108];
+  char line[CONTROL_LINE_MAX];
+  FILE *in, *out;
+  int fd;
+  int i, n;
+  int ret = EXIT_FAILURE;
+
+  if (get_argval (opts->argc, opts->argv, "daemon", opts->funcname, opts->usage, "monitor", &daemon) == EXIT_FAILURE ||
+      get_argval (opts->argc, opts->argv, "control", opts->funcname, opts->usage, "", &patharg) == EXIT_FAILURE ||
+      control_name (opts, daemon, name, sizeof (name)) == EXIT_FAILURE) {
+    return EXIT_FAILURE;
+  }
+
+  if (strlen (patharg) > 0) {
+    snprintf (path, sizeof (path), "%s", patharg);
+  } else if (control_path (ctx->display, name, path, sizeof (path)) == EXIT_FAILURE) {
+    fprintf (stderr, "Unable to locate the control socket\n");
+    return EXIT_FAILURE;
+  }
+
+  /* The command is made of the non-option arguments */
+  n = 0;
+  line[0] = '\0';
+  for (i = 0; i < opts->argc; i++) {
+    if (strncmp (opts->argv[i], "--", 2) != 0) {
+      n += snprintf (line + n, sizeof (line) - n, "%s%s", n ? " " : "", opts->argv[i]);
+      if (n >= sizeof (line) - 1) {
+	fprintf (stderr, "The command is too long\n");
+	return EXIT_FAILURE;
+      }
+    }
+  }
+  if (n == 0) {
+    return usage_error (opts);
+  }
+
+  fd = control_connect (path);
+  if (fd < 0) {
+    perror (path);
+    return EXIT_FAILURE;
+  }
+
+  out = fdopen (fd, "w");
+  fprintf (out, "%s\n", line);
+  fflush (out);
+  in = fdopen (dup (fd), "r");
+  while (in && fgets (line, sizeof (line), in)) {
+    if (strcmp (line, "OK\n") == 0) {
+      ret = EXIT_SUCCESS;
+      break;
+    } else if (strncmp (line, "ERR", 3) == 0) {
+      fputs (line, stderr);
+      break;
+    }
+    fputs (line, stdout);
+  }
+  if (in) {
+    fclose (in);
+  }
+  fclose (out);
+
+  return ret;
+}
+
+/* end of control.c */
@@ -0,0 +1,106 @@
+/*
+ * Original xinput:
+ * Copyright 1996 by Frederic Lepied, France. <Frederic.Lepied@sugix.frmug.org>
+ *
+ * Original xrandr:
+ * Copyright © 2001 Keith Packard, member of The XFree86 Project, Inc.
+ * Copyright © 2002 Hewlett Packard Company, Inc.
+ * Copyright © 2006 Intel Corporation
+ *
+ * xrandr-align:
+ *
+ * Copyright © 2012 Paul Wolneykien <manowar@altlinux.org>, ALT Linux Ltd.
+ *
+ * Permission to use, copy, modify, distribute, and sell this software and its
+ * documentation for any purpose is  hereby granted without fee, provided that
+ * the  above copyright   notice appear  in   all  copies and  that both  that
+ * copyright  notice   and   this  permission   notice  appear  in  supporting
+ * documentation, and that   the  name of  the authors  not  be  used  in
+ * advertising or publicity pertaining to distribution of the software without
+ * specific,  written      prior  permission.     The authors  make  no
+ * representations about the suitability of this software for any purpose.  It
+ * is provided "as is" without express or implied warranty.
+ *
+ * THE AUTHORS DISCLAIM ALL   WARRANTIES WITH REGARD  TO  THIS SOFTWARE,
+ * INCLUDING ALL IMPLIED   WARRANTIES OF MERCHANTABILITY  AND   FITNESS, IN NO
+ * EVENT  SHALL THE AUTHORS  BE   LIABLE   FOR ANY  SPECIAL, INDIRECT   OR
+ * CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM LOSS OF USE,
+ * DATA  OR PROFITS, WHETHER  IN  AN ACTION OF  CONTRACT,  NEGLIGENCE OR OTHER
+ * TORTIOUS  ACTION, ARISING    OUT OF OR   IN  CONNECTION  WITH THE USE    OR
+ * PERFORMANCE OF THIS SOFTWARE.
+ *
+ */
+
+/*
+ * Local control socket.
+ *
+ * A running daemon (monitor, gravitate) listens on a Unix stream
+ * socket, by default $XDG_RUNTIME_DIR/xrandr-align/DAEMON-DISPLAY.
+ * A client sends one command line per connection:
+ *
+ *   COMMAND [ARG]...\n
+ *
+ * and reads the reply lines up to the terminating "OK" or "ERR"
+ * line. The commands are served between the X events, so no command
+ * can race with an alignment in progress.
+ *
+ * The processes of a daemon serving the same display (gravitate runs
+ * one per sensor) are given distinct names with --name=NAME, both on
+ * the daemon and the control side: DAEMON-NAME-DISPLAY.
+ */
+
+#define CONTROL_LINE_MAX 512
+#define CONTROL_ARGS_MAX 8
+
+/* Writes the reply to out and returns EXIT_SUCCESS or EXIT_FAILURE */
+typedef int (*control_handler) (void *data,
+				int argc,
+				char *argv[],
+				FILE *out);
+
+typedef struct
+{
+  int fd;
+  char path[108];
+  control_handler handler;
+  void *data;
+  unsigned long commands;
+} control_server;
+
+int
+control_path (Display *display,
+	      const char *daemon,
+	      char *path,
+	      size_t size);
+
+int
+control_name (const options *opts,
+	      const char *daemon,
+	      char *name,
+	      size_t size);
+
+control_server *
+control_open (context *ctx,
+	      const char *daemon,
+	      control_handler handler,
+	      void *data);
+
+void
+control_close (control_server *srv);
+
+int
+control_split_args (char *line,
+		    char *argv[]);
+
+void
+control_serve (control_server *srv);
+
+int
+control_next_event (control_server *srv,
+		    Display *display,
+		    const int *extra,
+		    int nfds,
+		    XEvent *event);
+
+int
+control (context *ctx);
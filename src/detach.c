@@ -0,0 +1,224 @@
+/*
+ * Original xinput:
+ * Copyright 1996 by Frederic Lepied, France. <Frederic.Lepied@sugix.frmug.org>
+ *
+ * Original xrandr:
+ * Copyright © 2001 Keith Packard, member of The XFree86 Project, Inc.
+ * Copyright © 2002 Hewlett Packard Company, Inc.
+ * Copyright © 2006 Intel Corporation
+ *
+ * xrandr-align:
+ *
+ * Copyright © 2012 Paul Wolneykien <manowar@altlinux.org>, ALT Linux Ltd.
+ *
+ * Permission to use, copy, modify, distribute, and sell this software and its
+ * documentation for any purpose is  hereby granted without fee, provided that
+ * the  above copyright   notice appear  in   all  copies and  that both  that
+ * copyright  notice   and   this  permission   notice  appear  in  supporting
+ * documentation, and that   the  name of  the authors  not  be  used  in
+ * advertising or publicity pertaining to distribution of the software without
+ * specific,  written      prior  permission.     The authors  make  no
+ * representations about the suitability of this software for any purpose.  It
+ * is provided "as is" without express or implied warranty.
+ *
+ * THE AUTHORS DISCLAIM ALL   WARRANTIES WITH REGARD  TO  THIS SOFTWARE,
+ * INCLUDING ALL IMPLIED   WARRANTIES OF MERCHANTABILITY  AND   FITNESS, IN NO
+ * EVENT  SHALL THE AUTHORS  BE   LIABLE   FOR ANY  SPECIAL, INDIRECT   OR
+ * CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM LOSS OF USE,
+ * DATA  OR PROFITS, WHETHER  IN  AN ACTION OF  CONTRACT,  NEGLIGENCE OR OTHER
+ * TORTIOUS  ACTION, ARISING    OUT OF OR   IN  CONNECTION  WITH THE USE    OR
+ * PERFORMANCE OF THIS SOFTWARE.
+ *
+ */
+#include "common.h"
+#include "xrandr-align.h"
+#include "profile.h"
+#include "control.h"
+#include "xerror.h"
+#include "detach.h"
+#include <string.h>
+#include <unistd.h>
+
+#if HAVE_XI2
+/* Returns the device info, NULL if there is no such device */
+static XIDeviceInfo *
+query_device (Display *display,
+	      int deviceid)
+{
+  XIDeviceInfo *info;
+  int n;
+
+  /* A missing device is not worth a report */
+  xerror_track (display, NextRequest (display), None);
+  XPROF (display, "XIQueryDevice",
+	 info = XIQueryDevice (display, deviceid, &n));
+
+  return info;
+}
+
+/* Attaches the slave to the master, or floats it if master is 0 */
+static int
+change_attachment (Display *display,
+		   int deviceid,
+		   int master)
+{
+  XIAnyHierarchyChangeInfo change;
+  XID failed;
+
+  if (master) {
+    change.attach.type = XIAttachSlave;
+    change.attach.deviceid = deviceid;
+    change.attach.new_master = master;
+  } else {
+    change.detach.type = XIDetachSlave;
+    change.detach.deviceid = deviceid;
+  }
+
+  xerror_track (display, NextRequest (display), deviceid);
+  XPROF (display, "XIChangeHierarchy",
+	 XIChangeHierarchy (display, &change, 1));
+  XPROF (display, "XSync", XSync (display, False));
+
+  return xerror_failed (display, &failed, 1) ? EXIT_FAILURE : EXIT_SUCCESS;
+}
+#endif
+
+/* Attaches the sensor floated by a crashed run back to its master
+   and removes the recovery record */
+int
+detach_recover (context *ctx)
+{
+#if HAVE_XI2
+  Display *display = ctx->display;
+  XIDeviceInfo *info, *minfo;
+  char path[256];
+  char line[512];
+  char *p, *name;
+  int deviceid, master;
+  FILE *f;
+
+  if (!ctx->conn.xi2 ||
+      control_path (display, "float", path, sizeof (path)) == EXIT_FAILURE) {
+    return EXIT_SUCCESS;
+  }
+
+  f = fopen (path, "r");
+  if (!f) {
+    return EXIT_SUCCESS;
+  }
+  p = fgets (line, sizeof (line), f);
+  fclose (f);
+  unlink (path);
+
+  if (!p || !(name = read_quoted (&p)) ||
+      sscanf (p, "%i %i", &deviceid, &master) != 2) {
+    fprintf (stderr, "%s: invalid recovery record, removed\n", path);
+    return EXIT_FAILURE;
+  }
+
+  /* The IDs are reused: check the name and the roles */
+  info = query_device (display, deviceid);
+  minfo = query_device (display, master);
+  if (info && minfo &&
+      info->use == XIFloatingSlave && strcmp (info->name, name) == 0 &&
+      minfo->use == XIMasterPointer) {
+    if (change_attachment (display, deviceid, master) == EXIT_SUCCESS) {
+      fprintf (stderr, "Attached %s back to %s after an unclean exit\n", name, minfo->name);
+    } else {
+      fprintf (stderr, "Unable to attach %s back to %s\n", name, minfo->name);
+    }
+  }
+  if (info) {
+    XIFreeDeviceInfo (info);
+  }
+  if (minfo) {
+    XIFreeDeviceInfo (minfo);
+  }
+#endif
+
+  return EXIT_SUCCESS;
+}
+
+/* Floats the sensor if it is attached to a master pointer. The
+   recovery record is written first, so a crash right after the
+   detachment is recovered too. */
+int
+detach_float (context *ctx,
+	      XID deviceid,
+	      detach_record *rec)
+{
+#if HAVE_XI2
+  Display *display = ctx->display;
+  XIDeviceInfo *info;
+  FILE *f;
+  int ret = EXIT_SUCCESS;
+#endif
+
+  memset (rec, 0, sizeof (detach_record));
+
+#if HAVE_XI2
+  if (!ctx->conn.xi2) {
+    return EXIT_SUCCESS;
+  }
+
+  info = query_device (display, deviceid);
+  if (!info) {
+    return EXIT_FAILURE;
+  }
+  if (info->use != XISlavePointer) {
+    /* A master or an already floating slave is left as it is */
+    XIFreeDeviceInfo (info);
+    return EXIT_SUCCESS;
+  }
+
+  if (control_path (display, "float", rec->path, sizeof (rec->path)) == EXIT_FAILURE ||
+      !(f = fopen (rec->path, "w"))) {
+    fprintf (stderr, "Unable to write the recovery record: the sensor is not floated\n");
+    XIFreeDeviceInfo (info);
+    return EXIT_FAILURE;
+  }
+  fprintf (f, "\"%s\" %i %i\n", info->name, info->deviceid, info->attachment);
+  if (fclose (f) != 0) {
+    ret = EXIT_FAILURE;
+  }
+
+  if (ret != EXIT_FAILURE) {
+    ret = change_attachment (display, deviceid, 0);
+  }
+  if (ret != EXIT_FAILURE) {
+    rec->deviceid = info->deviceid;
+    rec->master = info->attachment;
+    if (ctx->verbose) {
+      fprintf (stderr, "Floated %s (master %i)\n", info->name, rec->master);
+    }
+  } else {
+    fprintf (stderr, "Unable to float %s\n", info->name);
+    unlink (rec->path);
+  }
+  XIFreeDeviceInfo (info);
+
+  return ret;
+#else
+  return EXIT_SUCCESS;
+#endif
+}
+
+/* Attaches the floated sensor back and removes the recovery record */
+void
+detach_restore (context *ctx,
+		detach_record *rec)
+{
+#if HAVE_XI2
+  if (!rec->deviceid) {
+    return;
+  }
+
+  if (change_attachment (ctx->display, rec->deviceid, rec->master) == EXIT_FAILURE) {
+    fprintf (stderr, "Unable to attach the sensor back to its master\n");
+  }
+  unlink (rec->path);
+  rec->deviceid = 0;
+#endif
+}
+
+/* end of detach.c */
@@ -0,0 +1,64 @@
+/*
+ * Original xinput:
+ * Copyright 1996 by Frederic Lepied, France. <Frederic.Lepied@sugix.frmug.org>
+ *
+ * Original xrandr:
+ * Copyright © 2001 Keith Packard, member of The XFree86 Project, Inc.
+ * Copyright © 2002 Hewlett Packard Company, Inc.
+ * Copyright © 2006 Intel Corporation
+ *
+ * xrandr-align:
+ *
+ * Copyright © 2012 Paul Wolneykien <manowar@altlinux.org>, ALT Linux Ltd.
+ *
+ * Permission to use, copy, modify, distribute, and sell this software and its
+ * documentation for any purpose is  hereby granted without fee, provided that
+ * the  above copyright   notice appear  in   all  copies and  that both  that
+ * copyright  notice   and   this  permission   notice  appear  in  supporting
+ * documentation, and that   the  name of  the authors  not  be  used  in
+ * advertising or publicity pertaining to distribution of the software without
+ * specific,  written      prior  permission.     The authors  make  no
+ * representations about the suitability of this software for any purpose.  It
+ * is provided "as is" without express or implied warranty.
+ *
+ * THE AUTHORS DISCLAIM ALL   WARRANTIES WITH REGARD  TO  THIS SOFTWARE,
+ * INCLUDING ALL IMPLIED   WARRANTIES OF MERCHANTABILITY  AND   FITNESS, IN NO
+ * EVENT  SHALL THE AUTHORS  BE   LIABLE   FOR ANY  SPECIAL, INDIRECT   OR
+ * CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM LOSS OF USE,
+ * DATA  OR PROFITS, WHETHER  IN  AN ACTION OF  CONTRACT,  NEGLIGENCE OR OTHER
+ * TORTIOUS  ACTION, ARISING    OUT OF OR   IN  CONNECTION  WITH THE USE    OR
+ * PERFORMANCE OF THIS SOFTWARE.
+ *
+ */
+
+/*
+ * Floating of the gravity sensor.
+ *
+ * A sensor attached to a master pointer moves the cursor with each
+ * sample: the server renders the cursor, processes the crossings and
+ * delivers the motion to the clients at the sensor rate. gravitate
+ * detaches the sensor (a floating slave) for its run and attaches it
+ * back to the same master on exit. While the sensor is floating the
+ * original attachment is kept in a recovery record,
+ * $XDG_RUNTIME_DIR/xrandr-align/float-DISPLAY, so the next start
+ * attaches the sensor back after a crash.
+ */
+
+typedef struct
+{
+  int deviceid;		/* the floated sensor, 0 if none */
+  int master;		/* its original master pointer */
+  char path[256];	/* the recovery record */
+} detach_record;
+
+int
+detach_recover (context *ctx);
+
+int
+detach_float (context *ctx,
+	      XID deviceid,
+	      detach_record *rec);
+
+void
+detach_restore (context *ctx,
+		detach_record *rec);
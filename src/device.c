@@ -0,0 +1,361 @@
+/*
+ * Original xinput:
+ * Copyright 1996 by Frederic Lepied, France. <Frederic.Lepied@sugix.frmug.org>
+ *
+ * Original xrandr:
+ * Copyright © 2001 Keith Packard, member of The XFree86 Project, Inc.
+ * Copyright © 2002 Hewlett Packard Company, Inc.
+ * Copyright © 2006 Intel Corporation
+ *
+ * xrandr-align:
+ *
+ * Copyright © 2012 Paul Wolneykien <manowar@altlinux.org>, ALT Linux Ltd.
+ *
+ * Permission to use, copy, modify, distribute, and sell this software and its
+ * documentation for any purpose is  hereby granted without fee, provided that
+ * the  above copyright   notice appear  in   all  copies and  that both  that
+ * copyright  notice   and   this  permission   notice  appear  in  supporting
+ * documentation, and that   the  name of  the authors  not  be  used  in
+ * advertising or publicity pertaining to distribution of the software without
+ * specific,  written      prior  permission.     The authors  make  no
+ * representations about the suitability of this software for any purpose.  It
+ * is provided "as is" without express or implied warranty.
+ *
+ * THE AUTHORS DISCLAIM ALL   WARRANTIES WITH REGARD  TO  THIS SOFTWARE,
+ * INCLUDING ALL IMPLIED   WARRANTIES OF MERCHANTABILITY  AND   FITNESS, IN NO
+ * EVENT  SHALL THE AUTHORS  BE   LIABLE   FOR ANY  SPECIAL, INDIRECT   OR
+ * CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM LOSS OF USE,
+ * DATA  OR PROFITS, WHETHER  IN  AN ACTION OF  CONTRACT,  NEGLIGENCE OR OTHER
+ * TORTIOUS  ACTION, ARISING    OUT OF OR   IN  CONNECTION  WITH THE USE    OR
+ * PERFORMANCE OF THIS SOFTWARE.
+ *
+ */
+#include "common.h"
+#include "xrandr-align.h"
+#include "profile.h"
+#include "xerror.h"
+#include <ctype.h>
+#include <string.h>
+
+int
+xinput_version(Display	*display)
+{
+    XExtensionVersion	*version;
+    int vers = -1;
+
+    /* Not cached: the connection keeps the version of its display */
+    XPROF(display, "XGetExtensionVersion",
+	  version = XGetExtensionVersion(display, INAME));
+
+    if (version && (version != (XExtensionVersion*) NoSuchExtension)) {
+	vers = version->major_version;
+	XFree(version);
+    }
+
+    return vers;
+}
+
+/* Negotiates the XInput capabilities once per connection, so the
+   property writes need no version probe of their own */
+int
+connection_init (connection *conn, Display *display)
+{
+    int event, error;
+    Bool ret;
+
+    memset (conn, 0, sizeof (connection));
+    conn->display = display;
+
+    XPROF(display, "XQueryExtension",
+	  ret = XQueryExtension(display, "XInputExtension", &conn->xi_opcode, &event, &error));
+    if (!ret) {
+        printf("X Input extension not available.\n");
+        return EXIT_FAILURE;
+    }
+
+    conn->xi_version = xinput_version(display);
+    if (conn->xi_version <= 0) {
+	fprintf(stderr, "%s extension not available\n", INAME);
+	return EXIT_FAILURE;
+    }
+
+    /* Interned once: the writes need no atom lookup */
+    XPROF(display, "XInternAtom",
+          conn->float_atom = XInternAtom(display, "FLOAT", False));
+    XPROF(display, "XInternAtom",
+          conn->matrix_atom = XInternAtom(display, "Coordinate Transformation Matrix", False));
+
+#if HAVE_XI2
+    if (conn->xi_version == XI_2_Major) {
+        int major = XI_2_Major, minor = XI_2_Minor;
+        Status status;
+
+        XPROF(display, "XIQueryVersion",
+              status = XIQueryVersion(display, &major, &minor));
+        conn->xi2 = status == Success &&
+            (major * 1000 + minor) >= (XI_2_Major * 1000 + XI_2_Minor);
+    }
+#endif
+
+    return EXIT_SUCCESS;
+}
+
+/* Returns the XI 1 device opened on the first use and kept open
+   until the connection is closed */
+XDevice *
+connection_device (connection *conn, XID deviceid)
+{
+    XDevice **dev;
+
+    if (deviceid >= sizeof (conn->devices) / sizeof (conn->devices[0]))
+        return NULL;
+
+    dev = &conn->devices[deviceid];
+    if (!*dev) {
+        XPROF(conn->display, "XOpenDevice",
+              *dev = XOpenDevice(conn->display, deviceid));
+    }
+
+    return *dev;
+}
+
+/* Drops the cached device after a failed write: it may be gone or
+   be another one with the same ID now */
+void
+connection_forget (connection *conn, XID deviceid)
+{
+    XDevice **dev;
+
+    if (deviceid >= sizeof (conn->devices) / sizeof (conn->devices[0]))
+        return;
+
+    dev = &conn->devices[deviceid];
+    if (*dev) {
+        /* Closing a vanished device fails too: absorb the error */
+        xerror_track(conn->display, NextRequest(conn->display), None);
+        XPROF(conn->display, "XCloseDevice",
+              XCloseDevice(conn->display, *dev));
+        *dev = NULL;
+    }
+}
+
+void
+connection_close (connection *conn)
+{
+    int i;
+
+    for (i = 0; i < sizeof (conn->devices) / sizeof (conn->devices[0]); i++) {
+        if (conn->devices[i]) {
+            XPROF(conn->display, "XCloseDevice",
+                  XCloseDevice(conn->display, conn->devices[i]));
+            conn->devices[i] = NULL;
+        }
+    }
+}
+
+int check_valuator (XDeviceInfo *info,
+		    unsigned char mode,
+		    unsigned char min_axes,
+		    Bool axes_signed)
+{
+    XAnyClassPtr any;
+    XValuatorInfoPtr v;
+    XAxisInfoPtr a;
+    int i, j;
+
+    if (info->num_classes > 0) {
+        any = (XAnyClassPtr) (info->inputclassinfo);
+	for (i = 0; i < info->num_classes; i++) {
+	    if (any->class == ValuatorClass) {
+		v = (XValuatorInfoPtr) any;
+		if (mode && v->mode != mode) {
+		    continue;
+		}
+		if (min_axes && v->num_axes < min_axes) {
+		    continue;
+		}
+
+		if (axes_signed) {
+		    a = (XAxisInfoPtr) ((char *) v + sizeof (XValuatorInfo));
+		    for (j = 0; j < v->num_axes; j++) {
+		        if (a->min_value >= 0) {
+			    break;
+			}
+			a++;
+		    }
+		    if (j < v->num_axes) {
+		        continue;
+		    }
+		}
+
+		return 1;
+	    }
+	    any = (XAnyClassPtr) ((char *) any + any->length);
+	}
+    }
+
+    return 0;
+}
+
+XDeviceInfo*
+find_device_in_list (XDeviceInfo	*devices,
+		     int		num_devices,
+		     const char    	*name,
+		     Bool		only_extended,
+		     unsigned char	mode,
+		     unsigned char	min_axes,
+		     Bool		axes_signed)
+{
+    XDeviceInfo *found = NULL;
+    int		loop;
+    int		len = strlen(name);
+    Bool	is_id = True;
+    XID		id = (XID)-1;
+
+    for(loop=0; loop<len; loop++) {
+	if (!isdigit(name[loop])) {
+	    is_id = False;
+	    break;
+	}
+    }
+
+    if (is_id) {
+	id = atoi(name);
+    }
+
+    for(loop=0; loop<num_devices; loop++) {
+	if ((!only_extended || (devices[loop].use >= IsXExtensionDevice)) &&
+	    ((!is_id && strcmp(devices[loop].name, name) == 0) ||
+	     (is_id && devices[loop].id == id))) {
+	    if ((mode || min_axes) && \
+		! check_valuator (&devices[loop], mode, min_axes, axes_signed)) {
+	        continue;
+	    }
+	    if (found) {
+	        fprintf(stderr,
+	                "Warning: There are multiple devices named \"%s\".\n"
+	                "To ensure the correct one is selected, please use "
+	                "the device ID instead.\n\n", name);
+		return NULL;
+	    } else {
+		found = &devices[loop];
+	    }
+	}
+    }
+    return found;
+}
+
+XDeviceInfo*
+find_device_info_ext (Display		*display,
+		      const char    	*name,
+		      Bool		only_extended,
+		      unsigned char	mode,
+		      unsigned char	min_axes,
+		      Bool		axes_signed)
+{
+    XDeviceInfo	*devices;
+    int		num_devices;
+
+    XPROF(display, "XListInputDevices",
+	  devices = XListInputDevices(display, &num_devices));
+
+    return find_device_in_list (devices, num_devices, name, only_extended,
+				mode, min_axes, axes_signed);
+}
+
+XDeviceInfo*
+find_device_info(Display	*display,
+		 const char    	*name,
+		 Bool		only_extended)
+{
+    return find_device_info_ext (display, name, only_extended, 0, 0, 0);
+}
+
+#ifdef HAVE_XI2
+Bool is_pointer(int use)
+{
+    return use == XIMasterPointer || use == XISlavePointer;
+}
+
+Bool is_keyboard(int use)
+{
+    return use == XIMasterKeyboard || use == XISlaveKeyboard;
+}
+
+Bool device_matches(XIDeviceInfo *info, const char *name)
+{
+    if (strcmp(info->name, name) == 0) {
+        return True;
+    }
+
+    if (strncmp(name, "pointer:", strlen("pointer:")) == 0 &&
+        strcmp(info->name, name + strlen("pointer:")) == 0 &&
+        is_pointer(info->use)) {
+        return True;
+    }
+
+    if (strncmp(name, "keyboard:", strlen("keyboard:")) == 0 &&
+        strcmp(info->name, name + strlen("keyboard:")) == 0 &&
+        is_keyboard(info->use)) {
+        return True;
+    }
+
+    return False;
+}
+
+XIDeviceInfo*
+xi2_find_device_in_list(XIDeviceInfo *info, int ndevices, const char *name)
+{
+    XIDeviceInfo *found = NULL;
+    Bool is_id = True;
+    int i, id = -1;
+
+    for(i = 0; i < strlen(name); i++) {
+	if (!isdigit(name[i])) {
+	    is_id = False;
+	    break;
+	}
+    }
+
+    if (is_id) {
+	id = atoi(name);
+    }
+
+    for(i = 0; i < ndevices; i++)
+    {
+        if (is_id ? info[i].deviceid == id : device_matches (&info[i], name)) {
+            if (found) {
+                fprintf(stderr,
+                        "Warning: There are multiple devices matching '%s'.\n"
+                        "To ensure the correct one is selected, please use "
+                        "the device ID, or prefix the\ndevice name with "
+                        "'pointer:' or 'keyboard:' as appropriate.\n\n", name);
+                return NULL;
+            } else {
+                found = &info[i];
+            }
+        }
+    }
+
+    return found;
+}
+
+XIDeviceInfo*
+xi2_find_device_info(Display *display, const char *name)
+{
+    XIDeviceInfo *info;
+    XIDeviceInfo *found;
+    int ndevices;
+
+    XPROF(display, "XIQueryDevice",
+	  info = XIQueryDevice(display, XIAllDevices, &ndevices));
+
+    found = xi2_find_device_in_list(info, ndevices, name);
+    if (!found)
+        XIFreeDeviceInfo(info);
+
+    return found;
+}
+#endif
+
+/* end of device.c */
@@ -31,283 +31,531 @@
  *
  */
 
+#include "common.h"
 #include "xrandr-align.h"
+#include "profile.h"
+#include "control.h"
+#include "policy.h"
+#include "orientation.h"
+#include "sensor.h"
+#include "detach.h"
+#include "trace.h"
+#include "realtime.h"
+#include "metrics.h"
+#include <pthread.h>
+#include <signal.h>
+#include <fcntl.h>
 #include <string.h>
 #include <time.h>
+#include <unistd.h>
 
-#define INVALID_EVENT_TYPE	-1
+/* The screen configuration, fetched at the start and refreshed on
+   the RandR screen change events only. The targets of all the
+   rotations are kept, so a rotation is a table lookup and a single
+   XRRSetScreenConfig request with no fetch before it. */
+typedef struct
+{
+  XRRScreenConfiguration *sconf;
+  SizeID size;		/* the current size, kept by the rotations */
+  Rotation current;
+  Rotation supported;
+  struct
+  {
+    Rotation rotation;
+    int width, height;	/* of the rotated screen */
+  } targets[4];
+} screen_targets;
 
-static int           motion_type = INVALID_EVENT_TYPE;
-static int           button_press_type = INVALID_EVENT_TYPE;
-static int           button_release_type = INVALID_EVENT_TYPE;
-static int           key_press_type = INVALID_EVENT_TYPE;
-static int           key_release_type = INVALID_EVENT_TYPE;
-static int           proximity_in_type = INVALID_EVENT_TYPE;
-static int           proximity_out_type = INVALID_EVENT_TYPE;
+static int
+rotation_index (Rotation rot)
+{
+  switch (rot & (RR_Rotate_0 | RR_Rotate_90 | RR_Rotate_180 | RR_Rotate_270)) {
+  case RR_Rotate_90:
+    return 1;
+  case RR_Rotate_180:
+    return 2;
+  case RR_Rotate_270:
+    return 3;
+  default:
+    return 0;
+  }
+}
 
 static int
-register_events(Display		*dpy,
-		XDeviceInfo	*info,
-		const char	*dev_name,
-		Bool		handle_proximity)
+targets_refresh (Display *display,
+		 Window root,
+		 screen_targets *st)
 {
-    int			number = 0;	/* number of events registered */
-    XEventClass		event_list[7];
-    int			i;
-    XDevice		*device;
-    Window		root_win;
-    unsigned long	screen;
-    XInputClassInfo	*ip;
-
-    screen = DefaultScreen(dpy);
-    root_win = RootWindow(dpy, screen);
-
-    device = XOpenDevice(dpy, info->id);
-
-    if (!device) {
-	fprintf(stderr, "unable to open device %s\n", dev_name);
-	return 0;
-    }
+  XRRScreenSize *sizes;
+  Rotation rot;
+  int nsizes;
+  int i;
 
-    if (device->num_classes > 0) {
-	for (ip = device->classes, i=0; i<info->num_classes; ip++, i++) {
-	    switch (ip->input_class) {
-/*
-	    case KeyClass:
-		DeviceKeyPress(device, key_press_type, event_list[number]); number++;
-		DeviceKeyRelease(device, key_release_type, event_list[number]); number++;
-		break;
-
-	    case ButtonClass:
-		DeviceButtonPress(device, button_press_type, event_list[number]); number++;
-		DeviceButtonRelease(device, button_release_type, event_list[number]); number++;
-		break;
-*/
-	    case ValuatorClass:
-		DeviceMotionNotify(device, motion_type, event_list[number]); number++;
-		if (handle_proximity) {
-		    ProximityIn(device, proximity_in_type, event_list[number]); number++;
-		    ProximityOut(device, proximity_out_type, event_list[number]); number++;
-		}
-		break;
-/*
-	    default:
-		fprintf(stderr, "unknown class\n");
-		break;
-*/
-	    }
-	}
+  if (st->sconf) {
+    XRRFreeScreenConfigInfo (st->sconf);
+  }
+  XPROF (display, "XRRGetScreenInfo",
+	 st->sconf = XRRGetScreenInfo (display, root));
+  if (!st->sconf) {
+    return EXIT_FAILURE;
+  }
 
-	if (XSelectExtensionEvent(dpy, root_win, event_list, number)) {
-	    fprintf(stderr, "error selecting extended events\n");
-	    return 0;
-	}
+  st->size = XRRConfigCurrentConfiguration (st->sconf, &st->current);
+  st->supported = XRRConfigRotations (st->sconf, &rot);
+  sizes = XRRConfigSizes (st->sconf, &nsizes);
+  for (i = 0; i < 4; i++) {
+    st->targets[i].rotation = RR_Rotate_0 << i;
+    if (st->size < nsizes) {
+      st->targets[i].width = i % 2 ? sizes[st->size].height : sizes[st->size].width;
+      st->targets[i].height = i % 2 ? sizes[st->size].width : sizes[st->size].height;
     }
-    return number;
+  }
+
+  return EXIT_SUCCESS;
 }
 
-int
-align_screen (Display *display,
-	    Window root,
-	    Rotation rot)
+/* Commits the rotation. A configuration outdated by a change not
+   seen yet is refreshed and the commit is tried once again. */
+static int
+targets_commit (Display *display,
+		Window root,
+		screen_targets *st,
+		Rotation rot)
 {
-  int ret;
-  XRRScreenConfiguration *sconf;
-  SizeID ssize;
-  Rotation crot;
+  int i = rotation_index (rot);
   Status status;
+  int attempt;
 
-  sconf = XRRGetScreenInfo (display, root);
-  ssize = XRRConfigCurrentConfiguration (sconf, &crot);
+  if (!(st->supported & st->targets[i].rotation)) {
+    return EXIT_FAILURE;
+  }
+  if (st->current == st->targets[i].rotation) {
+    return EXIT_SUCCESS;
+  }
 
-  ret = EXIT_SUCCESS;
-  if (rot != crot) {
-    status = XRRSetScreenConfig (display, sconf, root, ssize, rot, CurrentTime);
-    if (status != RRSetConfigSuccess) {
-      ret = EXIT_FAILURE;
+  for (attempt = 0; attempt < 2; attempt++) {
+    XPROF (display, "XRRSetScreenConfig",
+	   status = XRRSetScreenConfig (display, st->sconf, root, st->size,
+					st->targets[i].rotation, CurrentTime));
+    if (status != RRSetConfigInvalidConfigTime ||
+	targets_refresh (display, root, st) == EXIT_FAILURE) {
+      break;
     }
   }
+  if (status != RRSetConfigSuccess) {
+    return EXIT_FAILURE;
+  }
+  st->current = st->targets[i].rotation;
 
-  XRRFreeScreenConfigInfo (sconf);
+  return EXIT_SUCCESS;
+}
 
-  return ret;
+/* The termination signals end the loops of all the gravitate threads
+   cleanly, so the floated sensors are attached back. The pipe is
+   never drained: it stays readable for every thread. */
+static volatile sig_atomic_t quit_requested = 0;
+static int quit_pipe[2] = { -1, -1 };
+static pthread_once_t quit_once = PTHREAD_ONCE_INIT;
+
+static void
+quit_handler (int sig)
+{
+  quit_requested = 1;
+  if (write (quit_pipe[1], "", 1) < 0) {
+    /* Readable already */
+  }
 }
 
-Rotation
-current_rotation (Display *display,
-		  Window root)
-                  /* RRCrtc crtcnum)*/
+static void
+quit_init (void)
 {
-  Rotation rot;
-  XRRScreenConfiguration *sconf;
-  SizeID ssize;
+  struct sigaction sa;
 
-  sconf = XRRGetScreenInfo (display, root);
-  ssize = XRRConfigCurrentConfiguration (sconf, &rot);
+  if (pipe (quit_pipe) != 0) {
+    perror ("pipe");
+    return;
+  }
+  fcntl (quit_pipe[1], F_SETFL, fcntl (quit_pipe[1], F_GETFL) | O_NONBLOCK);
+  fcntl (quit_pipe[0], F_SETFD, FD_CLOEXEC);
+  fcntl (quit_pipe[1], F_SETFD, FD_CLOEXEC);
+
+  memset (&sa, 0, sizeof (sa));
+  sa.sa_handler = quit_handler;
+  sigemptyset (&sa.sa_mask);
+  sigaction (SIGTERM, &sa, NULL);
+  sigaction (SIGINT, &sa, NULL);
+  sigaction (SIGHUP, &sa, NULL);
+}
 
-  XRRFreeScreenConfigInfo (sconf);
+/* The sensor loop state shared with the control commands */
+typedef struct
+{
+  context *ctx;
+  Window root;
+  Rotation crot;
+  screen_targets screen;
+  rotation_policy policy;
+  sensor_thread *sensor;
+  time_t started;
+  unsigned long records;	/* read from the sensor thread */
+  unsigned long dropped;	/* stale records discarded */
+  unsigned long rotations;
+  unsigned long rotation_failures;
+  Rotation sensed;	/* the latest sensor decision, 0 if flat */
+  unsigned long rate_events;	/* the sensor events at the last metrics */
+  struct timespec rate_time;
+} gravity_data;
+
+/* Rotates the screen if the policy decides so */
+static int
+apply_policy (gravity_data *gd,
+	      Rotation wanted)
+{
+  Rotation rot;
 
-  return rot;
+  rot = policy_decide (&gd->policy, wanted, gd->crot, time (NULL));
+  if (!rot) {
+    return EXIT_SUCCESS;
+  }
+
+  if (gd->ctx->verbose) {
+    fprintf (stderr, "Orientation changed: %u\n", (unsigned int) rot);
+  }
+  if (targets_commit (gd->ctx->display, gd->root, &gd->screen, rot) == EXIT_FAILURE) {
+    trace_event (TRACE_ROTATE_FAILED, 0, gd->root, None, 0, 0, 0, 0, rot, NULL, 0, 0);
+    gd->rotation_failures++;
+    fprintf (stderr, "Unable to set the screen configuration\n");
+    return EXIT_FAILURE;
+  }
+  trace_event (TRACE_ROTATE, 0, gd->root, None, 0, 0,
+	       gd->screen.targets[rotation_index (rot)].width,
+	       gd->screen.targets[rotation_index (rot)].height,
+	       rot, NULL, 0, gd->crot);
+  gd->crot = rot;
+  gd->rotations++;
+  xprof_report ("rotation");
+
+  return EXIT_SUCCESS;
 }
 
-int
-get_thresholds (XDeviceInfo *info,
-		double thr,
-		double *xthr,
-		double *ythr)
+static int
+gravity_command (void *data,
+		 int argc,
+		 char *argv[],
+		 FILE *out)
 {
-    XAnyClassPtr any;
-    XValuatorInfoPtr v;
-    XAxisInfoPtr a;
-    int i, j;
-
-    if (info->num_classes > 0) {
-        any = (XAnyClassPtr) (info->inputclassinfo);
-	for (i = 0; i < info->num_classes; i++) {
-	    if (any->class == ValuatorClass) {
-		v = (XValuatorInfoPtr) any;
-
-		if (v->num_axes < 2) {
-		    continue;
-		}
-
-		a = (XAxisInfoPtr) ((char *) v + sizeof (XValuatorInfo));
-		*xthr = (a->max_value - a->min_value) * thr;
-		a++;
-		*ythr = (a->max_value - a->min_value) * thr;
-
-		return EXIT_SUCCESS;
-	    }
-	}
+  gravity_data *gd = data;
+  rotation_policy *p = &gd->policy;
+
+  if (strcmp (argv[0], "pause") == 0) {
+    p->paused = 1;
+  } else if (strcmp (argv[0], "resume") == 0) {
+    p->paused = 0;
+  } else if (strcmp (argv[0], "lock") == 0) {
+    Rotation rot = argc > 1 ? parse_rotation (argv[1]) : gd->crot;
+    if (!rot) {
+      fprintf (out, "Invalid rotation: %s\n", argv[1]);
+      return EXIT_FAILURE;
     }
+    if (!(rot & p->allowed)) {
+      fprintf (out, "Rotation not allowed: 0x%02x\n", (unsigned int) rot);
+      return EXIT_FAILURE;
+    }
+    p->lock = rot;
+  } else if (strcmp (argv[0], "unlock") == 0) {
+    p->lock = 0;
+  } else if (strcmp (argv[0], "stats") == 0) {
+    sensor_thread *s = gd->sensor;
+    long uptime = time (NULL) - gd->started;
+    unsigned long events = __atomic_load_n (&s->events, __ATOMIC_RELAXED);
+    unsigned long batches = __atomic_load_n (&s->batches, __ATOMIC_RELAXED);
+
+    fprintf (out, "rotation=0x%02x allowed=0x%02x lock=0x%02x prop-lock=0x%02x paused=%i touches=%i tablet=%i\n",
+	     (unsigned int) gd->crot, (unsigned int) p->allowed,
+	     (unsigned int) p->lock, (unsigned int) p->prop_lock,
+	     p->paused, p->touches, p->tablet);
+    fprintf (out, "events=%lu batches=%lu events/batch=%.1f decisions/s=%.2f\n",
+	     events, batches,
+	     batches ? (double) events / batches : 0.0,
+	     uptime > 0 ? (double) batches / uptime : (double) batches);
+    fprintf (out, "pushed=%lu overflows=%lu records=%lu dropped=%lu rotations=%lu held=%lu\n",
+	     __atomic_load_n (&s->pushed, __ATOMIC_RELAXED),
+	     __atomic_load_n (&s->ring.overflows, __ATOMIC_RELAXED),
+	     gd->records, gd->dropped, gd->rotations, p->held);
+    return EXIT_SUCCESS;
+  } else {
+    fprintf (out, "Unknown command: %s\n", argv[0]);
+    return EXIT_FAILURE;
+  }
 
+  if (apply_policy (gd, 0) == EXIT_FAILURE) {
+    fprintf (out, "Unable to set the screen configuration\n");
     return EXIT_FAILURE;
+  }
+
+  return EXIT_SUCCESS;
+}
+
+static void
+gravity_metrics (void *data,
+		 metrics_writer *m)
+{
+  gravity_data *gd = data;
+  sensor_thread *s = gd->sensor;
+  unsigned long events = __atomic_load_n (&s->events, __ATOMIC_RELAXED);
+  struct timespec now;
+  double elapsed;
+
+  clock_gettime (CLOCK_MONOTONIC, &now);
+  elapsed = (now.tv_sec - gd->rate_time.tv_sec) + (now.tv_nsec - gd->rate_time.tv_nsec) / 1e9;
+
+  metrics_family (m, "xrandr_align_events_total", "counter",
+		  "The sensor events and the decisions made from them.");
+  metrics_sample (m, "xrandr_align_events_total", "type=\"sensor\"", events);
+  metrics_sample (m, "xrandr_align_events_total", "type=\"decision\"", gd->records);
+  metrics_sample (m, "xrandr_align_events_total", "type=\"dropped\"", gd->dropped);
+  metrics_sample (m, "xrandr_align_events_total", "type=\"overflow\"",
+		  __atomic_load_n (&s->ring.overflows, __ATOMIC_RELAXED));
+
+  metrics_family (m, "xrandr_align_sensor_rate_hertz", "gauge",
+		  "The sensor events per second since the last write.");
+  metrics_sample (m, "xrandr_align_sensor_rate_hertz", NULL,
+		  elapsed > 0 ? (events - gd->rate_events) / elapsed : 0);
+  gd->rate_events = events;
+  gd->rate_time = now;
+
+  metrics_family (m, "xrandr_align_rotations_total", "counter",
+		  "The screen rotations by result.");
+  metrics_sample (m, "xrandr_align_rotations_total", "result=\"applied\"", gd->rotations);
+  metrics_sample (m, "xrandr_align_rotations_total", "result=\"failed\"", gd->rotation_failures);
+  metrics_sample (m, "xrandr_align_rotations_total", "result=\"held\"", gd->policy.held);
+
+  metrics_family (m, "xrandr_align_rotation_degrees", "gauge",
+		  "The current rotation of the screen.");
+  metrics_sample (m, "xrandr_align_rotation_degrees", NULL, 90 * rotation_index (gd->crot));
+  metrics_family (m, "xrandr_align_orientation_degrees", "gauge",
+		  "The latest orientation of the sensor, -1 if lying flat.");
+  metrics_sample (m, "xrandr_align_orientation_degrees", NULL,
+		  gd->sensed ? 90 * rotation_index (gd->sensed) : -1);
 }
 
 int
-read_events (Display *display,
+read_events (context *ctx,
 	     Window root,
 	     /*	const XRROutputInfo *output,*/
 	     XDeviceInfo *input,
-	     double tratio,
-	     double thr)
+	     const orientation_classifier *oc,
+	     orientation_reducer *reducer,
+	     Rotation allowed,
+	     Rotation docked,
+	     const char *switchpath)
 {
+  Display *display = ctx->display;
+  gravity_data gd;
+  control_server *control;
+  metrics_writer *metrics;
+  sensor_record rec;
   XEvent e;
-  Rotation crot;
+  Atom lockprop;
   time_t rtime;
-  double xthr, ythr;
+  int fds[4];
+  int swfd = -1;
   int ret;
+  int n;
   int asleep = 0;
+  int rr_event_base, rr_error_base;
 
-  if (! register_events(display, input, "", False)) {
-    fprintf(stderr, "Unable to register for input events.\n");
+  memset (&gd, 0, sizeof (gd));
+  gd.ctx = ctx;
+  gd.root = root;
+  gd.started = rtime = time (NULL);
+
+  if (metrics_open (ctx, "gravitate", gravity_metrics, &gd, &metrics) == EXIT_FAILURE) {
     return EXIT_FAILURE;
   }
 
-  ret = get_thresholds (input, thr, &xthr, &ythr);
-  if (ret != EXIT_SUCCESS) {
-    fprintf (stderr, "Unable to calculate the threshold values for the axes\n");
-    return ret;
+  if (!XRRQueryExtension (display, &rr_event_base, &rr_error_base) ||
+      targets_refresh (display, root, &gd.screen) == EXIT_FAILURE) {
+    fprintf (stderr, "Unable to get the screen configuration\n");
+    metrics_free (metrics);
+    return EXIT_FAILURE;
+  }
+  gd.crot = gd.screen.current;
+  XPROF (display, "XRRSelectInput",
+	 XRRSelectInput (display, root, RRScreenChangeNotifyMask));
+
+  gd.sensor = sensor_start (ctx, root, input, oc, reducer);
+  if (!gd.sensor) {
+    XRRFreeScreenConfigInfo (gd.screen.sconf);
+    metrics_free (metrics);
+    return EXIT_FAILURE;
+  }
+
+  policy_init (&gd.policy, allowed);
+  gd.policy.docked = docked;
+
+  lockprop = XInternAtom (display, ROTATION_LOCK_PROP, False);
+  XSelectInput (display, root, PropertyChangeMask);
+  gd.policy.prop_lock = read_rotation_lock (display, root, lockprop, gd.crot);
+
+#if HAVE_XI2
+  if (select_touch_events (ctx, root) != EXIT_SUCCESS && ctx->verbose) {
+    fprintf (stderr, "Touches are not tracked (XI 2.2 is required)\n");
+  }
+#endif
+
+  if (strcmp (switchpath, "none") != 0) {
+    swfd = tablet_switch_open (switchpath, ctx->verbose, &gd.policy.tablet);
   }
 
-  crot = current_rotation (display, root);
-  rtime = time (NULL);
+  control = control_open (ctx, "gravitate", gravity_command, &gd);
+  clock_gettime (CLOCK_MONOTONIC, &gd.rate_time);
 
 /*
-  if (verbose) {
+  if (ctx->verbose) {
     fprintf (stderr, "Current orientation of %s: %u\n", output->name, (unsigned int) crot);
   }
 */
 
-  while (1) {
-    XNextEvent(display, &e);
-
-    if (e.type == motion_type) {
-      if (asleep) {
-        if ((time (NULL) - rtime) < 1) {
-          continue;
-        } else {
-	  asleep = 0;
-	  if (verbose) {
-            fprintf (stderr, "...Woken up.\n");
-	  }
-        }
+  pthread_once (&quit_once, quit_init);
+  trace_install (display);
+
+  ret = apply_policy (&gd, 0);
+  while (ret != EXIT_FAILURE && !quit_requested) {
+    fds[0] = sensor_fd (gd.sensor);
+    fds[1] = swfd;
+    fds[2] = quit_pipe[0];
+    fds[3] = metrics_fd (metrics);
+    if (control_next_event (control, display, fds, 4, &e)) {
+      if (e.type == rr_event_base + RRScreenChangeNotify) {
+	/* Ours or another client's: refresh the targets now, off the
+	   path of the next rotation */
+	XRRUpdateConfiguration (&e);
+	if (targets_refresh (display, root, &gd.screen) == EXIT_SUCCESS) {
+	  gd.crot = gd.screen.current;
+	}
+      } else if (e.type == PropertyNotify && e.xproperty.atom == lockprop) {
+	gd.policy.prop_lock = read_rotation_lock (display, root, lockprop, gd.crot);
+	ret = apply_policy (&gd, 0);
+      }
+#if HAVE_XI2
+      else if (policy_touch_event (&gd.policy, ctx, &e, time (NULL))) {
+	if (gd.policy.touches == 0) {
+	  ret = apply_policy (&gd, 0);
+	}
       }
-      XDeviceMotionEvent *m = (XDeviceMotionEvent *) &e;
-
-      if (m->axes_count > 1) {
-	Rotation rot = 0;
-	double ratio;
-	double x, y;
-	int ret;
-
-	x = m->axis_data[m->first_axis];
-	y = m->axis_data[m->first_axis + 1];
-	ratio = y/x;
-	if (ratio >= tratio || ratio <= -tratio) {
-	  if (y < -ythr) {
-	    rot = RR_Rotate_180;
-	  } else if (y > ythr) {
-	    rot = RR_Rotate_0;
-	  }
-	} else {
-	  if (x < -xthr) {
-	    rot = RR_Rotate_90;
-	  } else if (x > xthr) {
-	    rot = RR_Rotate_270;
-	  }
+#endif
+      continue;
+    }
+
+    metrics_tick (metrics);
+
+    if (swfd >= 0) {
+      switch (tablet_switch_read (swfd, &gd.policy.tablet)) {
+      case -1:
+	fprintf (stderr, "The tablet-mode switch is gone\n");
+	close (swfd);
+	swfd = -1;
+	gd.policy.tablet = TABLET_UNKNOWN;
+	/* fall through */
+      case 1:
+	if (ctx->verbose && swfd >= 0) {
+	  fprintf (stderr, "Tablet mode: %s\n", gd.policy.tablet ? "on" : "off");
 	}
-	if (rot && rot != crot) {
-	  if (verbose) {
-	    fprintf (stderr, "X: %f, Y: %f\n", x, y);
-	    fprintf (stderr, "Orientation changed: %u\n", (unsigned int) rot);
-	  }
-	  ret = align_screen (display, root, rot);
-	  if (ret == EXIT_FAILURE) {
-	    fprintf (stderr, "Unable to set the screen configuration\n");
-	    return ret;
-	  }
-	  crot = rot;
-	  if (verbose) {
-            fprintf (stderr, "Enter sleep...\n");
-	  }
-	  rtime = time (NULL);
-	  asleep = 1;
+	ret = apply_policy (&gd, 0);
+	break;
+      }
+    }
+
+    /* Only the latest decision of the sensor thread matters */
+    n = sensor_read (gd.sensor, &rec);
+    if (n == 0) {
+      continue;
+    }
+    gd.records += n;
+    gd.sensed = rec.rotation;
+    trace_event (TRACE_SENSOR, rec.time, None, None, 0, 0, 0, 0, rec.rotation,
+		 rec.g, 3, rec.samples);
+
+    if (asleep) {
+      if ((time (NULL) - rtime) < 1) {
+	gd.dropped += n;
+	continue;
+      } else {
+	asleep = 0;
+	if (ctx->verbose) {
+	  fprintf (stderr, "...Woken up.\n");
 	}
       }
     }
+
+    if (rec.rotation && rec.rotation != gd.crot) {
+      unsigned long rotations = gd.rotations;
+
+      if (ctx->verbose) {
+	double pitch, roll;
+	orientation_angles (rec.g, &pitch, &roll);
+	fprintf (stderr, "X: %f, Y: %f, Z: %f (pitch %.1f, roll %.1f), %i samples\n",
+		 rec.g[0], rec.g[1], rec.g[2], pitch, roll, rec.samples);
+      }
+      ret = apply_policy (&gd, rec.rotation);
+      if (gd.rotations != rotations) {
+	/* The records pushed while rotating are stale */
+	gd.dropped += sensor_read (gd.sensor, &rec);
+	if (ctx->verbose) {
+	  fprintf (stderr, "Enter sleep...\n");
+	}
+	rtime = time (NULL);
+	asleep = 1;
+      }
+    }
+  }
+
+  metrics_close (metrics);
+  control_close (control);
+  sensor_stop (gd.sensor);
+  XRRFreeScreenConfigInfo (gd.screen.sconf);
+  if (swfd >= 0) {
+    close (swfd);
   }
 
   return ret;
 }
 
 int
-gravitate (Display *display,
-	   int argc,
-	   const char *argv[],
-	   const char *funcname,
-	   const char *usage)
+gravitate (context *ctx)
 {
+  Display *display = ctx->display;
+  const options *opts = &ctx->opts;
   /*  RROutput outputid;
       XRROutputInfo *output;*/
   int ret;
   const char *inputarg;
   XDeviceInfo *input;
-  int screen;
-  int event_base, error_base;
   double ratio;
   const char *ratioarg;
   char *ratioend;
   double thr;
   const char *thrarg;
   char *thrend;
-
-  ret = get_screen (display, argc, argv, funcname, usage, &screen);
-  if (ret == EXIT_FAILURE) {
-    return ret;
-  }
-
-  ret = get_argval (argc, argv, "ratio", funcname, usage, "2.0", &ratioarg);
+  double range_thr;
+  const char *rangearg;
+  double flat;
+  const char *flatarg;
+  char *flatend;
+  const char *axesarg;
+  orientation_classifier oc;
+  const char *reducearg;
+  orientation_reducer reducer;
+  const char *rotarg;
+  Rotation allowed;
+  const char *dockedarg;
+  Rotation docked;
+  const char *switcharg;
+  detach_record detached;
+  realtime_options rt;
+
+  ret = get_argval (opts->argc, opts->argv, "ratio", opts->funcname, opts->usage, "2.0", &ratioarg);
   if (ret == EXIT_FAILURE) {
     return ret;
   } else {
@@ -318,21 +566,84 @@ gravitate (Display *display,
     }
   }
 
-  ret = get_argval (argc, argv, "threshold", funcname, usage, "0.12", &thrarg);
+  ret = get_argval (opts->argc, opts->argv, "threshold", opts->funcname, opts->usage, NULL, &thrarg);
   if (ret == EXIT_FAILURE) {
     return ret;
   } else {
-    thr = strtod (thrarg, &thrend);
+    thr = strtod (thrarg ? thrarg : "2.5", &thrend);
     if (thrend != NULL && strlen (thrend) > 0) {
       fprintf (stderr, "Invalid number: %s\n", thrarg);
       return EXIT_FAILURE;
     }
   }
 
-  ret = get_argval (argc, argv, "input", funcname, usage, "Virtual core pointer", &inputarg);
+  /* The threshold of the configurations written before the unit
+     change: a fraction of the axis range */
+  ret = get_argval (opts->argc, opts->argv, "range-threshold", opts->funcname, opts->usage, NULL, &rangearg);
   if (ret == EXIT_FAILURE) {
     return ret;
+  } else if (rangearg) {
+    range_thr = strtod (rangearg, &thrend);
+    if (thrend != NULL && strlen (thrend) > 0) {
+      fprintf (stderr, "Invalid number: %s\n", rangearg);
+      return EXIT_FAILURE;
+    }
+    if (thrarg) {
+      fprintf (stderr, "Either --threshold or --range-threshold is given\n");
+      return EXIT_FAILURE;
+    }
+    if (range_thr <= 0.0 || range_thr >= 1.0) {
+      fprintf (stderr, "The range threshold should be between 0 and 1\n");
+      return EXIT_FAILURE;
+    }
+  } else {
+    range_thr = 0;
   }
+
+  ret = get_argval (opts->argc, opts->argv, "flat", opts->funcname, opts->usage, "70", &flatarg);
+  if (ret == EXIT_FAILURE) {
+    return ret;
+  } else {
+    flat = strtod (flatarg, &flatend);
+    if (flatend != NULL && strlen (flatend) > 0) {
+      fprintf (stderr, "Invalid number: %s\n", flatarg);
+      return EXIT_FAILURE;
+    }
+  }
+
+  ret = get_argval (opts->argc, opts->argv, "axes", opts->funcname, opts->usage, "x,y,z", &axesarg);
+  if (ret == EXIT_FAILURE) {
+    return ret;
+  }
+
+  ret = get_argval (opts->argc, opts->argv, "reduce", opts->funcname, opts->usage, "mean", &reducearg);
+  if (ret == EXIT_FAILURE || orientation_reducer_init (&reducer, reducearg) == EXIT_FAILURE) {
+    return EXIT_FAILURE;
+  }
+
+  ret = get_argval (opts->argc, opts->argv, "rotations", opts->funcname, opts->usage, "normal,left,inverted,right", &rotarg);
+  if (ret == EXIT_FAILURE || parse_rotations (rotarg, &allowed) == EXIT_FAILURE) {
+    return EXIT_FAILURE;
+  }
+
+  ret = get_argval (opts->argc, opts->argv, "docked", opts->funcname, opts->usage, "normal", &dockedarg);
+  if (ret == EXIT_FAILURE) {
+    return ret;
+  } else if (!(docked = parse_rotation (dockedarg))) {
+    fprintf (stderr, "Invalid rotation: %s\n", dockedarg);
+    return EXIT_FAILURE;
+  }
+
+  ret = get_argval (opts->argc, opts->argv, "tablet-switch", opts->funcname, opts->usage, "auto", &switcharg);
+  if (ret == EXIT_FAILURE) {
+    return ret;
+  }
+
+  if (realtime_parse (opts, &rt) == EXIT_FAILURE) {
+    return EXIT_FAILURE;
+  }
+
+  inputarg = opts->ninputs > 0 ? opts->inputs[0] : "Virtual core pointer";
   input = find_device_info_ext (display, inputarg, False, Absolute, 2, True);
   if (!input) {
     fprintf(stderr, "Unable to find device: %s\n", inputarg);
@@ -340,14 +651,30 @@ gravitate (Display *display,
     return ret;
   }
 
-  /* ret = get_output (display, argc, argv, funcname, usage, &outputid, &output); */
+  ret = orientation_init (&oc, ctx, input, axesarg, ratio, thr, range_thr, flat);
+
+  /* Keep the samples off the core pointer: a failure is not fatal */
+  detach_recover (ctx);
+  memset (&detached, 0, sizeof (detached));
+  if (ret != EXIT_FAILURE && !get_argflag (opts->argc, opts->argv, "no-float")) {
+    detach_float (ctx, input->id, &detached);
+  }
+
+  /* ret = get_output (display, opts, &outputid, &output); */
 
   if (ret != EXIT_FAILURE) {
     Window root;
 
-    root = RootWindow (display, screen);
-    ret = read_events (display, root, input, ratio, thr);
+    root = RootWindow (display, opts->screen);
+    allowed &= allowed_rotations (display, root, opts->outputs, opts->noutputs);
+    if (ctx->verbose) {
+      fprintf (stderr, "Allowed rotations: 0x%02x\n", (unsigned int) allowed);
+    }
+    /* Before the sensor thread is started: it inherits the setup */
+    realtime_apply (&rt, ctx->verbose);
+    ret = read_events (ctx, root, input, &oc, &reducer, allowed, docked, switcharg);
   }
+  detach_restore (ctx, &detached);
 
   /*  XRRFreeOutputInfo (output); */
   return ret;
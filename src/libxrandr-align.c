@@ -0,0 +1,439 @@
+/*
+ * Original xinput:
+ * Copyright 1996 by Frederic Lepied, France. <Frederic.Lepied@sugix.frmug.org>
+ *
+ * Original xrandr:
+ * Copyright © 2001 Keith Packard, member of The XFree86 Project, Inc.
+ * Copyright © 2002 Hewlett Packard Company, Inc.
+ * Copyright © 2006 Intel Corporation
+ *
+ * xrandr-align:
+ *
+ * Copyright © 2012 Paul Wolneykien <manowar@altlinux.org>, ALT Linux Ltd.
+ *
+ * Permission to use, copy, modify, distribute, and sell this software and its
+ * documentation for any purpose is  hereby granted without fee, provided that
+ * the  above copyright   notice appear  in   all  copies and  that both  that
+ * copyright  notice   and   this  permission   notice  appear  in  supporting
+ * documentation, and that   the  name of  the authors  not  be  used  in
+ * advertising or publicity pertaining to distribution of the software without
+ * specific,  written      prior  permission.     The authors  make  no
+ * representations about the suitability of this software for any purpose.  It
+ * is provided "as is" without express or implied warranty.
+ *
+ * THE AUTHORS DISCLAIM ALL   WARRANTIES WITH REGARD  TO  THIS SOFTWARE,
+ * INCLUDING ALL IMPLIED   WARRANTIES OF MERCHANTABILITY  AND   FITNESS, IN NO
+ * EVENT  SHALL THE AUTHORS  BE   LIABLE   FOR ANY  SPECIAL, INDIRECT   OR
+ * CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM LOSS OF USE,
+ * DATA  OR PROFITS, WHETHER  IN  AN ACTION OF  CONTRACT,  NEGLIGENCE OR OTHER
+ * TORTIOUS  ACTION, ARISING    OUT OF OR   IN  CONNECTION  WITH THE USE    OR
+ * PERFORMANCE OF THIS SOFTWARE.
+ *
+ */
+
+#include "common.h"
+#include "xrandr-align.h"
+#include "libxrandr-align.h"
+#include "target.h"
+#include "xerror.h"
+#include <string.h>
+
+struct xra_context
+{
+  context ctx;
+  int event_base;
+  screen_cache *caches;	/* by screen, dirtied by the RandR events */
+  binding *bindings;
+  int *screens;
+  alignment *als;
+  target *targets;	/* as resolved by the last alignment */
+  int count;
+};
+
+xra_context *
+xra_open (Display *display)
+{
+  xra_context *xra;
+  int error_base;
+  int s;
+
+  xra = calloc (1, sizeof (xra_context));
+  if (!xra) {
+    return NULL;
+  }
+
+  xra->ctx.display = display;
+  xra->ctx.opts.funcname = "libxrandr-align";
+  xra->ctx.opts.usage = "";
+  xra->ctx.opts.screen = DefaultScreen (display);
+  xra->ctx.opts.pre_script = "";
+  xra->ctx.opts.post_script = "";
+  xra->ctx.opts.config = "";
+  xra->ctx.opts.state = "";
+  xra->ctx.opts.calibration = "";
+
+  if (connection_init (&xra->ctx.conn, display) == EXIT_FAILURE ||
+      !XRRQueryExtension (display, &xra->event_base, &error_base)) {
+    free (xra);
+    return NULL;
+  }
+
+  xra->caches = calloc (ScreenCount (display), sizeof (screen_cache));
+  for (s = 0; s < ScreenCount (display); s++) {
+    xra->caches[s].root = RootWindow (display, s);
+    xra->caches[s].dirty = 1;
+  }
+
+  return xra;
+}
+
+void
+xra_close (xra_context *xra)
+{
+  int s;
+
+  if (!xra) {
+    return;
+  }
+
+  for (s = 0; s < ScreenCount (xra->ctx.display); s++) {
+    screen_free (&xra->caches[s]);
+  }
+  free (xra->caches);
+  free_calibration (&xra->ctx.cal);
+  connection_close (&xra->ctx.conn);
+  free_bindings (xra->bindings, xra->count);
+  free (xra->screens);
+  free (xra->als);
+  free (xra->targets);
+  free (xra);
+}
+
+void
+xra_set_verbose (xra_context *xra,
+		 int verbose)
+{
+  xra->ctx.verbose = verbose;
+}
+
+static int
+resolve_screen (xra_context *xra,
+		int screen)
+{
+  if (screen < 0) {
+    return DefaultScreen (xra->ctx.display);
+  }
+  if (screen >= ScreenCount (xra->ctx.display)) {
+    return -1;
+  }
+
+  return screen;
+}
+
+/* Makes room for the new bindings and records their screen */
+static void
+grow_bindings (xra_context *xra,
+	       int from,
+	       int count,
+	       int screen)
+{
+  int i;
+
+  xra->screens = realloc (xra->screens, count * sizeof (int));
+  xra->als = realloc (xra->als, count * sizeof (alignment));
+  xra->targets = realloc (xra->targets, count * sizeof (target));
+  for (i = from; i < count; i++) {
+    xra->screens[i] = screen;
+    memset (&xra->als[i], 0, sizeof (alignment));
+    memset (&xra->targets[i], 0, sizeof (target));
+  }
+}
+
+int
+xra_bind (xra_context *xra,
+	  int screen,
+	  const char *output,
+	  const char *input)
+{
+  binding *b;
+
+  screen = resolve_screen (xra, screen);
+  if (screen < 0 || !input) {
+    return -1;
+  }
+
+  xra->bindings = realloc (xra->bindings, (xra->count + 1) * sizeof (binding));
+  b = &xra->bindings[xra->count];
+  b->output = strdup (output ? output : "");
+  b->input = strdup (input);
+  b->pre_script = strdup ("");
+  b->post_script = strdup ("");
+  grow_bindings (xra, xra->count, xra->count + 1, screen);
+
+  return xra->count++;
+}
+
+int
+xra_auto_bind (xra_context *xra,
+	       int screen)
+{
+  int count = xra->count;
+
+  screen = resolve_screen (xra, screen);
+  if (screen < 0) {
+    return -1;
+  }
+
+  if (auto_bindings (&xra->ctx, RootWindow (xra->ctx.display, screen),
+		     &xra->bindings, &count) == EXIT_FAILURE) {
+    return -1;
+  }
+  grow_bindings (xra, xra->count, count, screen);
+  count -= xra->count;
+  xra->count += count;
+
+  return count;
+}
+
+int
+xra_binding_count (xra_context *xra)
+{
+  return xra->count;
+}
+
+/* Aligns the bindings of the screen in one batch. The bindings of a
+   screen are not necessarily adjacent, so they are gathered first. */
+static int
+align_screen_bindings (xra_context *xra,
+		       int screen)
+{
+  binding *bindings;
+  alignment *als;
+  target *targets;
+  int *index;
+  int n = 0;
+  int i;
+  int ret = EXIT_SUCCESS;
+
+  bindings = calloc (xra->count, sizeof (binding));
+  als = calloc (xra->count, sizeof (alignment));
+  targets = calloc (xra->count, sizeof (target));
+  index = calloc (xra->count, sizeof (int));
+  for (i = 0; i < xra->count; i++) {
+    if (xra->screens[i] == screen) {
+      bindings[n] = xra->bindings[i];
+      index[n++] = i;
+    }
+  }
+
+  if (n > 0) {
+    ret = align_bindings (&xra->ctx, &xra->caches[screen], bindings, n, als, targets);
+    for (i = 0; i < n; i++) {
+      /* An unresolved target is resolved again on the next change */
+      xra->targets[index[i]] = targets[i];
+      if (ret != EXIT_FAILURE) {
+	xra->als[index[i]] = als[i];
+      }
+    }
+  }
+
+  free (index);
+  free (targets);
+  free (als);
+  free (bindings);
+
+  return ret;
+}
+
+int
+xra_align (xra_context *xra)
+{
+  int s;
+
+  /* Without the events selected the cache may be stale */
+  for (s = 0; s < ScreenCount (xra->ctx.display); s++) {
+    xra->caches[s].dirty = 1;
+    if (align_screen_bindings (xra, s) == EXIT_FAILURE) {
+      return -1;
+    }
+  }
+
+  return 0;
+}
+
+int
+xra_select_events (xra_context *xra)
+{
+  int s, i;
+
+  for (s = 0; s < ScreenCount (xra->ctx.display); s++) {
+    for (i = 0; i < xra->count; i++) {
+      if (xra->screens[i] == s) {
+	XRRSelectInput (xra->ctx.display, RootWindow (xra->ctx.display, s),
+			RRScreenChangeNotifyMask | RROutputChangeNotifyMask | RRCrtcChangeNotifyMask);
+	break;
+      }
+    }
+  }
+
+  return 0;
+}
+
+/* Tells if the change of the output or CRTC (neither for a screen
+   change) may concern the target */
+static int
+concerns (const target *t,
+	  RROutput output,
+	  RRCrtc crtc)
+{
+  int k;
+
+  /* Not resolved yet: the output may have just appeared */
+  if ((!output && !crtc) || t->count == 0) {
+    return 1;
+  }
+  if (output) {
+    return target_has_output (t, output);
+  }
+  /* A disabled output may be enabled on any CRTC, a bound one may be
+     moved to another CRTC */
+  for (k = 0; k < t->count; k++) {
+    if (!t->crtcs[k]) {
+      return 1;
+    }
+  }
+
+  return target_has_crtc (t, crtc);
+}
+
+int
+xra_handle_error (xra_context *xra,
+		  XErrorEvent *error)
+{
+  if (error->display != xra->ctx.display) {
+    return 0;
+  }
+
+  /* No request can be made from the error handler: the write is
+     retried by the next xra_handle_event () */
+  return xerror_match (error->display, error);
+}
+
+/* Aligns again the screens of the bindings whose matrix write has
+   failed, the devices being looked up again by name. Returns 1 if
+   some were, -1 on failure. */
+static int
+retry_failed (xra_context *xra)
+{
+  XID failed[16];
+  int ret = 0;
+  int n, k, i, s;
+
+  while ((n = xerror_failed (xra->ctx.display, failed, 16)) > 0) {
+    for (k = 0; k < n; k++) {
+      connection_forget (&xra->ctx.conn, failed[k]);
+      for (i = 0; i < xra->count; i++) {
+	if (xra->als[i].deviceid == failed[k]) {
+	  memset (&xra->als[i], 0, sizeof (alignment));
+	  xra->caches[xra->screens[i]].dirty = 1;
+	}
+      }
+    }
+    ret = 1;
+  }
+  if (!ret) {
+    return 0;
+  }
+
+  /* The screens of the failed bindings only have been dirtied */
+  for (s = 0; s < ScreenCount (xra->ctx.display); s++) {
+    if (xra->caches[s].dirty &&
+	align_screen_bindings (xra, s) == EXIT_FAILURE) {
+      ret = -1;
+    }
+  }
+
+  return ret;
+}
+
+int
+xra_handle_event (xra_context *xra,
+		  XEvent *event)
+{
+  Window root;
+  int screen;
+  int i;
+  int ret;
+
+  RROutput output = None;
+  RRCrtc crtc = None;
+
+  ret = retry_failed (xra);
+  if (ret < 0) {
+    return -1;
+  }
+
+  /* A mode or rotation change comes as the screen change and the
+     CRTC changes, a hotplug or a reassignment as the output changes.
+     Any of them makes the screen cache stale; the bindings are
+     resolved and aligned again if it concerns one of them. */
+  switch (event->type - xra->event_base) {
+  case RRScreenChangeNotify:
+    XRRUpdateConfiguration (event);
+    root = ((XRRScreenChangeNotifyEvent *) event)->root;
+    break;
+  case RRNotify:
+    root = ((XRRNotifyEvent *) event)->window;
+    switch (((XRRNotifyEvent *) event)->subtype) {
+    case RRNotify_OutputChange:
+      output = ((XRROutputChangeNotifyEvent *) event)->output;
+      break;
+    case RRNotify_CrtcChange:
+      crtc = ((XRRCrtcChangeNotifyEvent *) event)->crtc;
+      break;
+    default:
+      return ret;
+    }
+    break;
+  default:
+    return ret;
+  }
+
+  screen = XRRRootToScreen (xra->ctx.display, root);
+  if (screen < 0) {
+    return ret;
+  }
+  xra->caches[screen].dirty = 1;
+  for (i = 0; i < xra->count; i++) {
+    if (xra->screens[i] == screen &&
+	concerns (&xra->targets[i], output, crtc)) {
+      break;
+    }
+  }
+  if (i == xra->count) {
+    return ret;
+  }
+
+  return align_screen_bindings (xra, screen) == EXIT_FAILURE ? -1 : 1;
+}
+
+int
+xra_get_matrix (xra_context *xra,
+		int binding,
+		float matrix[9])
+{
+  if (binding < 0 || binding >= xra->count || !xra->als[binding].crtc) {
+    return -1;
+  }
+
+  memcpy (matrix, xra->als[binding].matrix, 9 * sizeof (float));
+  return 0;
+}
+
+const char *
+xra_version (void)
+{
+  return VERSION;
+}
+
+/* end of libxrandr-align.c */
@@ -0,0 +1,138 @@
+/*
+ * Original xinput:
+ * Copyright 1996 by Frederic Lepied, France. <Frederic.Lepied@sugix.frmug.org>
+ *
+ * Original xrandr:
+ * Copyright © 2001 Keith Packard, member of The XFree86 Project, Inc.
+ * Copyright © 2002 Hewlett Packard Company, Inc.
+ * Copyright © 2006 Intel Corporation
+ *
+ * xrandr-align:
+ *
+ * Copyright © 2012 Paul Wolneykien <manowar@altlinux.org>, ALT Linux Ltd.
+ *
+ * Permission to use, copy, modify, distribute, and sell this software and its
+ * documentation for any purpose is  hereby granted without fee, provided that
+ * the  above copyright   notice appear  in   all  copies and  that both  that
+ * copyright  notice   and   this  permission   notice  appear  in  supporting
+ * documentation, and that   the  name of  the authors  not  be  used  in
+ * advertising or publicity pertaining to distribution of the software without
+ * specific,  written      prior  permission.     The authors  make  no
+ * representations about the suitability of this software for any purpose.  It
+ * is provided "as is" without express or implied warranty.
+ *
+ * THE AUTHORS DISCLAIM ALL   WARRANTIES WITH REGARD  TO  THIS SOFTWARE,
+ * INCLUDING ALL IMPLIED   WARRANTIES OF MERCHANTABILITY  AND   FITNESS, IN NO
+ * EVENT  SHALL THE AUTHORS  BE   LIABLE   FOR ANY  SPECIAL, INDIRECT   OR
+ * CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM LOSS OF USE,
+ * DATA  OR PROFITS, WHETHER  IN  AN ACTION OF  CONTRACT,  NEGLIGENCE OR OTHER
+ * TORTIOUS  ACTION, ARISING    OUT OF OR   IN  CONNECTION  WITH THE USE    OR
+ * PERFORMANCE OF THIS SOFTWARE.
+ *
+ */
+
+/* libxrandr-align: aligns the input devices with the RandR outputs
+ * over the caller's X connection.
+ *
+ *   xra_context *xra = xra_open (display);
+ *   xra_bind (xra, -1, "LVDS1", "eGalax Inc. USB TouchController");
+ *   xra_align (xra);
+ *   xra_select_events (xra);
+ *   ...
+ *   while (XNextEvent (display, &event) == 0) {
+ *     xra_handle_event (xra, &event);
+ *     ...
+ *   }
+ *   xra_close (xra);
+ *
+ * The matrices are written without a round trip, so a write to a
+ * device unplugged meanwhile fails later with an X error, and the
+ * default Xlib error handler exits the program on it. The caller
+ * routes the X errors of the display to the library from its own
+ * handler, which then ignores the errors the library takes:
+ *
+ *   static int
+ *   handler (Display *display, XErrorEvent *error)
+ *   {
+ *     if (xra_handle_error (xra, error) > 0)
+ *       return 0;
+ *     ...
+ *   }
+ *   XSetErrorHandler (handler);
+ *
+ * The functions returning int return 0 (or a non-negative value) on
+ * success and -1 on failure. */
+
+#ifndef LIBXRANDR_ALIGN_H
+#define LIBXRANDR_ALIGN_H
+
+#include <X11/Xlib.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct xra_context xra_context;
+
+/* Negotiates the XInput and RandR capabilities of the display. The
+   display stays owned by the caller. */
+xra_context *xra_open (Display *display);
+
+/* Closes the devices opened by the context and frees it (the
+   display is left open) */
+void xra_close (xra_context *xra);
+
+/* Prints the debug messages to stderr if non-zero */
+void xra_set_verbose (xra_context *xra, int verbose);
+
+/* Binds the input device (name or ID) to the output (name or ID,
+   NULL or "" for the primary one) of the screen (-1 for the default
+   screen). Returns the binding index. */
+int xra_bind (xra_context *xra, int screen, const char *output, const char *input);
+
+/* Binds the absolute input devices to the outputs of the screen
+   automatically by their physical sizes. Returns the number of the
+   bindings made. */
+int xra_auto_bind (xra_context *xra, int screen);
+
+/* Returns the number of the bindings */
+int xra_binding_count (xra_context *xra);
+
+/* Computes and writes the transformation matrices of all the
+   bindings */
+int xra_align (xra_context *xra);
+
+/* Selects the RandR events needed by xra_handle_event() on the root
+   windows of the bound screens */
+int xra_select_events (xra_context *xra);
+
+/* Realigns the bindings of the screen the RandR event is about: a
+   screen change, or an output or CRTC change concerning a binding.
+   The outputs of the bindings are resolved again, so an output that
+   is enabled, moved to another CRTC or plugged in is followed.
+   The bindings whose matrix write has failed since (see
+   xra_handle_error()) are aligned again first, whatever the event,
+   so it is called on every event.
+   Returns 1 if the event was handled or a binding realigned, 0 if it
+   is not a RandR event concerning a bound screen and -1 on
+   failure. */
+int xra_handle_event (xra_context *xra, XEvent *event);
+
+/* Takes the X error if it is about a matrix write of the library,
+   for the error handler of the caller. The write is retried by the
+   next xra_handle_event(). Returns 1 if the error is taken and is to
+   be ignored by the caller, 0 if it is not about the library. */
+int xra_handle_error (xra_context *xra, XErrorEvent *error);
+
+/* Copies the last matrix written for the binding. Returns -1 if the
+   binding was not aligned (i.e. its output is disabled). */
+int xra_get_matrix (xra_context *xra, int binding, float matrix[9]);
+
+/* The version of the library */
+const char *xra_version (void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* LIBXRANDR_ALIGN_H */
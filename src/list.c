@@ -33,6 +33,7 @@
 
 #include "common.h"
 #include "xrandr-align.h"
+#include "profile.h"
 #include <string.h>
 #include <X11/extensions/XIproto.h> /* for XI_Device***ChangedNotify */
 #include <X11/extensions/Xrandr.h>
@@ -122,7 +123,8 @@ static int list_xi1(Display     *display,
     int			loop;
     int                 num_devices;
 
-    info = XListInputDevices(display, &num_devices);
+    XPROF(display, "XListInputDevices",
+          info = XListInputDevices(display, &num_devices));
     for(loop=0; loop<num_devices; loop++) {
         print_info(display, info+loop, shortformat);
     }
@@ -237,7 +239,8 @@ list_xi2(Display *display,
     int i, j;
     XIDeviceInfo *info, *dev;
 
-    info = XIQueryDevice(display, XIAllDevices, &ndevices);
+    XPROF(display, "XIQueryDevice",
+          info = XIQueryDevice(display, XIAllDevices, &ndevices));
 
     for(i = 0; i < ndevices; i++)
     {
@@ -281,12 +284,11 @@ list_xi2(Display *display,
 #endif
 
 int
-list_input(Display	*display,
-	   int argc,
-	   const char	*argv[],
-	   const char	*name,
-	   const char	*desc)
+list_input(context *ctx)
 {
+    Display *display = ctx->display;
+    int argc = ctx->opts.argc;
+    const char **argv = ctx->opts.argv;
     int shortformat = (argc >= 1 && strcmp(argv[0], "--short") == 0);
     int longformat = (argc >= 1 && strcmp(argv[0], "--long") == 0);
     int arg_dev = shortformat || longformat;
@@ -294,7 +296,7 @@ list_input(Display	*display,
     if (argc > arg_dev)
     {
 #ifdef HAVE_XI2
-        if (check_xi2 (display))
+        if (ctx->conn.xi2)
         {
             XIDeviceInfo *info = xi2_find_device_info(display, argv[arg_dev]);
 
@@ -320,7 +322,7 @@ list_input(Display	*display,
         }
     } else {
 #ifdef HAVE_XI2
-        if (check_xi2 (display))
+        if (ctx->conn.xi2)
         {
                 return list_xi2(display, !longformat);
         }
@@ -330,34 +332,27 @@ list_input(Display	*display,
 }
 
 int
-list_output(Display *display,
-	    int	argc,
-	    const char *argv[],
-	    const char *progname,
-	    const char *usage)
+list_output(context *ctx)
 {
-  
-  int screen;
-  int ret = EXIT_FAILURE;
-
-  ret = get_screen (display, argc, argv, progname, usage, &screen);
-  if (ret == EXIT_SUCCESS) {
-    XRRScreenResources *res;
-    Window root;
-    int o;
-
-    root = RootWindow (display, screen);
-    res = XRRGetScreenResourcesCurrent (display, root);
-
-    for (o = 0; o < res->noutput; o++) {
-      XRROutputInfo *out = XRRGetOutputInfo (display, res, res->outputs[o]);
-      printf ("%s\tid=%lu\n", out->name, (unsigned long)res->outputs[o]);
-      XRRFreeOutputInfo (out);
-    }
-    XRRFreeScreenResources (res);
+  Display *display = ctx->display;
+  XRRScreenResources *res;
+  Window root;
+  int o;
+
+  root = RootWindow (display, ctx->opts.screen);
+  XPROF (display, "XRRGetScreenResourcesCurrent",
+	 res = XRRGetScreenResourcesCurrent (display, root));
+
+  for (o = 0; o < res->noutput; o++) {
+    XRROutputInfo *out;
+    XPROF (display, "XRRGetOutputInfo",
+	   out = XRRGetOutputInfo (display, res, res->outputs[o]));
+    printf ("%s\tid=%lu\n", out->name, (unsigned long)res->outputs[o]);
+    XRRFreeOutputInfo (out);
   }
+  XRRFreeScreenResources (res);
 
-  return ret;
+  return EXIT_SUCCESS;
 }
 
 /* end of list.c */
@@ -0,0 +1,295 @@
+/*
+ * Original xinput:
+ * Copyright 1996 by Frederic Lepied, France. <Frederic.Lepied@sugix.frmug.org>
+ *
+ * Original xrandr:
+ * Copyright © 2001 Keith Packard, member of The XFree86 Project, Inc.
+ * Copyright © 2002 Hewlett Packard Company, Inc.
+ * Copyright © 2006 Intel Corporation
+ *
+ * xrandr-align:
+ *
+ * Copyright © 2012 Paul Wolneykien <manowar@altlinux.org>, ALT Linux Ltd.
+ *
+ * Permission to use, copy, modify, distribute, and sell this software and its
+ * documentation for any purpose is  hereby granted without fee, provided that
+ * the  above copyright   notice appear  in   all  copies and  that both  that
+ * copyright  notice   and   this  permission   notice  appear  in  supporting
+ * documentation, and that   the  name of  the authors  not  be  used  in
+ * advertising or publicity pertaining to distribution of the software without
+ * specific,  written      prior  permission.     The authors  make  no
+ * representations about the suitability of this software for any purpose.  It
+ * is provided "as is" without express or implied warranty.
+ *
+ * THE AUTHORS DISCLAIM ALL   WARRANTIES WITH REGARD  TO  THIS SOFTWARE,
+ * INCLUDING ALL IMPLIED   WARRANTIES OF MERCHANTABILITY  AND   FITNESS, IN NO
+ * EVENT  SHALL THE AUTHORS  BE   LIABLE   FOR ANY  SPECIAL, INDIRECT   OR
+ * CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM LOSS OF USE,
+ * DATA  OR PROFITS, WHETHER  IN  AN ACTION OF  CONTRACT,  NEGLIGENCE OR OTHER
+ * TORTIOUS  ACTION, ARISING    OUT OF OR   IN  CONNECTION  WITH THE USE    OR
+ * PERFORMANCE OF THIS SOFTWARE.
+ *
+ */
+#include "common.h"
+#include "xrandr-align.h"
+#include "xerror.h"
+#include "metrics.h"
+#include <errno.h>
+#include <fcntl.h>
+#include <stdint.h>
+#include <string.h>
+#include <unistd.h>
+#ifdef HAVE_SYS_TIMERFD_H
+#include <sys/timerfd.h>
+#endif
+
+int
+metrics_open (context *ctx,
+	      const char *daemon,
+	      metrics_handler handler,
+	      void *data,
+	      metrics_writer **ret)
+{
+  const options *opts = &ctx->opts;
+  metrics_writer *m;
+  const char *dirarg, *intervalarg, *namearg;
+  const char *dpy;
+  char name[128];
+  char daemonlabel[64], dpylabel[128], namelabel[256];
+  char *endptr;
+  long interval;
+  char *p;
+
+  *ret = NULL;
+  if (get_argval (opts->argc, opts->argv, "metrics-dir", opts->funcname, opts->usage, NULL, &dirarg) == EXIT_FAILURE ||
+      get_argval (opts->argc, opts->argv, "metrics-interval", opts->funcname, opts->usage, NULL, &intervalarg) == EXIT_FAILURE ||
+      get_argval (opts->argc, opts->argv, "metrics-name", opts->funcname, opts->usage, NULL, &namearg) == EXIT_FAILURE) {
+    return EXIT_FAILURE;
+  }
+  /* The name of the control socket by default */
+  if (!namearg &&
+      get_argval (opts->argc, opts->argv, "name", opts->funcname, opts->usage, NULL, &namearg) == EXIT_FAILURE) {
+    return EXIT_FAILURE;
+  }
+  if (!dirarg) {
+    /* Disabled */
+    return EXIT_SUCCESS;
+  }
+  interval = METRICS_INTERVAL;
+  if (intervalarg) {
+    interval = strtol (intervalarg, &endptr, 0);
+    if (endptr == intervalarg || *endptr || interval <= 0) {
+      fprintf (stderr, "Invalid metrics interval: %s\n", intervalarg);
+      return EXIT_FAILURE;
+    }
+  }
+
+#ifndef HAVE_SYS_TIMERFD_H
+  fprintf (stderr, "The metrics are not supported on this system\n");
+  return EXIT_FAILURE;
+#else
+  m = calloc (1, sizeof (metrics_writer));
+  m->display = ctx->display;
+  m->handler = handler;
+  m->data = data;
+  m->started = time (NULL);
+
+  /* The processes serving the same display are told by the name */
+  dpy = DisplayString (ctx->display);
+  if (namearg) {
+    snprintf (name, sizeof (name), "%s-%s", namearg, dpy);
+  } else {
+    snprintf (name, sizeof (name), "%s", dpy);
+  }
+  for (p = name; *p; p++) {
+    if (*p == '/') {
+      *p = '_';
+    }
+  }
+  if (snprintf (m->path, sizeof (m->path), "%s/xrandr-align-%s-%s.prom",
+		dirarg, daemon, name) >= sizeof (m->path)) {
+    fprintf (stderr, "The metrics path is too long: %s\n", dirarg);
+    free (m);
+    return EXIT_FAILURE;
+  }
+
+  metrics_label (daemonlabel, sizeof (daemonlabel), "daemon", daemon);
+  metrics_label (dpylabel, sizeof (dpylabel), "display", dpy);
+  metrics_label (namelabel, sizeof (namelabel), "name", namearg ? namearg : "");
+  snprintf (m->labels, sizeof (m->labels), "%s,%s%s%s", daemonlabel, dpylabel,
+	    namearg ? "," : "", namearg ? namelabel : "");
+
+  m->timer = timerfd_create (CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+  if (m->timer < 0) {
+    perror ("timerfd_create");
+    free (m);
+    return EXIT_FAILURE;
+  } else {
+    struct itimerspec its;
+
+    memset (&its, 0, sizeof (its));
+    its.it_value.tv_sec = interval;
+    its.it_interval.tv_sec = interval;
+    timerfd_settime (m->timer, 0, &its, NULL);
+  }
+
+  if (ctx->verbose) {
+    fprintf (stderr, "Writing the metrics to %s every %li s\n", m->path, interval);
+  }
+
+  *ret = m;
+  return EXIT_SUCCESS;
+#endif
+}
+
+int
+metrics_fd (metrics_writer *m)
+{
+  return m ? m->timer : -1;
+}
+
+/* Quotes the label value as the text format wants it */
+void
+metrics_label (char *buf,
+	       size_t size,
+	       const char *name,
+	       const char *value)
+{
+  size_t len;
+
+  len = snprintf (buf, size, "%s=\"", name);
+  for (; *value && len + 4 < size; value++) {
+    switch (*value) {
+    case '\\':
+    case '"':
+      buf[len++] = '\\';
+      buf[len++] = *value;
+      break;
+    case '\n':
+      buf[len++] = '\\';
+      buf[len++] = 'n';
+      break;
+    default:
+      buf[len++] = *value;
+    }
+  }
+  if (len + 2 <= size) {
+    buf[len++] = '"';
+    buf[len] = '\0';
+  }
+}
+
+void
+metrics_family (metrics_writer *m,
+		const char *name,
+		const char *type,
+		const char *help)
+{
+  fprintf (m->out, "# HELP %s %s\n", name, help);
+  fprintf (m->out, "# TYPE %s %s\n", name, type);
+}
+
+void
+metrics_sample (metrics_writer *m,
+		const char *name,
+		const char *labels,
+		double value)
+{
+  fprintf (m->out, "%s{%s%s%s} %.17g\n", name, m->labels,
+	   labels ? "," : "", labels ? labels : "", value);
+}
+
+/* Writes the file aside and renames it over the previous one */
+static void
+metrics_write (metrics_writer *m,
+	       int up)
+{
+  char tmppath[sizeof (m->path) + 4];
+  unsigned long runs, failures;
+  double seconds;
+  int ret;
+
+  snprintf (tmppath, sizeof (tmppath), "%s.new", m->path);
+  m->out = fopen (tmppath, "w");
+  if (!m->out) {
+    perror (tmppath);
+    return;
+  }
+
+  metrics_family (m, "xrandr_align_up", "gauge",
+		  "Whether the daemon is running.");
+  metrics_sample (m, "xrandr_align_up", NULL, up);
+  metrics_family (m, "xrandr_align_start_time_seconds", "gauge",
+		  "The start time of the daemon since the epoch.");
+  metrics_sample (m, "xrandr_align_start_time_seconds", NULL, m->started);
+  metrics_family (m, "xrandr_align_x_errors_total", "counter",
+		  "The X errors received on the connection to the display.");
+  metrics_sample (m, "xrandr_align_x_errors_total", NULL, xerror_count (m->display));
+
+  script_stats (&runs, &failures, &seconds);
+  metrics_family (m, "xrandr_align_script_runs_total", "counter",
+		  "The pre- and post-scripts run.");
+  metrics_sample (m, "xrandr_align_script_runs_total", NULL, runs);
+  metrics_family (m, "xrandr_align_script_failures_total", "counter",
+		  "The pre- and post-scripts failed.");
+  metrics_sample (m, "xrandr_align_script_failures_total", NULL, failures);
+  metrics_family (m, "xrandr_align_script_seconds_total", "counter",
+		  "The time spent running the scripts.");
+  metrics_sample (m, "xrandr_align_script_seconds_total", NULL, seconds);
+
+  if (up) {
+    m->handler (m->data, m);
+  }
+
+  ret = ferror (m->out);
+  if (fclose (m->out) != 0 || ret) {
+    fprintf (stderr, "Unable to write %s\n", tmppath);
+    unlink (tmppath);
+  } else if (rename (tmppath, m->path) != 0) {
+    perror (m->path);
+    unlink (tmppath);
+  } else {
+    m->writes++;
+  }
+  m->out = NULL;
+}
+
+/* Writes the metrics if the interval is over */
+void
+metrics_tick (metrics_writer *m)
+{
+  uint64_t expirations;
+
+  if (!m) {
+    return;
+  }
+
+  if (read (m->timer, &expirations, sizeof (expirations)) == sizeof (expirations)) {
+    metrics_write (m, 1);
+  }
+}
+
+/* Leaves the daemon marked down */
+void
+metrics_close (metrics_writer *m)
+{
+  if (!m) {
+    return;
+  }
+
+  metrics_write (m, 0);
+  metrics_free (m);
+}
+
+void
+metrics_free (metrics_writer *m)
+{
+  if (!m) {
+    return;
+  }
+
+  close (m->timer);
+  free (m);
+}
+
+/* end of metrics.c */
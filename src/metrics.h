@@ -0,0 +1,119 @@
+/*
+ * Original xinput:
+ * Copyright 1996 by Frederic Lepied, France. <Frederic.Lepied@sugix.frmug.org>
+ *
+ * Original xrandr:
+ * Copyright © 2001 Keith Packard, member of The XFree86 Project, Inc.
+ * Copyright © 2002 Hewlett Packard Company, Inc.
+ * Copyright © 2006 Intel Corporation
+ *
+ * xrandr-align:
+ *
+ * Copyright © 2012 Paul Wolneykien <manowar@altlinux.org>, ALT Linux Ltd.
+ *
+ * Permission to use, copy, modify, distribute, and sell this software and its
+ * documentation for any purpose is  hereby granted without fee, provided that
+ * the  above copyright   notice appear  in   all  copies and  that both  that
+ * copyright  notice   and   this  permission   notice  appear  in  supporting
+ * documentation, and that   the  name of  the authors  not  be  used  in
+ * advertising or publicity pertaining to distribution of the software without
+ * specific,  written      prior  permission.     The authors  make  no
+ * representations about the suitability of this software for any purpose.  It
+ * is provided "as is" without express or implied warranty.
+ *
+ * THE AUTHORS DISCLAIM ALL   WARRANTIES WITH REGARD  TO  THIS SOFTWARE,
+ * INCLUDING ALL IMPLIED   WARRANTIES OF MERCHANTABILITY  AND   FITNESS, IN NO
+ * EVENT  SHALL THE AUTHORS  BE   LIABLE   FOR ANY  SPECIAL, INDIRECT   OR
+ * CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM LOSS OF USE,
+ * DATA  OR PROFITS, WHETHER  IN  AN ACTION OF  CONTRACT,  NEGLIGENCE OR OTHER
+ * TORTIOUS  ACTION, ARISING    OUT OF OR   IN  CONNECTION  WITH THE USE    OR
+ * PERFORMANCE OF THIS SOFTWARE.
+ *
+ */
+
+/*
+ * Textfile metrics of the daemons.
+ *
+ * With --metrics-dir=DIR a daemon writes its counters and gauges to
+ * DIR/xrandr-align-DAEMON-DISPLAY.prom every --metrics-interval
+ * seconds (15 by default), in the Prometheus text format read by the
+ * textfile collector of node_exporter. The file is written aside and
+ * renamed over the previous one, so a scrape never reads half of it.
+ * The writes are driven by a timer descriptor served with the other
+ * descriptors of the daemon loop: with no directory given there is
+ * no timer and no file, and the daemons only keep their counters.
+ * Invalid metrics options fail the daemon at the start, as the other
+ * options do.
+ *
+ * Several processes serving the same display are told apart with
+ * --metrics-name=NAME (--name=NAME by default): the file is then
+ * xrandr-align-DAEMON-NAME-DISPLAY.prom and the samples carry the
+ * name label too.
+ *
+ * Every sample carries the daemon and display labels. The families
+ * common to the daemons (start time, X errors, script runs) are
+ * written by the module, the rest by the handler of the daemon.
+ */
+
+#include <time.h>
+
+#define METRICS_INTERVAL 15
+
+typedef struct metrics_writer metrics_writer;
+
+/* Writes the samples of the daemon with metrics_family() and
+   metrics_sample() */
+typedef void (*metrics_handler) (void *data,
+				 metrics_writer *m);
+
+struct metrics_writer
+{
+  int timer;		/* the timer descriptor */
+  Display *display;	/* whose X errors are counted */
+  char path[256];
+  char labels[512];	/* daemon="...",display="..."[,name="..."] */
+  FILE *out;		/* while writing */
+  time_t started;
+  metrics_handler handler;
+  void *data;
+  unsigned long writes;
+};
+
+int
+metrics_open (context *ctx,
+	      const char *daemon,
+	      metrics_handler handler,
+	      void *data,
+	      metrics_writer **ret);
+
+int
+metrics_fd (metrics_writer *m);
+
+void
+metrics_tick (metrics_writer *m);
+
+void
+metrics_close (metrics_writer *m);
+
+/* Like metrics_close () without the last write, when the daemon fails
+   before serving */
+void
+metrics_free (metrics_writer *m);
+
+void
+metrics_family (metrics_writer *m,
+		const char *name,
+		const char *type,
+		const char *help);
+
+void
+metrics_sample (metrics_writer *m,
+		const char *name,
+		const char *labels,
+		double value);
+
+void
+metrics_label (char *buf,
+	       size_t size,
+	       const char *name,
+	       const char *value);
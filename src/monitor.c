@@ -33,67 +33,601 @@
 
 #include "common.h"
 #include "xrandr-align.h"
+#include "profile.h"
+#include "state.h"
+#include "control.h"
+#include "xerror.h"
+#include "trace.h"
+#include "target.h"
+#include "realtime.h"
+#include "metrics.h"
 #include <string.h>
+#include <time.h>
 #include <X11/extensions/Xrandr.h>
 
-int
-monitor (Display *display,
-	 int argc,
-	 const char *argv[],
-	 const char *funcname,
-	 const char *usage)
+/* A monitored binding */
+typedef struct
 {
+  binding *b;
+  int screen;
   RROutput outputid;
-  XRROutputInfo *output;
+  RRCrtc crtc;
+  char outname[256];
+  int group;		/* the output is a group of CRTCs */
+  target t;		/* the members of a group */
+  int pending;		/* a group member has changed */
+  XID deviceid;		/* the input, None until looked up */
+  alignment al;		/* the last one written */
+  unsigned long alignments;
+  unsigned long skipped;	/* not needed or the output is off */
+  unsigned long errors;		/* the alignments failed */
+  unsigned long failures;	/* the writes failed asynchronously */
+  time_t aligned;	/* the last alignment */
+  time_t retried;	/* the last retry of a failed write */
+} watch;
+
+/* The least time (seconds) between two retries of a watch */
+#define RETRY_INTERVAL 2
+
+/* The daemon state shared with the control commands */
+typedef struct
+{
+  context *ctx;
+  screen_cache *screens;
+  int nscreens;
+  watch *watches;
+  int count;
+  state_file *state;
+  unsigned long events;
+  unsigned long screen_changes;	/* the events by type */
+  unsigned long output_changes;
+  unsigned long crtc_changes;
+  unsigned long hierarchy_changes;
+  time_t started;
+} monitor_data;
+
+/* Checks for the named (or numbered) output on the screen quietly */
+static int
+has_output (Display *display,
+	    screen_cache *sc,
+	    const char *outname)
+{
+  char *endptr;
+  RROutput outnum;
+  int o;
+
+  outnum = (RROutput) strtol (outname, &endptr, 0);
+  for (o = 0; o < sc->res->noutput; o++) {
+    if (endptr != NULL && strlen (endptr) != 0) {
+      if (!sc->infos[o]) {
+	XPROF (display, "XRRGetOutputInfo",
+	       sc->infos[o] = XRRGetOutputInfo (display, sc->res, sc->res->outputs[o]));
+      }
+      if (strncmp (sc->infos[o]->name, outname, 256) == 0) {
+	return 1;
+      }
+    } else if (sc->res->outputs[o] == outnum) {
+      return 1;
+    }
+  }
+
+  return 0;
+}
+
+/* Finds the output of the binding and its current CRTC. A binding
+   watching all the screens is settled on the first screen having its
+   output (the primary output is looked for on the default screen). */
+static int
+locate_output (context *ctx,
+	       screen_cache *screens,
+	       int nscreens,
+	       watch *w)
+{
+  Display *display = ctx->display;
+  screen_cache *sc;
+  int o;
+
+  if (w->screen < 0) {
+    if (strlen (w->b->output) == 0 || w->group) {
+      w->screen = DefaultScreen (display);
+    } else {
+      int s;
+      for (s = 0; s < nscreens; s++) {
+	screen_refresh (display, &screens[s]);
+	if (has_output (display, &screens[s], w->b->output)) {
+	  w->screen = s;
+	  break;
+	}
+      }
+      if (w->screen < 0) {
+	fprintf (stderr, "Output '%s' not found on any screen\n", w->b->output);
+	return EXIT_FAILURE;
+      }
+    }
+  }
+
+  sc = &screens[w->screen];
+  screen_refresh (display, sc);
+
+  if (w->group) {
+    if (target_find (display, sc->root, sc->res, sc->infos, w->b->output, &w->t) == EXIT_FAILURE) {
+      return EXIT_FAILURE;
+    }
+    w->outputid = w->t.outputs[0];
+    w->crtc = target_crtc (&w->t);
+    snprintf (w->outname, sizeof (w->outname), "%s", w->b->output);
+    if (ctx->verbose) {
+      fprintf (stderr, "Monitoring the group: %s of %i outputs screen=%i\n", w->outname, w->t.count, w->screen);
+    }
+    return EXIT_SUCCESS;
+  }
+
+  o = find_output (display, sc->root, sc->res, sc->infos, w->b->output);
+  if (o < 0) {
+    return EXIT_FAILURE;
+  }
+
+  w->outputid = sc->res->outputs[o];
+  w->crtc = sc->infos[o]->crtc;
+  snprintf (w->outname, sizeof (w->outname), "%s", sc->infos[o]->name);
+
+  if (ctx->verbose) {
+    fprintf (stderr, "Monitoring the output: %s id=%u screen=%i\n", w->outname, (unsigned int) w->outputid, w->screen);
+  }
+
+  return EXIT_SUCCESS;
+}
+
+static int
+align_watch (context *ctx,
+	     screen_cache *screens,
+	     watch *w,
+	     RRCrtc crtc,
+	     state_file *state)
+{
+  Display *display = ctx->display;
+  screen_cache *sc;
+  alignment al;
   int ret;
-  const char *inputarg;
+
+  sc = &screens[w->screen];
+  screen_refresh (display, sc);
+
+  if (w->group) {
+    ret = compute_target_transform (ctx, sc, &w->t, &al);
+  } else {
+    ret = screen_transform (ctx, sc, crtc, &al);
+  }
+  if (ret != EXIT_FAILURE && w->deviceid) {
+    ret = write_transform_id (ctx, w->b->input, w->deviceid, &al);
+  } else if (ret != EXIT_FAILURE) {
+    ret = write_transform (ctx, w->b->input, &al);
+    /* Only the XI 2 hierarchy events tell when to look it up again */
+    if (ret != EXIT_FAILURE && ctx->conn.xi2) {
+      w->deviceid = al.deviceid;
+    }
+  }
+  if (ret != EXIT_FAILURE) {
+    w->al = al;
+    w->alignments++;
+    w->aligned = time (NULL);
+  } else {
+    w->errors++;
+  }
+  if (ret != EXIT_FAILURE && state) {
+    state_store (state, w->screen, w->b->output, w->b->input, w->outputid, &al);
+  }
+
+  return ret;
+}
+
+/* Locates the output anew and aligns the binding with its scripts.
+   A binding not aligned is counted in its errors. */
+static int
+realign_watch (context *ctx,
+	       screen_cache *screens,
+	       int nscreens,
+	       watch *w,
+	       state_file *state)
+{
+  if (locate_output (ctx, screens, nscreens, w) == EXIT_FAILURE ||
+      run_script (w->b->pre_script) == EXIT_FAILURE) {
+    w->errors++;
+    return EXIT_FAILURE;
+  }
+  if (align_watch (ctx, screens, w, w->crtc, state) == EXIT_FAILURE) {
+    return EXIT_FAILURE;
+  }
+
+  return run_script (w->b->post_script);
+}
+
+/* One binding failing to align (i.e. its device is unplugged or its
+   output gone) does not stop the daemon: the others are still
+   followed and this one is aligned again on the next change */
+static void
+report_failure (const watch *w)
+{
+  fprintf (stderr, "Unable to align %s: keep monitoring\n", w->b->input);
+}
+
+static int
+monitor_command (void *data,
+		 int argc,
+		 char *argv[],
+		 FILE *out)
+{
+  monitor_data *md = data;
+  int ret = EXIT_SUCCESS;
+  int i, j;
+
+  if (strcmp (argv[0], "realign") == 0) {
+    for (i = 0; i < md->count; i++) {
+      md->screens[md->watches[i].screen].dirty = 1;
+    }
+    for (i = 0; i < md->count; i++) {
+      watch *w = &md->watches[i];
+      if (realign_watch (md->ctx, md->screens, md->nscreens, w, md->state) == EXIT_FAILURE) {
+	fprintf (out, "\"%s\" failed\n", w->b->input);
+	ret = EXIT_FAILURE;
+      }
+    }
+  } else if (strcmp (argv[0], "bindings") == 0) {
+    for (i = 0; i < md->count; i++) {
+      watch *w = &md->watches[i];
+      fprintf (out, "\"%s\" \"%s\" screen=%i output=%s id=%u crtc=%u\n",
+	       w->b->output, w->b->input, w->screen, w->outname,
+	       (unsigned int) w->outputid, (unsigned int) w->crtc);
+    }
+  } else if (strcmp (argv[0], "matrices") == 0) {
+    for (i = 0; i < md->count; i++) {
+      watch *w = &md->watches[i];
+      if (!w->al.crtc) {
+	continue;
+      }
+      fprintf (out, "\"%s\"", w->b->input);
+      for (j = 0; j < 9; j++) {
+	fprintf (out, " %8.6f", w->al.matrix[j]);
+      }
+      fprintf (out, "\n");
+    }
+  } else if (strcmp (argv[0], "stats") == 0) {
+    fprintf (out, "uptime=%ld events=%lu x-errors=%lu\n", (long) (time (NULL) - md->started),
+	     md->events, xerror_count (md->ctx->display));
+    for (i = 0; i < md->count; i++) {
+      fprintf (out, "\"%s\" alignments=%lu skipped=%lu errors=%lu failures=%lu\n", md->watches[i].b->input,
+	       md->watches[i].alignments, md->watches[i].skipped,
+	       md->watches[i].errors, md->watches[i].failures);
+    }
+  } else {
+    fprintf (out, "Unknown command: %s\n", argv[0]);
+    ret = EXIT_FAILURE;
+  }
+
+  return ret;
+}
+
+/* The labels of a binding series: an input may be bound twice (on two
+   screens, or by --auto and the configuration), the binding index
+   keeps the series apart */
+static size_t
+binding_labels (const monitor_data *md,
+		int i,
+		char *labels,
+		size_t size)
+{
+  const watch *w = &md->watches[i];
+  size_t len;
+
+  len = snprintf (labels, size, "binding=\"%i\",screen=\"%i\",", i, w->screen);
+  if (len < size) {
+    metrics_label (labels + len, size - len, "output", w->b->output);
+    len = strlen (labels);
+  }
+  if (len + 1 < size) {
+    labels[len++] = ',';
+    metrics_label (labels + len, size - len, "input", w->b->input);
+  }
+
+  return strlen (labels);
+}
+
+static void
+monitor_metrics (void *data,
+		 metrics_writer *m)
+{
+  monitor_data *md = data;
+  char labels[1024];
+  int i;
+
+  metrics_family (m, "xrandr_align_events_total", "counter",
+		  "The RandR and XInput events received.");
+  metrics_sample (m, "xrandr_align_events_total", "type=\"screen_change\"", md->screen_changes);
+  metrics_sample (m, "xrandr_align_events_total", "type=\"output_change\"", md->output_changes);
+  metrics_sample (m, "xrandr_align_events_total", "type=\"crtc_change\"", md->crtc_changes);
+  metrics_sample (m, "xrandr_align_events_total", "type=\"hierarchy_change\"", md->hierarchy_changes);
+
+  metrics_family (m, "xrandr_align_alignments_total", "counter",
+		  "The alignments of the bindings by result.");
+  for (i = 0; i < md->count; i++) {
+    watch *w = &md->watches[i];
+    size_t len;
+
+    len = binding_labels (md, i, labels, sizeof (labels));
+    snprintf (labels + len, sizeof (labels) - len, ",result=\"applied\"");
+    metrics_sample (m, "xrandr_align_alignments_total", labels, w->alignments);
+    snprintf (labels + len, sizeof (labels) - len, ",result=\"skipped\"");
+    metrics_sample (m, "xrandr_align_alignments_total", labels, w->skipped);
+    snprintf (labels + len, sizeof (labels) - len, ",result=\"failed\"");
+    metrics_sample (m, "xrandr_align_alignments_total", labels, w->errors + w->failures);
+  }
+
+  metrics_family (m, "xrandr_align_last_alignment_seconds", "gauge",
+		  "The time of the last alignment of the binding since the epoch.");
+  for (i = 0; i < md->count; i++) {
+    binding_labels (md, i, labels, sizeof (labels));
+    metrics_sample (m, "xrandr_align_last_alignment_seconds", labels, md->watches[i].aligned);
+  }
+}
+
+/* Takes the output and CRTC from the state file if the recorded
+   configuration is still current and the device still has the
+   recorded matrix */
+static int
+restore_watch (context *ctx,
+	       screen_cache *screens,
+	       int nscreens,
+	       watch *w,
+	       state_file *state)
+{
+  const char *input = w->b->input;
+  XID deviceid = w->deviceid;
+  state_entry *e;
+  int s;
+
+  if (!deviceid) {
+    if (find_inputs (ctx->display, ctx->conn.xi2, &input, 1, &deviceid) == EXIT_FAILURE) {
+      return 0;
+    }
+    /* Only the XI 2 hierarchy events tell when to look it up again */
+    if (ctx->conn.xi2) {
+      w->deviceid = deviceid;
+    }
+  }
+
+  for (s = 0; s < nscreens; s++) {
+    if (w->screen >= 0 && s != w->screen) {
+      continue;
+    }
+    e = state_lookup (state, s, w->b->output, w->b->input);
+    if (e && state_check (ctx, screens[s].root, e, deviceid)) {
+      w->screen = s;
+      w->outputid = e->outputid;
+      w->crtc = e->crtc;
+      w->al.crtc = e->crtc;
+      memcpy (w->al.matrix, e->matrix, sizeof (w->al.matrix));
+      snprintf (w->outname, sizeof (w->outname), "%s", strlen (w->b->output) ? w->b->output : "(primary)");
+      w->skipped++;
+      if (ctx->verbose) {
+	fprintf (stderr, "The alignment of %s is up to date\n", w->b->input);
+      }
+      return 1;
+    }
+  }
+
+  return 0;
+}
+
+#if HAVE_XI2
+/* Selects the XI 2 hierarchy events: a device added or removed may
+   take the ID of a cached one */
+static void
+select_hierarchy (Display *display)
+{
+  unsigned char bits[XIMaskLen (XI_HierarchyChanged)];
+  XIEventMask mask;
+
+  memset (bits, 0, sizeof (bits));
+  XISetMask (bits, XI_HierarchyChanged);
+  mask.deviceid = XIAllDevices;
+  mask.mask_len = sizeof (bits);
+  mask.mask = bits;
+  XPROF (display, "XISelectEvents",
+	 XISelectEvents (display, DefaultRootWindow (display), &mask, 1));
+}
+#endif
+
+/* Realigns the groups having a changed member */
+static void
+realign_pending (monitor_data *md)
+{
+  int i;
+
+  for (i = 0; i < md->count; i++) {
+    watch *w = &md->watches[i];
+    if (!w->pending) {
+      continue;
+    }
+    w->pending = 0;
+    if (md->ctx->verbose) {
+      fprintf (stderr, "Realign the group %s\n", w->outname);
+    }
+    if (realign_watch (md->ctx, md->screens, md->nscreens, w, md->state) == EXIT_FAILURE) {
+      report_failure (w);
+    }
+  }
+}
+
+/* Retries the alignments whose matrix write has failed. The device
+   is looked up again by name, so a replugged device is rebound. */
+static void
+retry_failed (monitor_data *md)
+{
+  context *ctx = md->ctx;
+  XID failed[16];
+  time_t now;
+  int n, i, k;
+
+  n = xerror_failed (ctx->display, failed, 16);
+  if (n == 0) {
+    return;
+  }
+
+  now = time (NULL);
+  for (k = 0; k < n; k++) {
+    trace_event (TRACE_WRITE_FAILED, 0, failed[k], None, 0, 0, 0, 0, 0, NULL, 0, 0);
+    connection_forget (&ctx->conn, failed[k]);
+    for (i = 0; i < md->count; i++) {
+      watch *w = &md->watches[i];
+      if (w->al.deviceid != failed[k]) {
+	continue;
+      }
+      w->failures++;
+      w->al.deviceid = None;
+      w->deviceid = None;
+      if (now - w->retried < RETRY_INTERVAL) {
+	fprintf (stderr, "Unable to write the matrix of %s again: giving up until the next change\n",
+		 w->b->input);
+	continue;
+      }
+      fprintf (stderr, "Unable to write the matrix of %s (device %lu): retrying\n",
+	       w->b->input, (unsigned long) failed[k]);
+      w->retried = now;
+      if (realign_watch (ctx, md->screens, md->nscreens, w, md->state) == EXIT_FAILURE) {
+	report_failure (w);
+      }
+    }
+  }
+}
+
+int
+monitor (context *ctx)
+{
+  Display *display = ctx->display;
+  const options *opts = &ctx->opts;
+  int ret = EXIT_SUCCESS;
   int screen;
+  int nscreens;
   int event_base, error_base;
-  const char *pre_script;
-  const char *post_script;
+  state_file *state;
+  binding *bindings;
+  int count;
+  screen_cache *screens;
+  watch *watches;
+  monitor_data md;
+  control_server *control;
+  metrics_writer *metrics;
+  realtime_options rt;
+  int mfd;
+  int i, s;
+
+  memset (&md, 0, sizeof (md));
+  if (realtime_parse (opts, &rt) == EXIT_FAILURE ||
+      metrics_open (ctx, "monitor", monitor_metrics, &md, &metrics) == EXIT_FAILURE) {
+    return EXIT_FAILURE;
+  }
 
-  ret = align (display, argc, argv, funcname, usage);
+  control = NULL;
+  trace_install (display);
+  screen = opts->all_screens ? -1 : opts->screen;
+  nscreens = ScreenCount (display);
 
-  ret = get_screen (display, argc, argv, funcname, usage, &screen);
+  /* The auto bindings are made once at the start */
+  if (opts->autobind) {
+    bindings = NULL;
+    count = 0;
+    for (s = 0; s < nscreens && ret != EXIT_FAILURE; s++) {
+      if (screen < 0 || s == screen) {
+	ret = auto_bindings (ctx, RootWindow (display, s), &bindings, &count);
+      }
+    }
+    if (ret != EXIT_FAILURE && count == 0) {
+      fprintf (stderr, "No input devices to bind automatically\n");
+      ret = EXIT_FAILURE;
+    }
+  } else {
+    ret = get_bindings (opts, &bindings, &count);
+  }
   if (ret == EXIT_FAILURE) {
+    metrics_free (metrics);
     return ret;
   }
 
-  ret = get_argval (argc, argv, "input", funcname, usage, "Virtual core pointer", &inputarg);
-  if (ret == EXIT_FAILURE) {
-    return ret;
+  screens = calloc (nscreens, sizeof (screen_cache));
+  for (s = 0; s < nscreens; s++) {
+    screens[s].root = RootWindow (display, s);
+    screens[s].selected = screen < 0 || s == screen;
+    screens[s].dirty = 1;
   }
 
-  ret = get_output (display, argc, argv, funcname, usage, &outputid, &output);
-  if (ret == EXIT_FAILURE) {
-    return ret;
+  state = NULL;
+  if (!opts->no_state) {
+    state = state_open (ctx, opts->state);
   }
 
-  ret = get_argval (argc, argv, "pre-script", funcname, usage, "", &pre_script);
-  if (ret == EXIT_FAILURE) {
-    return ret;
+#if HAVE_XI2
+  /* Before the device IDs are looked up for the first time */
+  if (ctx->conn.xi2) {
+    select_hierarchy (display);
   }
+#endif
 
-  ret = get_argval (argc, argv, "post-script", funcname, usage, "", &post_script);
-  if (ret == EXIT_FAILURE) {
-    return ret;
+  watches = calloc (count, sizeof (watch));
+  for (i = 0; i < count && ret != EXIT_FAILURE; i++) {
+    watch *w = &watches[i];
+
+    w->b = &bindings[i];
+    w->screen = screen;
+    w->group = target_is_group (w->b->output);
+
+    /* A restored group still needs its members to follow them */
+    if (state && restore_watch (ctx, screens, nscreens, w, state) &&
+	(!w->group || locate_output (ctx, screens, nscreens, w) != EXIT_FAILURE)) {
+      continue;
+    }
+
+    ret = locate_output (ctx, screens, nscreens, w);
+
+    /* The initial alignment may fail (i.e. the output is disabled):
+       keep monitoring anyway. */
+    if (ret != EXIT_FAILURE &&
+	run_script (w->b->pre_script) != EXIT_FAILURE &&
+	align_watch (ctx, screens, w, w->crtc, state) != EXIT_FAILURE) {
+      run_script (w->b->post_script);
+    }
   }
 
-  if (!XRRQueryExtension (display, &event_base, &error_base)) {
+  if (ret != EXIT_FAILURE &&
+      !XRRQueryExtension (display, &event_base, &error_base)) {
     fprintf (stderr, "RandR extension missing\n");
     ret = EXIT_FAILURE;
   }
 
   if (ret != EXIT_FAILURE) {
-    Window root;
-
-    if (verbose) {
-      fprintf (stderr, "Monitoring the output: %s id=%u\n", output->name, (unsigned int)outputid);
+    for (s = 0; s < nscreens; s++) {
+      if (screens[s].selected) {
+	XPROF (display, "XRRSelectInput",
+	       XRRSelectInput (display, screens[s].root, RRScreenChangeNotifyMask | RROutputChangeNotifyMask | RRCrtcChangeNotifyMask));
+      }
     }
+
+    md.ctx = ctx;
+    md.screens = screens;
+    md.nscreens = nscreens;
+    md.watches = watches;
+    md.count = count;
+    md.state = state;
+    md.started = time (NULL);
+    control = control_open (ctx, "monitor", monitor_command, &md);
+    mfd = metrics_fd (metrics);
+
+    /* The steady state starts here: nothing is allocated by the
+       alignments but the Xlib replies */
+    realtime_apply (&rt, ctx->verbose);
+    xprof_report ("monitor setup");
     
-    root = RootWindow (display, screen);
-    XRRSelectInput (display, root, RRScreenChangeNotifyMask | RROutputChangeNotifyMask | RRCrtcChangeNotifyMask);
-    
+    /* The failed alignments are counted by binding: only a broken X
+       connection ends the loop, through the Xlib I/O error handler */
     while (ret != EXIT_FAILURE) {
       XEvent event;
       XRRScreenChangeNotifyEvent *sce;
@@ -101,72 +635,153 @@ monitor (Display *display,
       XRROutputChangeNotifyEvent *oce;
       XRRCrtcChangeNotifyEvent *cce;
       int escreen;
+      const char *evname = "event";
 
-      XNextEvent(display, &event);
+      if (!control_next_event (control, display, &mfd, 1, &event)) {
+	metrics_tick (metrics);
+	retry_failed (&md);
+	continue;
+      }
+      md.events++;
+
+      if (event.type == GenericEvent &&
+	  event.xcookie.extension == ctx->conn.xi_opcode) {
+	/* The input devices are looked up again on the next write */
+	evname = "XI_HierarchyChanged";
+	md.hierarchy_changes++;
+	if (ctx->verbose) {
+	  fprintf (stderr, "Get an input hierarchy change: forget the device IDs\n");
+	}
+	for (i = 0; i < count; i++) {
+	  watches[i].deviceid = None;
+	}
+      }
 
       switch (event.type - event_base) {
       case RRScreenChangeNotify:
 	sce = (XRRScreenChangeNotifyEvent *) &event;
-	if (verbose) {
+	evname = "RRScreenChangeNotify";
+	md.screen_changes++;
+	trace_event (TRACE_SCREEN_CHANGE, sce->timestamp, sce->root, None, 0, 0,
+		     sce->width, sce->height, sce->rotation, NULL, 0, 0);
+	if (ctx->verbose) {
 	  fprintf (stderr, "Get a RRScreenChangeNotifyEvent: (%u, %u) 0x%02x\n", sce->width, sce->height, sce->rotation);
 	}
 	escreen = XRRRootToScreen (sce->display, sce->root);
-	if (escreen == screen) {
-	  ret = run_script (pre_script);
-          if (ret != EXIT_FAILURE) {
-	    ret = apply_transform (sce->display, sce->root, output->crtc, inputarg);
-	    if (ret != EXIT_FAILURE) {
-	      ret = run_script (post_script);
+	if (escreen >= 0 && screens[escreen].selected) {
+	  XRRUpdateConfiguration (&event);
+	  screens[escreen].dirty = 1;
+	  for (i = 0; i < count; i++) {
+	    watch *w = &watches[i];
+	    if (w->screen != escreen) {
+	      continue;
 	    }
-	  }
-	  if (ret != EXIT_FAILURE) {
-	    root = sce->root;
-	    XRRFreeOutputInfo (output);
-	    ret = get_output (display, argc, argv, funcname, usage, &outputid, &output);
-	    if (verbose) {
-	      fprintf (stderr, "Monitoring the output: %s id=%u\n", output->name, (unsigned int)outputid);
+	    if (w->group) {
+	      w->pending = 1;
+	      continue;
+	    }
+	    if (realign_watch (ctx, screens, nscreens, w, state) == EXIT_FAILURE) {
+	      report_failure (w);
 	    }
 	  }
-	} else if (verbose) {
+	} else if (ctx->verbose) {
 	  fprintf (stderr, "Skip this event due to another screen number: %i\n", escreen);
 	}
 	break;
       case RRNotify:
 	ne = (XRRNotifyEvent *) &event;
+	escreen = XRRRootToScreen (ne->display, ne->window);
+	if (escreen < 0 || !screens[escreen].selected) {
+	  if (ctx->verbose) {
+	    fprintf (stderr, "Skip this event due to another screen number: %i\n", escreen);
+	  }
+	  break;
+	}
+	screens[escreen].dirty = 1;
 	switch (ne->subtype) {
 	case RRNotify_OutputChange:
 	  oce = (XRROutputChangeNotifyEvent *) ne;
-	  if (verbose) {
+	  evname = "RROutputChangeNotify";
+	  md.output_changes++;
+	  trace_event (TRACE_OUTPUT_CHANGE, 0, oce->output, oce->crtc, 0, 0,
+		       0, 0, oce->rotation, NULL, 0, 0);
+	  if (ctx->verbose) {
 	    fprintf (stderr, "Get a RROutputChangeNotifyEvent: %u %u 0x%02x\n", (unsigned int)oce->output, (unsigned int)oce->crtc, oce->rotation);
 	  }
-	  if (oce->output == outputid) {
+	  for (i = 0; i < count; i++) {
+	    watch *w = &watches[i];
+	    if (w->group) {
+	      w->pending |= w->screen == escreen && target_has_output (&w->t, oce->output);
+	      continue;
+	    }
+	    if (w->screen != escreen || oce->output != w->outputid) {
+	      if (ctx->verbose) {
+		fprintf (stderr, "Skip this event due to another output ID: %u\n", (unsigned int)oce->output);
+	      }
+	      continue;
+	    }
 	    if (oce->crtc) {
-	      ret = apply_transform (oce->display, root, oce->crtc, inputarg);
+	      w->crtc = oce->crtc;
+	      if (align_watch (ctx, screens, w, oce->crtc, state) == EXIT_FAILURE) {
+		report_failure (w);
+	      }
 	    } else {
 	      fprintf (stderr, "Output is disconnected: skip this event\n");
+	      w->skipped++;
 	    }
-	  } else if (verbose) {
-	    fprintf (stderr, "Skip this event due to another output ID: %u\n", (unsigned int)oce->output);
 	  }
 	  break;
 	case RRNotify_CrtcChange:
 	  cce = (XRRCrtcChangeNotifyEvent *) ne;
-	  if (verbose) {
+	  evname = "RRCrtcChangeNotify";
+	  md.crtc_changes++;
+	  trace_event (TRACE_CRTC_CHANGE, 0, cce->crtc, None, cce->x, cce->y,
+		       cce->width, cce->height, cce->rotation, NULL, 0, 0);
+	  if (ctx->verbose) {
 	    fprintf (stderr, "Get a RRCrtcChangeNotifyEvent: (%i, %i) (%u, %u) 0x%02x\n", cce->x, cce->y, cce->width, cce->height, cce->rotation);
 	  }
-	  if (output->crtc == cce->crtc) {
-	    ret = apply_transform (cce->display, root, cce->crtc, inputarg);
-	  } else if (verbose) {
-	    fprintf (stderr, "Skip this event due to another CRTC ID: %u\n", (unsigned int)cce->crtc);
+	  for (i = 0; i < count; i++) {
+	    watch *w = &watches[i];
+	    if (w->group) {
+	      w->pending |= w->screen == escreen && target_has_crtc (&w->t, cce->crtc);
+	      continue;
+	    }
+	    if (w->screen != escreen || w->crtc != cce->crtc) {
+	      if (ctx->verbose) {
+		fprintf (stderr, "Skip this event due to another CRTC ID: %u\n", (unsigned int)cce->crtc);
+	      }
+	      continue;
+	    }
+	    if (align_watch (ctx, screens, w, cce->crtc, state) == EXIT_FAILURE) {
+	      report_failure (w);
+	    }
 	  }
 	  break;
 	}
 	break;
       }
+
+      /* The groups are realigned once the burst of the events is
+	 over, however many of their members have changed */
+      if (!XPending (display)) {
+	realign_pending (&md);
+      }
+
+      retry_failed (&md);
+      metrics_tick (metrics);
+      xprof_report (evname);
     }
   }
 
-  XRRFreeOutputInfo (output);
+  metrics_close (metrics);
+  control_close (control);
+  for (s = 0; s < nscreens; s++) {
+    screen_free (&screens[s]);
+  }
+  free (screens);
+  free (watches);
+  free_bindings (bindings, count);
+  state_close (state);
   return ret;
 }
 
@@ -0,0 +1,456 @@
+/*
+ * Original xinput:
+ * Copyright 1996 by Frederic Lepied, France. <Frederic.Lepied@sugix.frmug.org>
+ *
+ * Original xrandr:
+ * Copyright © 2001 Keith Packard, member of The XFree86 Project, Inc.
+ * Copyright © 2002 Hewlett Packard Company, Inc.
+ * Copyright © 2006 Intel Corporation
+ *
+ * xrandr-align:
+ *
+ * Copyright © 2012 Paul Wolneykien <manowar@altlinux.org>, ALT Linux Ltd.
+ *
+ * Permission to use, copy, modify, distribute, and sell this software and its
+ * documentation for any purpose is  hereby granted without fee, provided that
+ * the  above copyright   notice appear  in   all  copies and  that both  that
+ * copyright  notice   and   this  permission   notice  appear  in  supporting
+ * documentation, and that   the  name of  the authors  not  be  used  in
+ * advertising or publicity pertaining to distribution of the software without
+ * specific,  written      prior  permission.     The authors  make  no
+ * representations about the suitability of this software for any purpose.  It
+ * is provided "as is" without express or implied warranty.
+ *
+ * THE AUTHORS DISCLAIM ALL   WARRANTIES WITH REGARD  TO  THIS SOFTWARE,
+ * INCLUDING ALL IMPLIED   WARRANTIES OF MERCHANTABILITY  AND   FITNESS, IN NO
+ * EVENT  SHALL THE AUTHORS  BE   LIABLE   FOR ANY  SPECIAL, INDIRECT   OR
+ * CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM LOSS OF USE,
+ * DATA  OR PROFITS, WHETHER  IN  AN ACTION OF  CONTRACT,  NEGLIGENCE OR OTHER
+ * TORTIOUS  ACTION, ARISING    OUT OF OR   IN  CONNECTION  WITH THE USE    OR
+ * PERFORMANCE OF THIS SOFTWARE.
+ *
+ */
+
+#include "common.h"
+#include "xrandr-align.h"
+#include "profile.h"
+#include "orientation.h"
+#include <math.h>
+#include <string.h>
+
+/* The axes considered, enough for any sensor */
+#define MAX_AXES 16
+
+/* The valuator of a device axis */
+typedef struct
+{
+  double min;
+  double max;
+  int resolution;	/* units per meter, 0 if unknown */
+  double value;		/* the current value */
+  int has_value;
+} axis_range;
+
+static int
+xi1_axes (XDeviceInfo *info,
+	  axis_range *ranges)
+{
+  XAnyClassPtr any;
+  XValuatorInfoPtr v;
+  int i, n;
+
+  any = (XAnyClassPtr) (info->inputclassinfo);
+  for (i = 0; i < info->num_classes; i++) {
+    if (any->class == ValuatorClass) {
+      v = (XValuatorInfoPtr) any;
+      for (n = 0; n < v->num_axes && n < MAX_AXES; n++) {
+	ranges[n].min = v->axes[n].min_value;
+	ranges[n].max = v->axes[n].max_value;
+	ranges[n].resolution = 0;
+	ranges[n].has_value = 0;
+      }
+      return n;
+    }
+    any = (XAnyClassPtr) ((char *) any + any->length);
+  }
+
+  return 0;
+}
+
+#if HAVE_XI2
+/* Reads the valuator classes, finding the "Abs X", "Abs Y" and
+   "Abs Z" labelled axes */
+static int
+xi2_axes (Display *display,
+	  int deviceid,
+	  axis_range *ranges,
+	  int labelled[3])
+{
+  static const char *labels[3] = { "Abs X", "Abs Y", "Abs Z" };
+  XIDeviceInfo *info;
+  Atom atoms[3];
+  int ndevices;
+  int i, k;
+  int n = 0;
+
+  XPROF (display, "XIQueryDevice",
+	 info = XIQueryDevice (display, deviceid, &ndevices));
+  if (!info) {
+    return 0;
+  }
+
+  for (k = 0; k < 3; k++) {
+    atoms[k] = XInternAtom (display, labels[k], True);
+  }
+
+  for (i = 0; i < info->num_classes; i++) {
+    XIValuatorClassInfo *v = (XIValuatorClassInfo *) info->classes[i];
+    if (v->type != XIValuatorClass || v->number >= MAX_AXES) {
+      continue;
+    }
+    ranges[v->number].min = v->min;
+    ranges[v->number].max = v->max;
+    ranges[v->number].resolution = v->resolution;
+    ranges[v->number].value = v->value;
+    ranges[v->number].has_value = 1;
+    for (k = 0; k < 3; k++) {
+      if (v->label != None && v->label == atoms[k]) {
+	labelled[k] = v->number;
+      }
+    }
+    if (v->number >= n) {
+      n = v->number + 1;
+    }
+  }
+
+  XIFreeDeviceInfo (info);
+
+  return n;
+}
+#endif
+
+/* Parses the axis mapping such as "x,y,z" or "-y,x": the device axis
+   (x, y, z or the axis number) of each screen axis, a minus sign
+   inverts it. The names refer to the labelled axes. */
+static int
+parse_axes (const char *spec,
+	    int num_axes,
+	    const int labelled[3],
+	    int axis[3],
+	    float sign[3])
+{
+  char buf[32];
+  char *tok, *save, *end;
+  int i = 0;
+
+  if (strlen (spec) >= sizeof (buf)) {
+    fprintf (stderr, "Invalid axis mapping: %s\n", spec);
+    return EXIT_FAILURE;
+  }
+  snprintf (buf, sizeof (buf), "%s", spec);
+
+  axis[2] = -1;
+  sign[2] = 1;
+  for (tok = strtok_r (buf, ",", &save); tok; tok = strtok_r (NULL, ",", &save)) {
+    if (i == 3) {
+      fprintf (stderr, "Too many axes: %s\n", spec);
+      return EXIT_FAILURE;
+    }
+    sign[i] = 1;
+    if (*tok == '-') {
+      sign[i] = -1;
+      tok++;
+    } else if (*tok == '+') {
+      tok++;
+    }
+    if (strcmp (tok, "x") == 0) {
+      axis[i] = labelled[0];
+    } else if (strcmp (tok, "y") == 0) {
+      axis[i] = labelled[1];
+    } else if (strcmp (tok, "z") == 0) {
+      axis[i] = labelled[2];
+    } else {
+      axis[i] = strtol (tok, &end, 10);
+      if (end == tok || *end != '\0' || axis[i] < 0) {
+	fprintf (stderr, "Invalid axis: %s\n", tok);
+	return EXIT_FAILURE;
+      }
+    }
+    if (axis[i] >= num_axes) {
+      /* The default z of a two axis device */
+      if (i == 2) {
+	axis[i] = -1;
+      } else {
+	fprintf (stderr, "The device has no axis %i\n", axis[i]);
+	return EXIT_FAILURE;
+      }
+    }
+    i++;
+  }
+  if (i < 2) {
+    fprintf (stderr, "Invalid axis mapping: %s\n", spec);
+    return EXIT_FAILURE;
+  }
+
+  return EXIT_SUCCESS;
+}
+
+/* Sets the classifier up for the device: ratio is the minimal
+   prevalence of one screen axis over the other, thr the minimal
+   prevailing component (m/s^2) unless range_thr, the one of the old
+   configurations as a fraction of the axis range, is non-zero, and
+   flat the angle (degrees) between the gravity and the screen plane
+   beyond which the device is taken as lying flat. The axes are calibrated from the XI 2 valuator
+   classes if available, from the XI 1 ranges otherwise. */
+int
+orientation_init (orientation_classifier *c,
+		  context *ctx,
+		  XDeviceInfo *info,
+		  const char *axes,
+		  double ratio,
+		  double thr,
+		  double range_thr,
+		  double flat)
+{
+  axis_range ranges[MAX_AXES];
+  int labelled[3] = { 0, 1, 2 };
+  int axis[3];
+  float sign[3];
+  int num_axes = 0;
+  int i;
+
+  if (ratio < 1.0) {
+    fprintf (stderr, "The ratio should not be less than 1\n");
+    return EXIT_FAILURE;
+  }
+  if (flat <= 0.0 || flat >= 90.0) {
+    fprintf (stderr, "The flat angle should be between 0 and 90 degrees\n");
+    return EXIT_FAILURE;
+  }
+
+  memset (ranges, 0, sizeof (ranges));
+#if HAVE_XI2
+  if (ctx->conn.xi2) {
+    num_axes = xi2_axes (ctx->display, info->id, ranges, labelled);
+  }
+#endif
+  if (num_axes == 0) {
+    num_axes = xi1_axes (info, ranges);
+  }
+  if (num_axes < 2) {
+    fprintf (stderr, "The device has no axes\n");
+    return EXIT_FAILURE;
+  }
+
+  if (parse_axes (axes, num_axes, labelled, axis, sign) == EXIT_FAILURE) {
+    return EXIT_FAILURE;
+  }
+
+  for (i = 0; i < 3; i++) {
+    axis_calibration *cal = &c->cal[i];
+    axis_range *r;
+
+    cal->axis = axis[i];
+    cal->offset = 0;
+    cal->scale = 0;
+    c->initial[i] = 0;
+    if (axis[i] < 0) {
+      continue;
+    }
+
+    r = &ranges[axis[i]];
+    if (r->max <= r->min) {
+      fprintf (stderr, "The axis %i has no range\n", axis[i]);
+      return EXIT_FAILURE;
+    }
+    cal->offset = (r->min + r->max) / 2;
+    if (r->resolution > 0) {
+      cal->scale = STANDARD_GRAVITY * 1000.0 / r->resolution;
+    } else {
+      cal->scale = STANDARD_GRAVITY * 2 / (r->max - r->min);
+    }
+    cal->scale *= sign[i];
+    if (r->has_value) {
+      c->initial[i] = (r->value - cal->offset) * cal->scale;
+    }
+    /* The axes of a sensor share their range: the x one is taken */
+    if (range_thr > 0 && i == 0) {
+      thr = range_thr * (r->max - r->min) * fabs (cal->scale);
+    }
+
+    if (ctx->verbose) {
+      fprintf (stderr, "Axis %c: device axis %i, offset %f, scale %g m/s^2 (%s)\n",
+	       "xyz"[i], cal->axis, cal->offset, cal->scale,
+	       r->resolution > 0 ? "resolution" : "range");
+    }
+  }
+
+  if (ctx->verbose && range_thr > 0) {
+    fprintf (stderr, "Threshold: %g of the range, %g m/s^2\n", range_thr, thr);
+  }
+  c->thr = thr;
+  c->ratio2 = ratio * ratio;
+  c->flat2 = tan (flat * M_PI / 180.0);
+  c->flat2 *= c->flat2;
+
+  return EXIT_SUCCESS;
+}
+
+/* Updates the gravity vector g with the axes of a motion event: the
+   axes not in the event keep their last values */
+void
+orientation_sample (const orientation_classifier *c,
+		    const int *axis_data,
+		    int first_axis,
+		    int axes_count,
+		    float g[3])
+{
+  const axis_calibration *cal;
+  int i, k;
+
+  for (i = 0; i < 3; i++) {
+    cal = &c->cal[i];
+    k = cal->axis - first_axis;
+    if (cal->axis >= 0 && k >= 0 && k < axes_count) {
+      g[i] = (axis_data[k] - cal->offset) * cal->scale;
+    }
+  }
+}
+
+/* Likewise for an XI 2 raw event: the values are packed in the
+   order of the bits set in the mask, so only the bits below the
+   calibrated axes are counted and the other axes are not decoded */
+void
+orientation_sample_raw (const orientation_classifier *c,
+			const unsigned char *mask,
+			int mask_len,
+			const double *values,
+			float g[3])
+{
+  const axis_calibration *cal;
+  int i, b, k, byte, bit;
+
+  for (i = 0; i < 3; i++) {
+    cal = &c->cal[i];
+    byte = cal->axis >> 3;
+    bit = 1 << (cal->axis & 7);
+    if (cal->axis < 0 || byte >= mask_len || !(mask[byte] & bit)) {
+      continue;
+    }
+    k = __builtin_popcount (mask[byte] & (bit - 1));
+    for (b = 0; b < byte; b++) {
+      k += __builtin_popcount (mask[b]);
+    }
+    g[i] = (values[k] - cal->offset) * cal->scale;
+  }
+}
+
+/* Classifies n samples writing the rotations (0 if none) to out */
+void
+orientation_classify (const orientation_classifier *c,
+		      const float *x,
+		      const float *y,
+		      const float *z,
+		      int n,
+		      unsigned char *out)
+{
+  const float thr = c->thr;
+  const float ratio2 = c->ratio2;
+  const float flat2 = c->flat2;
+  int i;
+
+  for (i = 0; i < n; i++) {
+    float xx = x[i] * x[i];
+    float yy = y[i] * y[i];
+    int upright = z[i] * z[i] <= flat2 * (xx + yy);
+    int vert = yy >= ratio2 * xx;
+    int horiz = xx > ratio2 * yy;
+
+    out[i] = upright * (vert * ((y[i] > thr) * RR_Rotate_0 +
+				(y[i] < -thr) * RR_Rotate_180) +
+			horiz * ((x[i] < -thr) * RR_Rotate_90 +
+				 (x[i] > thr) * RR_Rotate_270));
+  }
+}
+
+/* The pitch (about the screen x) and the roll (about the screen y)
+   in degrees, for the diagnostics */
+void
+orientation_angles (const float g[3],
+		    double *pitch,
+		    double *roll)
+{
+  *pitch = atan2 (g[1], sqrt (g[0] * g[0] + g[2] * g[2])) * 180.0 / M_PI;
+  *roll = atan2 (g[0], sqrt (g[1] * g[1] + g[2] * g[2])) * 180.0 / M_PI;
+}
+
+int
+orientation_reducer_init (orientation_reducer *r,
+			  const char *mode)
+{
+  memset (r, 0, sizeof (orientation_reducer));
+
+  if (strcmp (mode, "latest") == 0) {
+    r->mode = REDUCE_LATEST;
+  } else if (strcmp (mode, "mean") == 0) {
+    r->mode = REDUCE_MEAN;
+  } else if (strcmp (mode, "filter") == 0) {
+    r->mode = REDUCE_FILTER;
+  } else {
+    fprintf (stderr, "Invalid reduction: %s\n", mode);
+    return EXIT_FAILURE;
+  }
+
+  return EXIT_SUCCESS;
+}
+
+/* Reduces the n > 0 samples to the vector g */
+void
+orientation_reduce (orientation_reducer *r,
+		    const float *x,
+		    const float *y,
+		    const float *z,
+		    int n,
+		    float g[3])
+{
+  float sx = 0, sy = 0, sz = 0;
+  int i;
+
+  switch (r->mode) {
+  case REDUCE_LATEST:
+    g[0] = x[n - 1];
+    g[1] = y[n - 1];
+    g[2] = z[n - 1];
+    break;
+  case REDUCE_MEAN:
+    for (i = 0; i < n; i++) {
+      sx += x[i];
+      sy += y[i];
+      sz += z[i];
+    }
+    g[0] = sx / n;
+    g[1] = sy / n;
+    g[2] = sz / n;
+    break;
+  case REDUCE_FILTER:
+    i = 0;
+    if (!r->primed) {
+      r->f[0] = x[0];
+      r->f[1] = y[0];
+      r->f[2] = z[0];
+      r->primed = 1;
+      i = 1;
+    }
+    for (; i < n; i++) {
+      r->f[0] += ORIENTATION_FILTER_ALPHA * (x[i] - r->f[0]);
+      r->f[1] += ORIENTATION_FILTER_ALPHA * (y[i] - r->f[1]);
+      r->f[2] += ORIENTATION_FILTER_ALPHA * (z[i] - r->f[2]);
+    }
+    g[0] = r->f[0];
+    g[1] = r->f[1];
+    g[2] = r->f[2];
+    break;
+  }
+}
+
+/* end of orientation.c */
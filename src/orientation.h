@@ -0,0 +1,148 @@
+/*
+ * Original xinput:
+ * Copyright 1996 by Frederic Lepied, France. <Frederic.Lepied@sugix.frmug.org>
+ *
+ * Original xrandr:
+ * Copyright © 2001 Keith Packard, member of The XFree86 Project, Inc.
+ * Copyright © 2002 Hewlett Packard Company, Inc.
+ * Copyright © 2006 Intel Corporation
+ *
+ * xrandr-align:
+ *
+ * Copyright © 2012 Paul Wolneykien <manowar@altlinux.org>, ALT Linux Ltd.
+ *
+ * Permission to use, copy, modify, distribute, and sell this software and its
+ * documentation for any purpose is  hereby granted without fee, provided that
+ * the  above copyright   notice appear  in   all  copies and  that both  that
+ * copyright  notice   and   this  permission   notice  appear  in  supporting
+ * documentation, and that   the  name of  the authors  not  be  used  in
+ * advertising or publicity pertaining to distribution of the software without
+ * specific,  written      prior  permission.     The authors  make  no
+ * representations about the suitability of this software for any purpose.  It
+ * is provided "as is" without express or implied warranty.
+ *
+ * THE AUTHORS DISCLAIM ALL   WARRANTIES WITH REGARD  TO  THIS SOFTWARE,
+ * INCLUDING ALL IMPLIED   WARRANTIES OF MERCHANTABILITY  AND   FITNESS, IN NO
+ * EVENT  SHALL THE AUTHORS  BE   LIABLE   FOR ANY  SPECIAL, INDIRECT   OR
+ * CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM LOSS OF USE,
+ * DATA  OR PROFITS, WHETHER  IN  AN ACTION OF  CONTRACT,  NEGLIGENCE OR OTHER
+ * TORTIOUS  ACTION, ARISING    OUT OF OR   IN  CONNECTION  WITH THE USE    OR
+ * PERFORMANCE OF THIS SOFTWARE.
+ *
+ */
+
+/*
+ * Orientation classifier of gravitate.
+ *
+ * The sensor samples are mapped to the screen axes (x to the right,
+ * y up, z towards the viewer, each one possibly taken from another
+ * device axis and inverted to match the mounting of the sensor) and
+ * converted to m/s^2 by the per-axis calibration. A sample is
+ * classified as:
+ *
+ *  - none, if the device lies near face-up or face-down: the gravity
+ *    vector is closer to z than the flat angle;
+ *  - normal or inverted, if y prevails over x by the ratio and is
+ *    beyond the threshold;
+ *  - left or right, likewise for x.
+ *
+ * Devices with two axes are classified with z = 0. The samples are
+ * passed as separate x, y and z arrays and classified in one branch
+ * free pass, so the loop is vectorized by the compiler.
+ */
+
+#define STANDARD_GRAVITY 9.80665
+
+/* The calibration of a screen axis, computed once from the device
+ * valuator:
+ *
+ *   a = (value - offset) * scale   [m/s^2]
+ *
+ * The scale comes from the valuator resolution if known (the evdev
+ * driver reports the kernel one, units per g for accelerometers,
+ * times 1000), otherwise the half of the range is taken as 1 g. The
+ * sign of the scale is the mounting inversion.
+ */
+typedef struct
+{
+  int axis;		/* the device axis, -1 if none */
+  float offset;		/* the value at zero acceleration */
+  float scale;		/* m/s^2 per unit */
+} axis_calibration;
+
+typedef struct
+{
+  axis_calibration cal[3];	/* of x, y, z */
+  float initial[3];	/* the gravity at the start, m/s^2 */
+  float thr;		/* the minimal prevailing component, m/s^2 */
+  float ratio2;		/* the squared prevalence ratio */
+  float flat2;		/* the squared tangent of the flat angle */
+} orientation_classifier;
+
+int
+orientation_init (orientation_classifier *c,
+		  context *ctx,
+		  XDeviceInfo *info,
+		  const char *axes,
+		  double ratio,
+		  double thr,
+		  double range_thr,
+		  double flat);
+
+void
+orientation_sample (const orientation_classifier *c,
+		    const int *axis_data,
+		    int first_axis,
+		    int axes_count,
+		    float g[3]);
+
+void
+orientation_sample_raw (const orientation_classifier *c,
+			const unsigned char *mask,
+			int mask_len,
+			const double *values,
+			float g[3]);
+
+void
+orientation_classify (const orientation_classifier *c,
+		      const float *x,
+		      const float *y,
+		      const float *z,
+		      int n,
+		      unsigned char *out);
+
+void
+orientation_angles (const float g[3],
+		    double *pitch,
+		    double *roll);
+
+/* The reduction of a batch of samples to one gravity vector: the
+   latest sample, the mean of the batch or the low-pass filter
+   running over all the samples */
+typedef enum
+{
+  REDUCE_LATEST,
+  REDUCE_MEAN,
+  REDUCE_FILTER
+} reduce_mode;
+
+#define ORIENTATION_FILTER_ALPHA 0.25
+
+typedef struct
+{
+  reduce_mode mode;
+  float f[3];		/* the filter state */
+  int primed;		/* the filter state is set */
+} orientation_reducer;
+
+int
+orientation_reducer_init (orientation_reducer *r,
+			  const char *mode);
+
+void
+orientation_reduce (orientation_reducer *r,
+		    const float *x,
+		    const float *y,
+		    const float *z,
+		    int n,
+		    float g[3]);
@@ -0,0 +1,436 @@
+/*
+ * Original xinput:
+ * Copyright 1996 by Frederic Lepied, France. <Frederic.Lepied@sugix.frmug.org>
+ *
+ * Original xrandr:
+ * Copyright © 2001 Keith Packard, member of The XFree86 Project, Inc.
+ * Copyright © 2002 Hewlett Packard Company, Inc.
+ * Copyright © 2006 Intel Corporation
+ *
+ * xrandr-align:
+ *
+ * Copyright © 2012 Paul Wolneykien <manowar@altlinux.org>, ALT Linux Ltd.
+ *
+ * Permission to use, copy, modify, distribute, and sell this software and its
+ * documentation for any purpose is  hereby granted without fee, provided that
+ * the  above copyright   notice appear  in   all  copies and  that both  that
+ * copyright  notice   and   this  permission   notice  appear  in  supporting
+ * documentation, and that   the  name of  the authors  not  be  used  in
+ * advertising or publicity pertaining to distribution of the software without
+ * specific,  written      prior  permission.     The authors  make  no
+ * representations about the suitability of this software for any purpose.  It
+ * is provided "as is" without express or implied warranty.
+ *
+ * THE AUTHORS DISCLAIM ALL   WARRANTIES WITH REGARD  TO  THIS SOFTWARE,
+ * INCLUDING ALL IMPLIED   WARRANTIES OF MERCHANTABILITY  AND   FITNESS, IN NO
+ * EVENT  SHALL THE AUTHORS  BE   LIABLE   FOR ANY  SPECIAL, INDIRECT   OR
+ * CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM LOSS OF USE,
+ * DATA  OR PROFITS, WHETHER  IN  AN ACTION OF  CONTRACT,  NEGLIGENCE OR OTHER
+ * TORTIOUS  ACTION, ARISING    OUT OF OR   IN  CONNECTION  WITH THE USE    OR
+ * PERFORMANCE OF THIS SOFTWARE.
+ *
+ */
+
+#include "common.h"
+#include "xrandr-align.h"
+#include "profile.h"
+#include "policy.h"
+#include <string.h>
+#include <X11/Xatom.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#if HAVE_LINUX_INPUT_H
+#include <dirent.h>
+#include <sys/ioctl.h>
+#include <linux/input.h>
+#endif
+
+#define ROTATIONS (RR_Rotate_0 | RR_Rotate_90 | RR_Rotate_180 | RR_Rotate_270)
+
+void
+policy_init (rotation_policy *p,
+	     Rotation allowed)
+{
+  memset (p, 0, sizeof (rotation_policy));
+  p->allowed = allowed;
+  p->docked = RR_Rotate_0;
+  p->tablet = TABLET_UNKNOWN;
+}
+
+/* Returns the rotation to apply now or 0 to keep the current one.
+   The wanted rotation is the new sensor decision, 0 to reconsider
+   the last one after a signal change. */
+Rotation
+policy_decide (rotation_policy *p,
+	       Rotation wanted,
+	       Rotation current,
+	       time_t now)
+{
+  Rotation lock;
+  Rotation target;
+
+  if (wanted) {
+    p->pending = wanted;
+  }
+
+  /* An explicit lock wins over the other signals */
+  lock = p->lock ? p->lock : p->prop_lock;
+  if (lock) {
+    return (lock != current && (lock & p->allowed)) ? lock : 0;
+  }
+  if (p->paused) {
+    return 0;
+  }
+
+  if (p->touches > 0) {
+    if (now - p->touch_time < POLICY_TOUCH_TIMEOUT) {
+      goto hold;
+    }
+    p->touches = 0;
+  }
+
+  target = p->tablet == 0 ? p->docked : p->pending;
+  if (!target || target == current) {
+    return 0;
+  }
+  if (target & p->allowed) {
+    return target;
+  }
+
+ hold:
+  if (wanted && wanted != current) {
+    p->held++;
+  }
+  return 0;
+}
+
+Rotation
+parse_rotation (const char *arg)
+{
+  if (strcmp (arg, "0") == 0 || strcmp (arg, "normal") == 0) {
+    return RR_Rotate_0;
+  } else if (strcmp (arg, "90") == 0 || strcmp (arg, "left") == 0) {
+    return RR_Rotate_90;
+  } else if (strcmp (arg, "180") == 0 || strcmp (arg, "inverted") == 0) {
+    return RR_Rotate_180;
+  } else if (strcmp (arg, "270") == 0 || strcmp (arg, "right") == 0) {
+    return RR_Rotate_270;
+  }
+
+  return 0;
+}
+
+/* Parses a comma separated list of rotations into a mask */
+int
+parse_rotations (const char *arg,
+		 Rotation *retmask)
+{
+  char buf[64];
+  char *tok, *save;
+  Rotation rot;
+
+  if (strlen (arg) >= sizeof (buf)) {
+    fprintf (stderr, "Invalid rotation list: %s\n", arg);
+    return EXIT_FAILURE;
+  }
+  snprintf (buf, sizeof (buf), "%s", arg);
+
+  *retmask = 0;
+  for (tok = strtok_r (buf, ",", &save); tok; tok = strtok_r (NULL, ",", &save)) {
+    rot = parse_rotation (tok);
+    if (!rot) {
+      fprintf (stderr, "Invalid rotation: %s\n", tok);
+      return EXIT_FAILURE;
+    }
+    *retmask |= rot;
+  }
+
+  return EXIT_SUCCESS;
+}
+
+/* The rotations supported by the screen and by the CRTCs of the
+   given outputs (of the primary one if none is given) */
+Rotation
+allowed_rotations (Display *display,
+		   Window root,
+		   const char **outputs,
+		   int noutputs)
+{
+  XRRScreenConfiguration *sconf;
+  XRRScreenResources *res;
+  XRROutputInfo **infos;
+  XRRCrtcInfo *crtc;
+  Rotation allowed;
+  Rotation crot;
+  int i, o;
+
+  XPROF (display, "XRRGetScreenInfo",
+	 sconf = XRRGetScreenInfo (display, root));
+  allowed = XRRConfigRotations (sconf, &crot) & ROTATIONS;
+  XRRFreeScreenConfigInfo (sconf);
+
+  XPROF (display, "XRRGetScreenResourcesCurrent",
+	 res = XRRGetScreenResourcesCurrent (display, root));
+  infos = calloc (res->noutput, sizeof (XRROutputInfo *));
+
+  for (i = 0; i < (noutputs > 0 ? noutputs : 1); i++) {
+    o = find_output (display, root, res, infos, noutputs > 0 ? outputs[i] : "");
+    if (o < 0 || !infos[o]->crtc) {
+      continue;
+    }
+    XPROF (display, "XRRGetCrtcInfo",
+	   crtc = XRRGetCrtcInfo (display, res, infos[o]->crtc));
+    if (crtc) {
+      allowed &= crtc->rotations;
+      XRRFreeCrtcInfo (crtc);
+    }
+  }
+
+  free_output_infos (res, infos);
+  XRRFreeScreenResources (res);
+
+  return allowed;
+}
+
+/* The lock set on the root window:
+ *
+ *   xprop -root -f _XRANDR_ALIGN_ROTATION_LOCK 32c \
+ *         -set _XRANDR_ALIGN_ROTATION_LOCK 90
+ *
+ * 0, 90, 180 or 270 lock the given rotation, any other value the
+ * current one. Without the property the rotation is not locked.
+ */
+Rotation
+read_rotation_lock (Display *display,
+		    Window root,
+		    Atom prop,
+		    Rotation current)
+{
+  Atom type;
+  int format;
+  unsigned long n, after;
+  unsigned char *data = NULL;
+  Rotation lock = 0;
+  int ret;
+
+  XPROF (display, "XGetWindowProperty",
+	 ret = XGetWindowProperty (display, root, prop, 0, 1, False, XA_CARDINAL,
+				   &type, &format, &n, &after, &data));
+  if (ret == Success && type == XA_CARDINAL && format == 32 && n > 0) {
+    switch (*(long *) data) {
+    case 0:
+      lock = RR_Rotate_0;
+      break;
+    case 90:
+      lock = RR_Rotate_90;
+      break;
+    case 180:
+      lock = RR_Rotate_180;
+      break;
+    case 270:
+      lock = RR_Rotate_270;
+      break;
+    default:
+      lock = current;
+    }
+  }
+  if (data) {
+    XFree (data);
+  }
+
+  return lock;
+}
+
+#if HAVE_XI2
+/* Touches of all the master devices are counted by their raw events
+   which, unlike the touch events, are not exclusive to a client */
+int
+select_touch_events (context *ctx,
+		     Window root)
+{
+#ifdef XI_RawTouchEnd
+  unsigned char bits[XIMaskLen (XI_LASTEVENT)];
+  XIEventMask mask;
+
+  if (!ctx->conn.xi2) {
+    return EXIT_FAILURE;
+  }
+
+  memset (bits, 0, sizeof (bits));
+  XISetMask (bits, XI_RawTouchBegin);
+  XISetMask (bits, XI_RawTouchEnd);
+  mask.deviceid = XIAllMasterDevices;
+  mask.mask_len = sizeof (bits);
+  mask.mask = bits;
+  XPROF (ctx->display, "XISelectEvents",
+	 XISelectEvents (ctx->display, root, &mask, 1));
+
+  return EXIT_SUCCESS;
+#else
+  return EXIT_FAILURE;
+#endif
+}
+
+/* Updates the touch count, returns 1 if the event is a touch one */
+int
+policy_touch_event (rotation_policy *p,
+		    context *ctx,
+		    XEvent *event,
+		    time_t now)
+{
+  int ret = 0;
+#ifdef XI_RawTouchEnd
+  XGenericEventCookie *cookie = &event->xcookie;
+
+  if (cookie->type != GenericEvent ||
+      cookie->extension != ctx->conn.xi_opcode ||
+      !XGetEventData (ctx->display, cookie)) {
+    return 0;
+  }
+
+  switch (cookie->evtype) {
+  case XI_RawTouchBegin:
+    p->touches++;
+    p->touch_time = now;
+    ret = 1;
+    break;
+  case XI_RawTouchEnd:
+    if (p->touches > 0) {
+      p->touches--;
+    }
+    p->touch_time = now;
+    ret = 1;
+    break;
+  }
+
+  XFreeEventData (ctx->display, cookie);
+#endif
+  return ret;
+}
+#endif
+
+#if HAVE_LINUX_INPUT_H
+#define LONG_BITS (sizeof (long) * 8)
+#define TEST_BIT(bit, array) \
+  ((array[(bit) / LONG_BITS] >> ((bit) % LONG_BITS)) & 1)
+
+static int
+read_switch_state (int fd,
+		   int *retstate)
+{
+  unsigned long bits[SW_MAX / LONG_BITS + 1];
+
+  memset (bits, 0, sizeof (bits));
+  if (ioctl (fd, EVIOCGSW (sizeof (bits)), bits) < 0) {
+    return EXIT_FAILURE;
+  }
+  *retstate = TEST_BIT (SW_TABLET_MODE, bits);
+
+  return EXIT_SUCCESS;
+}
+
+static int
+open_switch (const char *path,
+	     int *retstate)
+{
+  unsigned long bits[SW_MAX / LONG_BITS + 1];
+  int fd;
+
+  fd = open (path, O_RDONLY | O_NONBLOCK | O_CLOEXEC);
+  if (fd < 0) {
+    return -1;
+  }
+
+  memset (bits, 0, sizeof (bits));
+  if (ioctl (fd, EVIOCGBIT (EV_SW, sizeof (bits)), bits) < 0 ||
+      !TEST_BIT (SW_TABLET_MODE, bits) ||
+      read_switch_state (fd, retstate) != EXIT_SUCCESS) {
+    close (fd);
+    return -1;
+  }
+
+  return fd;
+}
+#endif
+
+/* Opens the evdev device with the tablet-mode switch, looking
+   through /dev/input if the path is "auto". Returns the descriptor
+   to poll or -1. */
+int
+tablet_switch_open (const char *path,
+		    int verbose,
+		    int *retstate)
+{
+#if HAVE_LINUX_INPUT_H
+  char devpath[280];
+  struct dirent *de;
+  DIR *dir;
+  int fd = -1;
+
+  if (strcmp (path, "auto") != 0) {
+    fd = open_switch (path, retstate);
+    if (fd < 0) {
+      fprintf (stderr, "Unable to use %s as the tablet-mode switch\n", path);
+    }
+    return fd;
+  }
+
+  dir = opendir ("/dev/input");
+  if (!dir) {
+    return -1;
+  }
+  while (fd < 0 && (de = readdir (dir)) != NULL) {
+    if (strncmp (de->d_name, "event", 5) == 0) {
+      snprintf (devpath, sizeof (devpath), "/dev/input/%s", de->d_name);
+      fd = open_switch (devpath, retstate);
+    }
+  }
+  closedir (dir);
+
+  if (fd >= 0 && verbose) {
+    fprintf (stderr, "Tablet-mode switch: %s (%s)\n", devpath,
+	     *retstate ? "tablet" : "docked");
+  }
+
+  return fd;
+#else
+  if (strcmp (path, "auto") != 0) {
+    fprintf (stderr, "The tablet-mode switch is not supported on this system\n");
+  }
+  return -1;
+#endif
+}
+
+/* Reads the pending switch events. Returns 1 if the state has
+   changed, 0 if not and -1 if the device is gone. */
+int
+tablet_switch_read (int fd,
+		    int *state)
+{
+#if HAVE_LINUX_INPUT_H
+  struct input_event ev[16];
+  int old = *state;
+  ssize_t len;
+  int i;
+
+  while ((len = read (fd, ev, sizeof (ev))) > 0) {
+    for (i = 0; i < len / sizeof (struct input_event); i++) {
+      if (ev[i].type == EV_SW && ev[i].code == SW_TABLET_MODE) {
+	*state = ev[i].value != 0;
+      } else if (ev[i].type == EV_SYN && ev[i].code == SYN_DROPPED) {
+	read_switch_state (fd, state);
+      }
+    }
+  }
+  if (len < 0 && errno != EAGAIN && errno != EINTR) {
+    return -1;
+  }
+
+  return *state != old;
+#else
+  return -1;
+#endif
+}
+
+/* end of policy.c */
@@ -0,0 +1,126 @@
+/*
+ * Original xinput:
+ * Copyright 1996 by Frederic Lepied, France. <Frederic.Lepied@sugix.frmug.org>
+ *
+ * Original xrandr:
+ * Copyright © 2001 Keith Packard, member of The XFree86 Project, Inc.
+ * Copyright © 2002 Hewlett Packard Company, Inc.
+ * Copyright © 2006 Intel Corporation
+ *
+ * xrandr-align:
+ *
+ * Copyright © 2012 Paul Wolneykien <manowar@altlinux.org>, ALT Linux Ltd.
+ *
+ * Permission to use, copy, modify, distribute, and sell this software and its
+ * documentation for any purpose is  hereby granted without fee, provided that
+ * the  above copyright   notice appear  in   all  copies and  that both  that
+ * copyright  notice   and   this  permission   notice  appear  in  supporting
+ * documentation, and that   the  name of  the authors  not  be  used  in
+ * advertising or publicity pertaining to distribution of the software without
+ * specific,  written      prior  permission.     The authors  make  no
+ * representations about the suitability of this software for any purpose.  It
+ * is provided "as is" without express or implied warranty.
+ *
+ * THE AUTHORS DISCLAIM ALL   WARRANTIES WITH REGARD  TO  THIS SOFTWARE,
+ * INCLUDING ALL IMPLIED   WARRANTIES OF MERCHANTABILITY  AND   FITNESS, IN NO
+ * EVENT  SHALL THE AUTHORS  BE   LIABLE   FOR ANY  SPECIAL, INDIRECT   OR
+ * CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM LOSS OF USE,
+ * DATA  OR PROFITS, WHETHER  IN  AN ACTION OF  CONTRACT,  NEGLIGENCE OR OTHER
+ * TORTIOUS  ACTION, ARISING    OUT OF OR   IN  CONNECTION  WITH THE USE    OR
+ * PERFORMANCE OF THIS SOFTWARE.
+ *
+ */
+
+#include <time.h>
+
+/*
+ * Rotation policy of gravitate.
+ *
+ * Each orientation reported by the gravity sensor is passed through
+ * the policy before the screen is rotated. Besides the sensor the
+ * policy takes into account:
+ *
+ *  - the rotations allowed on the screen and the rotated outputs;
+ *  - a lock set with the control socket or the root window property
+ *    _XRANDR_ALIGN_ROTATION_LOCK;
+ *  - the touches in progress (XI 2.2 raw touch events);
+ *  - the tablet-mode switch (SW_TABLET_MODE of an evdev device):
+ *    with the keyboard docked the docked rotation is preferred.
+ *
+ * The signals are kept as plain fields updated from their own event
+ * sources, so a decision is taken in constant time. A sensor
+ * decision held back is remembered and reconsidered as soon as a
+ * signal changes.
+ */
+
+#define ROTATION_LOCK_PROP "_XRANDR_ALIGN_ROTATION_LOCK"
+
+/* Touches silent for longer are taken as ended (a lost TouchEnd
+   must not suppress the rotation forever) */
+#define POLICY_TOUCH_TIMEOUT 5
+
+#define TABLET_UNKNOWN -1
+
+typedef struct
+{
+  Rotation allowed;	/* the allowed rotations */
+  Rotation docked;	/* the rotation preferred with the keyboard docked */
+  Rotation lock;	/* locked by a control command, 0 if not */
+  Rotation prop_lock;	/* locked by the root window property, 0 if not */
+  int paused;
+  int touches;		/* touches in progress */
+  time_t touch_time;	/* the last touch event */
+  int tablet;		/* 1 in tablet mode, 0 docked or TABLET_UNKNOWN */
+  Rotation pending;	/* the last sensor decision */
+  unsigned long held;	/* the decisions held back */
+} rotation_policy;
+
+void
+policy_init (rotation_policy *p,
+	     Rotation allowed);
+
+Rotation
+policy_decide (rotation_policy *p,
+	       Rotation wanted,
+	       Rotation current,
+	       time_t now);
+
+Rotation
+parse_rotation (const char *arg);
+
+int
+parse_rotations (const char *arg,
+		 Rotation *retmask);
+
+Rotation
+allowed_rotations (Display *display,
+		   Window root,
+		   const char **outputs,
+		   int noutputs);
+
+Rotation
+read_rotation_lock (Display *display,
+		    Window root,
+		    Atom prop,
+		    Rotation current);
+
+#if HAVE_XI2
+int
+select_touch_events (context *ctx,
+		     Window root);
+
+int
+policy_touch_event (rotation_policy *p,
+		    context *ctx,
+		    XEvent *event,
+		    time_t now);
+#endif
+
+int
+tablet_switch_open (const char *path,
+		    int verbose,
+		    int *retstate);
+
+int
+tablet_switch_read (int fd,
+		    int *state);
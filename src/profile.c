@@ -0,0 +1,180 @@
+/*
+ * Original xinput:
+ * Copyright 1996 by Frederic Lepied, France. <Frederic.Lepied@sugix.frmug.org>
+ *
+ * Original xrandr:
+ * Copyright © 2001 Keith Packard, member of The XFree86 Project, Inc.
+ * Copyright © 2002 Hewlett Packard Company, Inc.
+ * Copyright © 2006 Intel Corporation
+ *
+ * xrandr-align:
+ *
+ * Copyright © 2012 Paul Wolneykien <manowar@altlinux.org>, ALT Linux Ltd.
+ *
+ * Permission to use, copy, modify, distribute, and sell this software and its
+ * documentation for any purpose is  hereby granted without fee, provided that
+ * the  above copyright   notice appear  in   all  copies and  that both  that
+ * copyright  notice   and   this  permission   notice  appear  in  supporting
+ * documentation, and that   the  name of  the authors  not  be  used  in
+ * advertising or publicity pertaining to distribution of the software without
+ * specific,  written      prior  permission.     The authors  make  no
+ * representations about the suitability of this software for any purpose.  It
+ * is provided "as is" without express or implied warranty.
+ *
+ * THE AUTHORS DISCLAIM ALL   WARRANTIES WITH REGARD  TO  THIS SOFTWARE,
+ * INCLUDING ALL IMPLIED   WARRANTIES OF MERCHANTABILITY  AND   FITNESS, IN NO
+ * EVENT  SHALL THE AUTHORS  BE   LIABLE   FOR ANY  SPECIAL, INDIRECT   OR
+ * CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM LOSS OF USE,
+ * DATA  OR PROFITS, WHETHER  IN  AN ACTION OF  CONTRACT,  NEGLIGENCE OR OTHER
+ * TORTIOUS  ACTION, ARISING    OUT OF OR   IN  CONNECTION  WITH THE USE    OR
+ * PERFORMANCE OF THIS SOFTWARE.
+ *
+ */
+
+#include "profile.h"
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include <X11/Xlibint.h>
+
+#define XPROF_MAX_SITES 64
+
+int profile_x = 0;
+
+typedef struct
+{
+  const char *site;
+  unsigned long calls;
+  unsigned long requests;
+  unsigned long roundtrips;
+  unsigned long bytes;
+  double time;
+} XProfSite;
+
+/* Per thread: each display is served by a thread of its own, so the
+   sites are accounted and reported per display */
+static __thread XProfSite sites[XPROF_MAX_SITES];
+static __thread int nsites = 0;
+static __thread unsigned long bytes_sent = 0;
+
+static double
+xprof_now (void)
+{
+  struct timespec ts;
+
+  clock_gettime (CLOCK_MONOTONIC, &ts);
+  return (double) ts.tv_sec + (double) ts.tv_nsec / 1e9;
+}
+
+/* Bytes written so far: flushed plus still sitting in the buffer */
+static unsigned long
+xprof_bytes (Display *display)
+{
+  return bytes_sent + (display->bufptr - display->buffer);
+}
+
+static void
+xprof_flush (Display *display,
+	     XExtCodes *codes,
+	     _Xconst char *data,
+	     long len)
+{
+  bytes_sent += len;
+}
+
+void
+xprof_init (Display *display)
+{
+  XExtCodes *codes;
+
+  if (!profile_x) {
+    return;
+  }
+
+  codes = XAddExtension (display);
+  if (codes) {
+    XESetBeforeFlush (display, codes->extension, xprof_flush);
+  } else {
+    fprintf (stderr, "X profile: unable to hook the output buffer, byte counts are unavailable\n");
+  }
+}
+
+void
+xprof_begin (Display *display, XProfMark *mark)
+{
+  if (!profile_x) {
+    return;
+  }
+
+  mark->serial = NextRequest (display);
+  mark->bytes = xprof_bytes (display);
+  mark->start = xprof_now ();
+}
+
+void
+xprof_end (Display *display, XProfMark *mark, const char *site)
+{
+  XProfSite *s;
+  int i;
+
+  if (!profile_x) {
+    return;
+  }
+
+  for (i = 0; i < nsites; i++) {
+    if (sites[i].site == site || strcmp (sites[i].site, site) == 0) {
+      break;
+    }
+  }
+  if (i == nsites) {
+    if (nsites == XPROF_MAX_SITES) {
+      return;
+    }
+    memset (&sites[i], 0, sizeof (XProfSite));
+    sites[i].site = site;
+    nsites++;
+  }
+  s = &sites[i];
+
+  s->calls++;
+  s->requests += NextRequest (display) - mark->serial;
+  /* The last processed serial only moves past the start mark when
+     a reply (or an error) to one of our requests has been read. */
+  if ((long) (LastKnownRequestProcessed (display) - mark->serial) >= 0) {
+    s->roundtrips++;
+  }
+  s->bytes += xprof_bytes (display) - mark->bytes;
+  s->time += xprof_now () - mark->start;
+}
+
+void
+xprof_report (const char *title)
+{
+  unsigned long calls = 0, requests = 0, roundtrips = 0, bytes = 0;
+  double time = 0;
+  int i;
+
+  if (!profile_x || nsites == 0) {
+    return;
+  }
+
+  fprintf (stderr, "X profile: %s\n", title);
+  fprintf (stderr, "  %-56s %6s %6s %6s %8s %10s\n",
+	   "call site", "calls", "reqs", "rtrips", "bytes", "usec");
+  for (i = 0; i < nsites; i++) {
+    fprintf (stderr, "  %-56s %6lu %6lu %6lu %8lu %10.0f\n",
+	     sites[i].site, sites[i].calls, sites[i].requests,
+	     sites[i].roundtrips, sites[i].bytes, sites[i].time * 1e6);
+    calls += sites[i].calls;
+    requests += sites[i].requests;
+    roundtrips += sites[i].roundtrips;
+    bytes += sites[i].bytes;
+    time += sites[i].time;
+  }
+  fprintf (stderr, "  %-56s %6lu %6lu %6lu %8lu %10.0f\n",
+	   "total", calls, requests, roundtrips, bytes, time * 1e6);
+
+  nsites = 0;
+}
+
+/* end of profile.c */
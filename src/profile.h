@@ -0,0 +1,78 @@
+/*
+ * Original xinput:
+ * Copyright 1996 by Frederic Lepied, France. <Frederic.Lepied@sugix.frmug.org>
+ *
+ * Original xrandr:
+ * Copyright © 2001 Keith Packard, member of The XFree86 Project, Inc.
+ * Copyright © 2002 Hewlett Packard Company, Inc.
+ * Copyright © 2006 Intel Corporation
+ *
+ * xrandr-align:
+ *
+ * Copyright © 2012 Paul Wolneykien <manowar@altlinux.org>, ALT Linux Ltd.
+ *
+ * Permission to use, copy, modify, distribute, and sell this software and its
+ * documentation for any purpose is  hereby granted without fee, provided that
+ * the  above copyright   notice appear  in   all  copies and  that both  that
+ * copyright  notice   and   this  permission   notice  appear  in  supporting
+ * documentation, and that   the  name of  the authors  not  be  used  in
+ * advertising or publicity pertaining to distribution of the software without
+ * specific,  written      prior  permission.     The authors  make  no
+ * representations about the suitability of this software for any purpose.  It
+ * is provided "as is" without express or implied warranty.
+ *
+ * THE AUTHORS DISCLAIM ALL   WARRANTIES WITH REGARD  TO  THIS SOFTWARE,
+ * INCLUDING ALL IMPLIED   WARRANTIES OF MERCHANTABILITY  AND   FITNESS, IN NO
+ * EVENT  SHALL THE AUTHORS  BE   LIABLE   FOR ANY  SPECIAL, INDIRECT   OR
+ * CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM LOSS OF USE,
+ * DATA  OR PROFITS, WHETHER  IN  AN ACTION OF  CONTRACT,  NEGLIGENCE OR OTHER
+ * TORTIOUS  ACTION, ARISING    OUT OF OR   IN  CONNECTION  WITH THE USE    OR
+ * PERFORMANCE OF THIS SOFTWARE.
+ *
+ */
+
+/*
+ * X request profiler (--profile-x).
+ *
+ * Each Xlib/XRandR/XInput call of interest is wrapped with XPROF(),
+ * which accounts the number of requests issued (by the request
+ * serial), whether the call had to wait for the server (a round
+ * trip), the number of bytes written to the connection and the wall
+ * time spent, per call site. When profiling is off the wrapper costs
+ * a single test of the profile_x flag.
+ */
+
+#include <X11/Xlib.h>
+
+extern int profile_x;
+
+typedef struct
+{
+  unsigned long serial;
+  unsigned long bytes;
+  double start;
+} XProfMark;
+
+void
+xprof_init (Display *display);
+
+void
+xprof_begin (Display *display, XProfMark *mark);
+
+void
+xprof_end (Display *display, XProfMark *mark, const char *site);
+
+void
+xprof_report (const char *title);
+
+#define XPROF_STR_(x) #x
+#define XPROF_STR(x) XPROF_STR_(x)
+
+#define XPROF(display, name, call)					\
+  do {									\
+    XProfMark xprof_mark;						\
+    xprof_begin ((display), &xprof_mark);				\
+    call;								\
+    xprof_end ((display), &xprof_mark,					\
+	       name " (" __FILE__ ":" XPROF_STR(__LINE__) ")");		\
+  } while (0)
@@ -32,7 +32,10 @@
 #include <X11/Xatom.h>
 #include <X11/extensions/XIproto.h>
 
+#include "common.h"
 #include "xrandr-align.h"
+#include "profile.h"
+#include "xerror.h"
 
 static Atom parse_atom(Display *dpy, const char *name) {
     Bool is_atom = True;
@@ -45,10 +48,13 @@ static Atom parse_atom(Display *dpy, const char *name) {
         }
     }
 
+    Atom atom;
+
     if (is_atom)
         return atoi(name);
-    else
-        return XInternAtom(dpy, name, False);
+
+    XPROF(dpy, "XInternAtom", atom = XInternAtom(dpy, name, False));
+    return atom;
 }
 
 static int
@@ -84,7 +90,7 @@ do_set_prop_xi1(Display *dpy, Atom type, int format, int argc, const char **argv
         return EXIT_FAILURE;
     }
 
-    dev = XOpenDevice(dpy, info->id);
+    XPROF(dpy, "XOpenDevice", dev = XOpenDevice(dpy, info->id));
     if (!dev)
     {
         fprintf(stderr, "unable to open device %s\n", argv[0]);
@@ -100,13 +106,18 @@ do_set_prop_xi1(Display *dpy, Atom type, int format, int argc, const char **argv
         return EXIT_FAILURE;
     }
 
-    float_atom = XInternAtom(dpy, "FLOAT", False);
+    XPROF(dpy, "XInternAtom", float_atom = XInternAtom(dpy, "FLOAT", False));
 
     nelements = argc - 2;
     if (type == None || format == 0) {
-        if (XGetDeviceProperty(dpy, dev, prop, 0, 0, False, AnyPropertyType,
-                               &old_type, &old_format, &act_nitems,
-                               &bytes_after, &data.c) != Success) {
+        Status status;
+
+        XPROF(dpy, "XGetDeviceProperty",
+              status = XGetDeviceProperty(dpy, dev, prop, 0, 0, False,
+                                          AnyPropertyType, &old_type,
+                                          &old_format, &act_nitems,
+                                          &bytes_after, &data.c));
+        if (status != Success) {
             fprintf(stderr, "failed to get property type and format for %s\n",
                     name);
             return EXIT_FAILURE;
@@ -170,10 +181,11 @@ do_set_prop_xi1(Display *dpy, Atom type, int format, int argc, const char **argv
         }
     }
 
-    XChangeDeviceProperty(dpy, dev, prop, type, format, PropModeReplace,
-                          data.c, nelements);
+    XPROF(dpy, "XChangeDeviceProperty",
+          XChangeDeviceProperty(dpy, dev, prop, type, format, PropModeReplace,
+                                data.c, nelements));
     free(data.c);
-    XCloseDevice(dpy, dev);
+    XPROF(dpy, "XCloseDevice", XCloseDevice(dpy, dev));
     return EXIT_SUCCESS;
 }
 
@@ -218,13 +230,17 @@ do_set_prop_xi2(Display *dpy, Atom type, int format, int argc, const char **argv
         return EXIT_FAILURE;
     }
 
-    float_atom = XInternAtom(dpy, "FLOAT", False);
+    XPROF(dpy, "XInternAtom", float_atom = XInternAtom(dpy, "FLOAT", False));
 
     nelements = argc - 2;
     if (type == None || format == 0) {
-        if (XIGetProperty(dpy, info->deviceid, prop, 0, 0, False,
-                          AnyPropertyType, &old_type, &old_format, &act_nitems,
-                          &bytes_after, &data.c) != Success) {
+        Status status;
+
+        XPROF(dpy, "XIGetProperty",
+              status = XIGetProperty(dpy, info->deviceid, prop, 0, 0, False,
+                                     AnyPropertyType, &old_type, &old_format,
+                                     &act_nitems, &bytes_after, &data.c));
+        if (status != Success) {
             fprintf(stderr, "failed to get property type and format for %s\n",
                     name);
             return EXIT_FAILURE;
@@ -288,27 +304,33 @@ do_set_prop_xi2(Display *dpy, Atom type, int format, int argc, const char **argv
         }
     }
 
-    XIChangeProperty(dpy, info->deviceid, prop, type, format, PropModeReplace,
-                          data.c, nelements);
+    XPROF(dpy, "XIChangeProperty",
+          XIChangeProperty(dpy, info->deviceid, prop, type, format,
+                           PropModeReplace, data.c, nelements));
     free(data.c);
     return EXIT_SUCCESS;
 }
 #endif
 
 static int
-do_set_prop(Display *display, Atom type, int format, int argc, const char *argv[], const char *name, const char *desc)
+do_set_prop(context *ctx, Atom type, int format)
 {
+    const options *opts = &ctx->opts;
+
 #ifdef HAVE_XI2
-    if (check_xi2 (display))
-        return do_set_prop_xi2(display, type, format, argc, argv, name, desc);
+    if (ctx->conn.xi2)
+        return do_set_prop_xi2(ctx->display, type, format, opts->argc, opts->argv, opts->funcname, opts->usage);
 #endif
-    return do_set_prop_xi1(display, type, format, argc, argv, name, desc);
+    return do_set_prop_xi1(ctx->display, type, format, opts->argc, opts->argv, opts->funcname, opts->usage);
 }
 
 int
-set_float_prop(Display *dpy, int argc, const char** argv, const char* n, const char *desc)
+set_float_prop(context *ctx)
 {
-    Atom float_atom = XInternAtom(dpy, "FLOAT", False);
+    Display *dpy = ctx->display;
+    Atom float_atom;
+
+    XPROF(dpy, "XInternAtom", float_atom = XInternAtom(dpy, "FLOAT", False));
 
     if (sizeof(float) != 4)
     {
@@ -316,5 +338,128 @@ set_float_prop(Display *dpy, int argc, const char** argv, const char* n, const c
 	return EXIT_FAILURE;
     }
 
-    return do_set_prop(dpy, float_atom, 32, argc, argv, n, desc);
+    return do_set_prop(ctx, float_atom, 32);
+}
+
+/* Write an array of floats to the property of a device already
+ * looked up by the caller. The data is sent without any round trip
+ * on the XI2 path; on the XI1 path the device stays open in the
+ * connection context for the next writes. The values are packed on
+ * the stack and the FLOAT atom is the one of the connection, so a
+ * write allocates nothing. */
+int
+change_float_prop(context *ctx, XID deviceid, Atom prop,
+                  const float *values, int nvalues)
+{
+    Display *dpy = ctx->display;
+    Atom float_atom = ctx->conn.float_atom;
+    int i;
+
+    if (nvalues > FLOAT_PROP_MAX)
+    {
+        fprintf(stderr, "too many values for a property: %d\n", nvalues);
+        return EXIT_FAILURE;
+    }
+
+#if HAVE_XI2
+    if (ctx->conn.xi2)
+    {
+        int32_t data[FLOAT_PROP_MAX];
+
+        for (i = 0; i < nvalues; i++)
+            *(float *)(data + i) = values[i];
+
+        /* Fire and forget: a failure is matched back to the device */
+        xerror_track(dpy, NextRequest(dpy), deviceid);
+        XPROF(dpy, "XIChangeProperty",
+              XIChangeProperty(dpy, deviceid, prop, float_atom, 32,
+                               PropModeReplace, (unsigned char *) data,
+                               nvalues));
+        return EXIT_SUCCESS;
+    }
+#endif
+    {
+        XDevice *dev;
+        long data[FLOAT_PROP_MAX];
+
+        dev = connection_device(&ctx->conn, deviceid);
+        if (!dev)
+        {
+            fprintf(stderr, "unable to open device %lu\n",
+                    (unsigned long) deviceid);
+            return EXIT_FAILURE;
+        }
+
+        for (i = 0; i < nvalues; i++)
+            *(float *)(data + i) = values[i];
+
+        xerror_track(dpy, NextRequest(dpy), deviceid);
+        XPROF(dpy, "XChangeDeviceProperty",
+              XChangeDeviceProperty(dpy, dev, prop, float_atom, 32,
+                                    PropModeReplace, (unsigned char *) data,
+                                    nvalues));
+    }
+
+    return EXIT_SUCCESS;
+}
+
+/* Reads back a FLOAT property of nvalues items with a single request:
+   EXIT_FAILURE if it is missing or has another type or size */
+int
+get_float_prop(context *ctx, XID deviceid, Atom prop,
+               float *values, int nvalues)
+{
+    Display *dpy = ctx->display;
+    Atom float_atom = ctx->conn.float_atom;
+    Atom type;
+    int format;
+    unsigned long nitems, bytes_after;
+    unsigned char *data = NULL;
+    Status status;
+    int ret = EXIT_FAILURE;
+    int i;
+
+#if HAVE_XI2
+    if (ctx->conn.xi2)
+    {
+        XPROF(dpy, "XIGetProperty",
+              status = XIGetProperty(dpy, deviceid, prop, 0, nvalues, False,
+                                     float_atom, &type, &format, &nitems,
+                                     &bytes_after, &data));
+        if (status == Success && type == float_atom && format == 32 &&
+            nitems == nvalues && bytes_after == 0)
+        {
+            for (i = 0; i < nvalues; i++)
+                values[i] = *(float *)((int32_t *) data + i);
+            ret = EXIT_SUCCESS;
+        }
+        if (data)
+            XFree(data);
+        return ret;
+    }
+#endif
+    {
+        XDevice *dev;
+
+        dev = connection_device(&ctx->conn, deviceid);
+        if (!dev)
+            return EXIT_FAILURE;
+
+        XPROF(dpy, "XGetDeviceProperty",
+              status = XGetDeviceProperty(dpy, dev, prop, 0, nvalues, False,
+                                          float_atom, &type, &format, &nitems,
+                                          &bytes_after, &data));
+        /* The 32 bit items come as longs */
+        if (status == Success && type == float_atom && format == 32 &&
+            nitems == nvalues && bytes_after == 0)
+        {
+            for (i = 0; i < nvalues; i++)
+                values[i] = *(float *)((long *) data + i);
+            ret = EXIT_SUCCESS;
+        }
+        if (data)
+            XFree(data);
+    }
+
+    return ret;
 }
@@ -0,0 +1,214 @@
+/*
+ * Original xinput:
+ * Copyright 1996 by Frederic Lepied, France. <Frederic.Lepied@sugix.frmug.org>
+ *
+ * Original xrandr:
+ * Copyright © 2001 Keith Packard, member of The XFree86 Project, Inc.
+ * Copyright © 2002 Hewlett Packard Company, Inc.
+ * Copyright © 2006 Intel Corporation
+ *
+ * xrandr-align:
+ *
+ * Copyright © 2012 Paul Wolneykien <manowar@altlinux.org>, ALT Linux Ltd.
+ *
+ * Permission to use, copy, modify, distribute, and sell this software and its
+ * documentation for any purpose is  hereby granted without fee, provided that
+ * the  above copyright   notice appear  in   all  copies and  that both  that
+ * copyright  notice   and   this  permission   notice  appear  in  supporting
+ * documentation, and that   the  name of  the authors  not  be  used  in
+ * advertising or publicity pertaining to distribution of the software without
+ * specific,  written      prior  permission.     The authors  make  no
+ * representations about the suitability of this software for any purpose.  It
+ * is provided "as is" without express or implied warranty.
+ *
+ * THE AUTHORS DISCLAIM ALL   WARRANTIES WITH REGARD  TO  THIS SOFTWARE,
+ * INCLUDING ALL IMPLIED   WARRANTIES OF MERCHANTABILITY  AND   FITNESS, IN NO
+ * EVENT  SHALL THE AUTHORS  BE   LIABLE   FOR ANY  SPECIAL, INDIRECT   OR
+ * CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM LOSS OF USE,
+ * DATA  OR PROFITS, WHETHER  IN  AN ACTION OF  CONTRACT,  NEGLIGENCE OR OTHER
+ * TORTIOUS  ACTION, ARISING    OUT OF OR   IN  CONNECTION  WITH THE USE    OR
+ * PERFORMANCE OF THIS SOFTWARE.
+ *
+ */
+#define _GNU_SOURCE
+#include "common.h"
+#include "xrandr-align.h"
+#include "realtime.h"
+#include <errno.h>
+#include <pthread.h>
+#include <sched.h>
+#include <string.h>
+#include <sys/mman.h>
+#ifdef HAVE_MALLOC_H
+#include <malloc.h>
+#endif
+
+/* The stack and heap touched before the loop, so the first events
+   take no page faults */
+#define PREFAULT_STACK (64 * 1024)
+#define PREFAULT_HEAP (256 * 1024)
+
+/* Parses a CPU list: numbers and ranges separated by commas */
+static int
+parse_cpus (const char *arg,
+	    realtime_options *rt)
+{
+  const char *p = arg;
+  char *endptr;
+  long first, last, cpu;
+
+  rt->ncpus = 0;
+  while (*p) {
+    first = strtol (p, &endptr, 10);
+    if (endptr == p || first < 0) {
+      break;
+    }
+    last = first;
+    p = endptr;
+    if (*p == '-') {
+      last = strtol (p + 1, &endptr, 10);
+      if (endptr == p + 1 || last < first) {
+	break;
+      }
+      p = endptr;
+    }
+    for (cpu = first; cpu <= last; cpu++) {
+      if (cpu >= REALTIME_MAX_CPUS || rt->ncpus >= REALTIME_MAX_CPUS) {
+	fprintf (stderr, "CPU list is too large: %s\n", arg);
+	return EXIT_FAILURE;
+      }
+      rt->cpus[rt->ncpus++] = (int) cpu;
+    }
+    if (*p == ',') {
+      p++;
+    } else if (*p) {
+      break;
+    }
+  }
+
+  if (*p || rt->ncpus == 0) {
+    fprintf (stderr, "Invalid CPU list: %s\n", arg);
+    return EXIT_FAILURE;
+  }
+
+  return EXIT_SUCCESS;
+}
+
+int
+realtime_parse (const options *opts,
+		realtime_options *rt)
+{
+  const char *prioarg, *cpusarg;
+  int ret;
+
+  memset (rt, 0, sizeof (realtime_options));
+  rt->mlock = get_argflag (opts->argc, opts->argv, "mlock");
+
+  ret = get_argval (opts->argc, opts->argv, "sched-fifo", opts->funcname, opts->usage, NULL, &prioarg);
+  if (ret != EXIT_FAILURE && prioarg) {
+    char *endptr;
+    long prio = strtol (prioarg, &endptr, 0);
+    if (endptr == prioarg || *endptr ||
+	prio < sched_get_priority_min (SCHED_FIFO) ||
+	prio > sched_get_priority_max (SCHED_FIFO)) {
+      fprintf (stderr, "Invalid SCHED_FIFO priority: %s (%i-%i)\n", prioarg,
+	       sched_get_priority_min (SCHED_FIFO), sched_get_priority_max (SCHED_FIFO));
+      ret = EXIT_FAILURE;
+    } else {
+      rt->priority = (int) prio;
+    }
+  }
+
+  if (ret != EXIT_FAILURE) {
+    ret = get_argval (opts->argc, opts->argv, "cpus", opts->funcname, opts->usage, NULL, &cpusarg);
+  }
+  if (ret != EXIT_FAILURE && cpusarg) {
+    ret = parse_cpus (cpusarg, rt);
+  }
+
+  return ret;
+}
+
+/* Touches the stack below the caller */
+static void
+prefault_stack (void)
+{
+  volatile char buf[PREFAULT_STACK];
+  int i;
+
+  for (i = 0; i < sizeof (buf); i += 4096) {
+    buf[i] = 0;
+  }
+}
+
+static void
+lock_memory (int verbose)
+{
+  char *heap;
+
+#ifdef HAVE_MALLOC_H
+  /* The freed heap stays mapped and locked, the large blocks come
+     from the heap too */
+  mallopt (M_TRIM_THRESHOLD, -1);
+  mallopt (M_MMAP_MAX, 0);
+#endif
+
+  if (mlockall (MCL_CURRENT | MCL_FUTURE) != 0) {
+    fprintf (stderr, "Unable to lock the memory: %s\n", strerror (errno));
+    return;
+  }
+
+  heap = malloc (PREFAULT_HEAP);
+  if (heap) {
+    memset (heap, 0, PREFAULT_HEAP);
+    free (heap);
+  }
+  prefault_stack ();
+
+  if (verbose) {
+    fprintf (stderr, "The memory is locked\n");
+  }
+}
+
+void
+realtime_apply (const realtime_options *rt,
+		int verbose)
+{
+  int err;
+
+  if (rt->mlock) {
+    lock_memory (verbose);
+  }
+
+  if (rt->ncpus > 0) {
+    cpu_set_t set;
+    int i;
+
+    CPU_ZERO (&set);
+    for (i = 0; i < rt->ncpus; i++) {
+      CPU_SET (rt->cpus[i], &set);
+    }
+    err = pthread_setaffinity_np (pthread_self (), sizeof (set), &set);
+    if (err) {
+      fprintf (stderr, "Unable to set the CPU affinity: %s\n", strerror (err));
+    } else if (verbose) {
+      fprintf (stderr, "Pinned to %i CPU(s)\n", rt->ncpus);
+    }
+  }
+
+  if (rt->priority > 0) {
+    struct sched_param param;
+
+    memset (&param, 0, sizeof (param));
+    param.sched_priority = rt->priority;
+    err = pthread_setschedparam (pthread_self (), SCHED_FIFO, &param);
+    if (err) {
+      fprintf (stderr, "Unable to set SCHED_FIFO priority %i: %s\n",
+	       rt->priority, strerror (err));
+    } else if (verbose) {
+      fprintf (stderr, "Running under SCHED_FIFO priority %i\n", rt->priority);
+    }
+  }
+}
+
+/* end of realtime.c */
@@ -0,0 +1,66 @@
+/*
+ * Original xinput:
+ * Copyright 1996 by Frederic Lepied, France. <Frederic.Lepied@sugix.frmug.org>
+ *
+ * Original xrandr:
+ * Copyright © 2001 Keith Packard, member of The XFree86 Project, Inc.
+ * Copyright © 2002 Hewlett Packard Company, Inc.
+ * Copyright © 2006 Intel Corporation
+ *
+ * xrandr-align:
+ *
+ * Copyright © 2012 Paul Wolneykien <manowar@altlinux.org>, ALT Linux Ltd.
+ *
+ * Permission to use, copy, modify, distribute, and sell this software and its
+ * documentation for any purpose is  hereby granted without fee, provided that
+ * the  above copyright   notice appear  in   all  copies and  that both  that
+ * copyright  notice   and   this  permission   notice  appear  in  supporting
+ * documentation, and that   the  name of  the authors  not  be  used  in
+ * advertising or publicity pertaining to distribution of the software without
+ * specific,  written      prior  permission.     The authors  make  no
+ * representations about the suitability of this software for any purpose.  It
+ * is provided "as is" without express or implied warranty.
+ *
+ * THE AUTHORS DISCLAIM ALL   WARRANTIES WITH REGARD  TO  THIS SOFTWARE,
+ * INCLUDING ALL IMPLIED   WARRANTIES OF MERCHANTABILITY  AND   FITNESS, IN NO
+ * EVENT  SHALL THE AUTHORS  BE   LIABLE   FOR ANY  SPECIAL, INDIRECT   OR
+ * CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM LOSS OF USE,
+ * DATA  OR PROFITS, WHETHER  IN  AN ACTION OF  CONTRACT,  NEGLIGENCE OR OTHER
+ * TORTIOUS  ACTION, ARISING    OUT OF OR   IN  CONNECTION  WITH THE USE    OR
+ * PERFORMANCE OF THIS SOFTWARE.
+ *
+ */
+
+/*
+ * Real-time setup of the daemons, all of it opt-in:
+ *
+ *  --mlock            locks the process memory (mlockall) and keeps the
+ *                     freed heap mapped, so the Xlib replies of the
+ *                     steady state land on resident pages and never
+ *                     fault;
+ *  --sched-fifo=PRIO  runs the daemon thread under SCHED_FIFO;
+ *  --cpus=LIST        pins the daemon thread to the CPUs, as in
+ *                     0,2-3.
+ *
+ * The setup is applied once the daemon is set up, before its event
+ * loop. A failure (no privilege, a low RLIMIT_MEMLOCK) is reported
+ * and the daemon runs without it.
+ */
+
+#define REALTIME_MAX_CPUS 1024
+
+typedef struct
+{
+  int mlock;
+  int priority;		/* of SCHED_FIFO, 0 if not asked for */
+  int ncpus;		/* the pinned CPUs, 0 if not asked for */
+  int cpus[REALTIME_MAX_CPUS];
+} realtime_options;
+
+int
+realtime_parse (const options *opts,
+		realtime_options *rt);
+
+void
+realtime_apply (const realtime_options *rt,
+		int verbose);
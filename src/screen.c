@@ -0,0 +1,179 @@
+/*
+ * Original xinput:
+ * Copyright 1996 by Frederic Lepied, France. <Frederic.Lepied@sugix.frmug.org>
+ *
+ * Original xrandr:
+ * Copyright © 2001 Keith Packard, member of The XFree86 Project, Inc.
+ * Copyright © 2002 Hewlett Packard Company, Inc.
+ * Copyright © 2006 Intel Corporation
+ *
+ * xrandr-align:
+ *
+ * Copyright © 2012 Paul Wolneykien <manowar@altlinux.org>, ALT Linux Ltd.
+ *
+ * Permission to use, copy, modify, distribute, and sell this software and its
+ * documentation for any purpose is  hereby granted without fee, provided that
+ * the  above copyright   notice appear  in   all  copies and  that both  that
+ * copyright  notice   and   this  permission   notice  appear  in  supporting
+ * documentation, and that   the  name of  the authors  not  be  used  in
+ * advertising or publicity pertaining to distribution of the software without
+ * specific,  written      prior  permission.     The authors  make  no
+ * representations about the suitability of this software for any purpose.  It
+ * is provided "as is" without express or implied warranty.
+ *
+ * THE AUTHORS DISCLAIM ALL   WARRANTIES WITH REGARD  TO  THIS SOFTWARE,
+ * INCLUDING ALL IMPLIED   WARRANTIES OF MERCHANTABILITY  AND   FITNESS, IN NO
+ * EVENT  SHALL THE AUTHORS  BE   LIABLE   FOR ANY  SPECIAL, INDIRECT   OR
+ * CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM LOSS OF USE,
+ * DATA  OR PROFITS, WHETHER  IN  AN ACTION OF  CONTRACT,  NEGLIGENCE OR OTHER
+ * TORTIOUS  ACTION, ARISING    OUT OF OR   IN  CONNECTION  WITH THE USE    OR
+ * PERFORMANCE OF THIS SOFTWARE.
+ *
+ */
+
+#include "common.h"
+#include "xrandr-align.h"
+#include "profile.h"
+#include <string.h>
+
+/* Frees the replies fetched on demand, keeping the arrays */
+static void
+free_replies (screen_cache *sc)
+{
+  int i;
+
+  for (i = 0; i < sc->ninfos; i++) {
+    if (sc->infos[i]) {
+      XRRFreeOutputInfo (sc->infos[i]);
+      sc->infos[i] = NULL;
+    }
+  }
+  for (i = 0; i < sc->ncrtcs; i++) {
+    if (sc->crtcs[i].info) {
+      XRRFreeCrtcInfo (sc->crtcs[i].info);
+      sc->crtcs[i].info = NULL;
+    }
+  }
+}
+
+/* Fetches the screen resources and configuration again if a RandR
+   event marked the cache dirty */
+void
+screen_refresh (Display *display,
+		screen_cache *sc)
+{
+  if (!sc->dirty) {
+    return;
+  }
+
+  if (sc->res) {
+    free_replies (sc);
+    XRRFreeScreenResources (sc->res);
+    XRRFreeScreenConfigInfo (sc->sconf);
+  }
+
+  XPROF (display, "XRRGetScreenResourcesCurrent",
+	 sc->res = XRRGetScreenResourcesCurrent (display, sc->root));
+  XPROF (display, "XRRGetScreenInfo",
+	 sc->sconf = XRRGetScreenInfo (display, sc->root));
+
+  /* The arrays are reused: they only grow with the outputs and CRTCs */
+  if (sc->res->noutput > sc->ninfos) {
+    free (sc->infos);
+    sc->infos = calloc (sc->res->noutput, sizeof (XRROutputInfo *));
+    sc->ninfos = sc->res->noutput;
+  }
+  if (sc->res->ncrtc > sc->ncrtcs) {
+    free (sc->crtcs);
+    sc->crtcs = calloc (sc->res->ncrtc, sizeof (screen_crtc));
+    sc->ncrtcs = sc->res->ncrtc;
+  }
+  sc->dirty = 0;
+}
+
+void
+screen_free (screen_cache *sc)
+{
+  if (sc->res) {
+    free_replies (sc);
+    XRRFreeScreenResources (sc->res);
+    XRRFreeScreenConfigInfo (sc->sconf);
+    sc->res = NULL;
+    sc->sconf = NULL;
+  }
+  free (sc->infos);
+  free (sc->crtcs);
+  sc->infos = NULL;
+  sc->crtcs = NULL;
+  sc->ninfos = 0;
+  sc->ncrtcs = 0;
+  sc->dirty = 1;
+}
+
+/* Returns the info and the current transform of the CRTC, fetched on
+   the first use since the last refresh, or NULL */
+const screen_crtc *
+screen_get_crtc (Display *display,
+		 screen_cache *sc,
+		 RRCrtc crtc)
+{
+  XRRCrtcTransformAttributes *transform;
+  screen_crtc *c;
+  Status status;
+  int i;
+
+  screen_refresh (display, sc);
+  for (i = 0; i < sc->res->ncrtc; i++) {
+    if (sc->res->crtcs[i] == crtc) {
+      break;
+    }
+  }
+  if (i == sc->res->ncrtc) {
+    fprintf (stderr, "CRTC %lu not found\n", (unsigned long) crtc);
+    return NULL;
+  }
+
+  c = &sc->crtcs[i];
+  if (c->info) {
+    return c;
+  }
+
+  XPROF (display, "XRRGetCrtcInfo",
+	 c->info = XRRGetCrtcInfo (display, sc->res, crtc));
+  if (!c->info) {
+    fprintf (stderr, "Unable to get the CRTC %lu\n", (unsigned long) crtc);
+    return NULL;
+  }
+  XPROF (display, "XRRGetCrtcTransform",
+	 status = XRRGetCrtcTransform (display, crtc, &transform));
+  if (!status) {
+    fprintf (stderr, "Unable to get the current transformation\n");
+    XRRFreeCrtcInfo (c->info);
+    c->info = NULL;
+    return NULL;
+  }
+  c->transform = transform->currentTransform;
+  XFree (transform);
+
+  return c;
+}
+
+/* Computes the matrix of the CRTC from the cached replies */
+int
+screen_transform (context *ctx,
+		  screen_cache *sc,
+		  RRCrtc crtcnum,
+		  alignment *al)
+{
+  const screen_crtc *c;
+
+  c = screen_get_crtc (ctx->display, sc, crtcnum);
+  if (!c) {
+    return EXIT_FAILURE;
+  }
+
+  return compute_crtc_transform (ctx, sc->res, sc->sconf, crtcnum,
+				 c->info, &c->transform, al);
+}
+
+/* end of screen.c */
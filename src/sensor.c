@@ -0,0 +1,409 @@
+/*
+ * Original xinput:
+ * Copyright 1996 by Frederic Lepied, France. <Frederic.Lepied@sugix.frmug.org>
+ *
+ * Original xrandr:
+ * Copyright © 2001 Keith Packard, member of The XFree86 Project, Inc.
+ * Copyright © 2002 Hewlett Packard Company, Inc.
+ * Copyright © 2006 Intel Corporation
+ *
+ * xrandr-align:
+ *
+ * Copyright © 2012 Paul Wolneykien <manowar@altlinux.org>, ALT Linux Ltd.
+ *
+ * Permission to use, copy, modify, distribute, and sell this software and its
+ * documentation for any purpose is  hereby granted without fee, provided that
+ * the  above copyright   notice appear  in   all  copies and  that both  that
+ * copyright  notice   and   this  permission   notice  appear  in  supporting
+ * documentation, and that   the  name of  the authors  not  be  used  in
+ * advertising or publicity pertaining to distribution of the software without
+ * specific,  written      prior  permission.     The authors  make  no
+ * representations about the suitability of this software for any purpose.  It
+ * is provided "as is" without express or implied warranty.
+ *
+ * THE AUTHORS DISCLAIM ALL   WARRANTIES WITH REGARD  TO  THIS SOFTWARE,
+ * INCLUDING ALL IMPLIED   WARRANTIES OF MERCHANTABILITY  AND   FITNESS, IN NO
+ * EVENT  SHALL THE AUTHORS  BE   LIABLE   FOR ANY  SPECIAL, INDIRECT   OR
+ * CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM LOSS OF USE,
+ * DATA  OR PROFITS, WHETHER  IN  AN ACTION OF  CONTRACT,  NEGLIGENCE OR OTHER
+ * TORTIOUS  ACTION, ARISING    OUT OF OR   IN  CONNECTION  WITH THE USE    OR
+ * PERFORMANCE OF THIS SOFTWARE.
+ *
+ */
+
+#include "common.h"
+#include "xrandr-align.h"
+#include "profile.h"
+#include "orientation.h"
+#include "sensor.h"
+#include <errno.h>
+#include <fcntl.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/select.h>
+
+#define INVALID_EVENT_TYPE	-1
+
+static int
+register_events(Display		*dpy,
+		Window		root_win,
+		XDeviceInfo	*info,
+		const char	*dev_name,
+		Bool		handle_proximity,
+		device_events	*ev)
+{
+    int			number = 0;	/* number of events registered */
+    XEventClass		event_list[7];
+    int			i;
+    XDevice		*device;
+    XInputClassInfo	*ip;
+
+    ev->motion_type = INVALID_EVENT_TYPE;
+    ev->button_press_type = INVALID_EVENT_TYPE;
+    ev->button_release_type = INVALID_EVENT_TYPE;
+    ev->key_press_type = INVALID_EVENT_TYPE;
+    ev->key_release_type = INVALID_EVENT_TYPE;
+    ev->proximity_in_type = INVALID_EVENT_TYPE;
+    ev->proximity_out_type = INVALID_EVENT_TYPE;
+
+    XPROF(dpy, "XOpenDevice", device = XOpenDevice(dpy, info->id));
+
+    if (!device) {
+	fprintf(stderr, "unable to open device %s\n", dev_name);
+	return 0;
+    }
+
+    if (device->num_classes > 0) {
+	for (ip = device->classes, i=0; i<info->num_classes; ip++, i++) {
+	    switch (ip->input_class) {
+/*
+	    case KeyClass:
+		DeviceKeyPress(device, ev->key_press_type, event_list[number]); number++;
+		DeviceKeyRelease(device, ev->key_release_type, event_list[number]); number++;
+		break;
+
+	    case ButtonClass:
+		DeviceButtonPress(device, ev->button_press_type, event_list[number]); number++;
+		DeviceButtonRelease(device, ev->button_release_type, event_list[number]); number++;
+		break;
+*/
+	    case ValuatorClass:
+		DeviceMotionNotify(device, ev->motion_type, event_list[number]); number++;
+		if (handle_proximity) {
+		    ProximityIn(device, ev->proximity_in_type, event_list[number]); number++;
+		    ProximityOut(device, ev->proximity_out_type, event_list[number]); number++;
+		}
+		break;
+/*
+	    default:
+		fprintf(stderr, "unknown class\n");
+		break;
+*/
+	    }
+	}
+
+	int err;
+
+	XPROF(dpy, "XSelectExtensionEvent",
+	      err = XSelectExtensionEvent(dpy, root_win, event_list, number));
+	if (err) {
+	    fprintf(stderr, "error selecting extended events\n");
+	    return 0;
+	}
+    }
+    return number;
+}
+
+#if HAVE_XI2
+/* Selects the raw motion of the device only. XI 2 events are sent to
+   a connection that has announced its version. */
+static int
+select_raw_events (Display *dpy,
+		   Window root_win,
+		   XID deviceid)
+{
+  unsigned char mask[XIMaskLen (XI_RawMotion)];
+  XIEventMask m;
+  int major = XI_2_Major, minor = XI_2_Minor;
+  Status status;
+
+  XPROF (dpy, "XIQueryVersion",
+	 status = XIQueryVersion (dpy, &major, &minor));
+  if (status != Success) {
+    return 0;
+  }
+
+  memset (mask, 0, sizeof (mask));
+  XISetMask (mask, XI_RawMotion);
+  m.deviceid = deviceid;
+  m.mask_len = sizeof (mask);
+  m.mask = mask;
+  XPROF (dpy, "XISelectEvents",
+	 status = XISelectEvents (dpy, root_win, &m, 1));
+
+  return status == Success;
+}
+#endif
+
+/* Called by the producer only. Returns 0 if the ring is full. */
+int
+sensor_ring_push (sensor_ring *ring,
+		  const sensor_record *rec)
+{
+  unsigned int head = ring->head;
+
+  if (head - __atomic_load_n (&ring->tail, __ATOMIC_ACQUIRE) == SENSOR_RING_SIZE) {
+    __atomic_add_fetch (&ring->overflows, 1, __ATOMIC_RELAXED);
+    return 0;
+  }
+  ring->slots[head & (SENSOR_RING_SIZE - 1)] = *rec;
+  __atomic_store_n (&ring->head, head + 1, __ATOMIC_RELEASE);
+
+  return 1;
+}
+
+/* Called by the consumer only. Returns 0 if the ring is empty. */
+int
+sensor_ring_pop (sensor_ring *ring,
+		 sensor_record *rec)
+{
+  unsigned int tail = ring->tail;
+
+  if (__atomic_load_n (&ring->head, __ATOMIC_ACQUIRE) == tail) {
+    return 0;
+  }
+  *rec = ring->slots[tail & (SENSOR_RING_SIZE - 1)];
+  __atomic_store_n (&ring->tail, tail + 1, __ATOMIC_RELEASE);
+
+  return 1;
+}
+
+static void *
+sensor_main (void *data)
+{
+  sensor_thread *s = data;
+  Display *display = s->display;
+  int xfd = ConnectionNumber (display);
+  float bx[SENSOR_BATCH], by[SENSOR_BATCH], bz[SENSOR_BATCH];
+  float g[3];
+  sensor_record rec;
+  unsigned char last = 0;
+  Time last_time = 0;
+  int primed = 0;
+  XEvent e;
+
+  memcpy (g, s->oc->initial, sizeof (g));
+
+  while (1) {
+    Time t = 0;
+    int count = 0;
+    int n = 0;
+
+    while (!XPending (display)) {
+      fd_set fds;
+
+      FD_ZERO (&fds);
+      FD_SET (xfd, &fds);
+      FD_SET (s->stop[0], &fds);
+      if (select ((xfd > s->stop[0] ? xfd : s->stop[0]) + 1, &fds, NULL, NULL, NULL) < 0 &&
+	  errno != EINTR) {
+	perror ("sensor");
+	return NULL;
+      }
+      if (FD_ISSET (s->stop[0], &fds)) {
+	return NULL;
+      }
+    }
+
+    /* Drain the queued samples: one decision per batch */
+    while (count < SENSOR_BATCH && XPending (display)) {
+      XDeviceMotionEvent *m = (XDeviceMotionEvent *) &e;
+
+      XNextEvent (display, &e);
+#if HAVE_XI2
+      if (s->raw) {
+	XGenericEventCookie *cookie = &e.xcookie;
+	XIRawEvent *raw;
+
+	if (cookie->type != GenericEvent ||
+	    cookie->extension != s->xi_opcode ||
+	    cookie->evtype != XI_RawMotion ||
+	    !XGetEventData (display, cookie)) {
+	  continue;
+	}
+	raw = cookie->data;
+	count++;
+	t = raw->time;
+	orientation_sample_raw (s->oc, raw->valuators.mask, raw->valuators.mask_len,
+				raw->raw_values, g);
+	XFreeEventData (display, cookie);
+	bx[n] = g[0];
+	by[n] = g[1];
+	bz[n] = g[2];
+	n++;
+	continue;
+      }
+#endif
+      if (e.type != s->ev.motion_type) {
+	continue;
+      }
+      count++;
+      t = m->time;
+      if (m->axes_count > 0) {
+	orientation_sample (s->oc, m->axis_data, m->first_axis, m->axes_count, g);
+	bx[n] = g[0];
+	by[n] = g[1];
+	bz[n] = g[2];
+	n++;
+      }
+    }
+    __atomic_add_fetch (&s->events, count, __ATOMIC_RELAXED);
+    if (n == 0) {
+      continue;
+    }
+    __atomic_add_fetch (&s->batches, 1, __ATOMIC_RELAXED);
+
+    orientation_reduce (s->reducer, bx, by, bz, n, rec.g);
+    orientation_classify (s->oc, &rec.g[0], &rec.g[1], &rec.g[2], 1, &rec.rotation);
+
+    /* Decimation: the changes and one record per period */
+    if (primed && rec.rotation == last && t - last_time < SENSOR_PERIOD) {
+      continue;
+    }
+    rec.time = t;
+    rec.samples = n;
+    if (sensor_ring_push (&s->ring, &rec)) {
+      __atomic_add_fetch (&s->pushed, 1, __ATOMIC_RELAXED);
+      /* A full pipe already wakes the consumer */
+      if (write (s->wake[1], "", 1) < 0 && errno != EAGAIN) {
+	perror ("sensor");
+      }
+    }
+    primed = 1;
+    last = rec.rotation;
+    last_time = t;
+  }
+
+  return NULL;
+}
+
+static int
+open_pipe (int fds[2])
+{
+  int i;
+
+  if (pipe (fds) != 0) {
+    perror ("pipe");
+    return EXIT_FAILURE;
+  }
+  for (i = 0; i < 2; i++) {
+    fcntl (fds[i], F_SETFL, fcntl (fds[i], F_GETFL) | O_NONBLOCK);
+    fcntl (fds[i], F_SETFD, FD_CLOEXEC);
+  }
+
+  return EXIT_SUCCESS;
+}
+
+/* Opens a connection of the thread, registers the motion events of
+   the input on it and starts the thread */
+sensor_thread *
+sensor_start (context *ctx,
+	      Window root,
+	      XDeviceInfo *input,
+	      const orientation_classifier *oc,
+	      orientation_reducer *reducer)
+{
+  sensor_thread *s;
+  int err;
+
+  s = calloc (1, sizeof (sensor_thread));
+  s->oc = oc;
+  s->reducer = reducer;
+  s->wake[0] = s->wake[1] = s->stop[0] = s->stop[1] = -1;
+
+  s->display = XOpenDisplay (DisplayString (ctx->display));
+  if (!s->display) {
+    fprintf (stderr, "Unable to open the sensor connection\n");
+    goto fail;
+  }
+#if HAVE_XI2
+  if (ctx->conn.xi2) {
+    s->xi_opcode = ctx->conn.xi_opcode;
+    s->raw = select_raw_events (s->display, root, input->id);
+    if (!s->raw) {
+      fprintf (stderr, "Unable to select the raw events, falling back to XI 1\n");
+    }
+  }
+#endif
+  if (!s->raw && ! register_events(s->display, root, input, "", False, &s->ev)) {
+    fprintf(stderr, "Unable to register for input events.\n");
+    goto fail;
+  }
+  if (ctx->verbose) {
+    fprintf (stderr, "Sensor events: %s\n", s->raw ? "XI 2 raw motion" : "XI 1 device motion");
+  }
+  XFlush (s->display);
+
+  if (open_pipe (s->wake) != EXIT_SUCCESS ||
+      open_pipe (s->stop) != EXIT_SUCCESS) {
+    goto fail;
+  }
+
+  err = pthread_create (&s->thread, NULL, sensor_main, s);
+  if (err != 0) {
+    fprintf (stderr, "Unable to start the sensor thread: %s\n", strerror (err));
+    goto fail;
+  }
+
+  return s;
+
+ fail:
+  if (s->display) {
+    XCloseDisplay (s->display);
+  }
+  close (s->wake[0]);
+  close (s->wake[1]);
+  close (s->stop[0]);
+  close (s->stop[1]);
+  free (s);
+  return NULL;
+}
+
+/* Pops all the pushed records, keeping the latest one. Returns the
+   number of the records. */
+int
+sensor_read (sensor_thread *s,
+	     sensor_record *latest)
+{
+  char buf[64];
+  int n = 0;
+
+  /* Clear the wake-ups first: a record pushed after the ring is
+     emptied wakes again */
+  while (read (s->wake[0], buf, sizeof (buf)) > 0);
+  while (sensor_ring_pop (&s->ring, latest)) {
+    n++;
+  }
+
+  return n;
+}
+
+void
+sensor_stop (sensor_thread *s)
+{
+  if (!s) {
+    return;
+  }
+
+  if (write (s->stop[1], "", 1) == 1) {
+    pthread_join (s->thread, NULL);
+  }
+  XCloseDisplay (s->display);
+  close (s->wake[0]);
+  close (s->wake[1]);
+  close (s->stop[0]);
+  close (s->stop[1]);
+  free (s);
+}
+
+/* end of sensor.c */
@@ -0,0 +1,134 @@
+/*
+ * Original xinput:
+ * Copyright 1996 by Frederic Lepied, France. <Frederic.Lepied@sugix.frmug.org>
+ *
+ * Original xrandr:
+ * Copyright © 2001 Keith Packard, member of The XFree86 Project, Inc.
+ * Copyright © 2002 Hewlett Packard Company, Inc.
+ * Copyright © 2006 Intel Corporation
+ *
+ * xrandr-align:
+ *
+ * Copyright © 2012 Paul Wolneykien <manowar@altlinux.org>, ALT Linux Ltd.
+ *
+ * Permission to use, copy, modify, distribute, and sell this software and its
+ * documentation for any purpose is  hereby granted without fee, provided that
+ * the  above copyright   notice appear  in   all  copies and  that both  that
+ * copyright  notice   and   this  permission   notice  appear  in  supporting
+ * documentation, and that   the  name of  the authors  not  be  used  in
+ * advertising or publicity pertaining to distribution of the software without
+ * specific,  written      prior  permission.     The authors  make  no
+ * representations about the suitability of this software for any purpose.  It
+ * is provided "as is" without express or implied warranty.
+ *
+ * THE AUTHORS DISCLAIM ALL   WARRANTIES WITH REGARD  TO  THIS SOFTWARE,
+ * INCLUDING ALL IMPLIED   WARRANTIES OF MERCHANTABILITY  AND   FITNESS, IN NO
+ * EVENT  SHALL THE AUTHORS  BE   LIABLE   FOR ANY  SPECIAL, INDIRECT   OR
+ * CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM LOSS OF USE,
+ * DATA  OR PROFITS, WHETHER  IN  AN ACTION OF  CONTRACT,  NEGLIGENCE OR OTHER
+ * TORTIOUS  ACTION, ARISING    OUT OF OR   IN  CONNECTION  WITH THE USE    OR
+ * PERFORMANCE OF THIS SOFTWARE.
+ *
+ */
+
+/*
+ * Gravity sensor thread.
+ *
+ * The samples of the sensor are read on a thread of their own with
+ * its own X connection, so they are taken in time while the main
+ * thread waits for a rotation to be committed. With XI 2 the raw
+ * motion of the sensor alone is selected: the valuators come
+ * unaccelerated and untransformed, with any number of axes, and the
+ * other devices wake nothing. Otherwise the XI 1 motion events of
+ * the device are used. The thread drains the
+ * queued motion events, reduces and classifies each batch and pushes
+ * the decimated result (the changes of the decision and one record
+ * per period) to a lock-free single-producer/single-consumer ring.
+ * The main thread waits for the wake descriptor and pops the records.
+ */
+
+#include <pthread.h>
+
+/* The most motion events drained per batch */
+#define SENSOR_BATCH 64
+
+/* The longest time (ms) between two records of the same decision */
+#define SENSOR_PERIOD 250
+
+/* The ring capacity, a power of two */
+#define SENSOR_RING_SIZE 256
+
+#define SENSOR_CACHE_LINE 64
+
+typedef struct
+{
+  Time time;		/* the server time of the latest sample */
+  float g[3];		/* the reduced gravity vector, m/s^2 */
+  unsigned char rotation;	/* the decision, 0 if none */
+  unsigned short samples;	/* the samples reduced */
+} sensor_record;
+
+/* The head is written by the producer only, the tail by the consumer
+   only; they are kept on separate cache lines */
+typedef struct
+{
+  unsigned int head;
+  char pad1[SENSOR_CACHE_LINE - sizeof (unsigned int)];
+  unsigned int tail;
+  char pad2[SENSOR_CACHE_LINE - sizeof (unsigned int)];
+  unsigned long overflows;	/* the records lost on a full ring */
+  sensor_record slots[SENSOR_RING_SIZE];
+} sensor_ring;
+
+int
+sensor_ring_push (sensor_ring *ring,
+		  const sensor_record *rec);
+
+int
+sensor_ring_pop (sensor_ring *ring,
+		 sensor_record *rec);
+
+/* The XI 1 event types of the device, assigned on registration */
+typedef struct
+{
+    int motion_type;
+    int button_press_type;
+    int button_release_type;
+    int key_press_type;
+    int key_release_type;
+    int proximity_in_type;
+    int proximity_out_type;
+} device_events;
+
+typedef struct
+{
+  Display *display;	/* the own connection of the thread */
+  const orientation_classifier *oc;
+  orientation_reducer *reducer;
+  int raw;		/* XI 2 raw events are selected */
+  int xi_opcode;
+  device_events ev;	/* the XI 1 events otherwise */
+  sensor_ring ring;
+  int wake[2];		/* readable when records are pushed */
+  int stop[2];		/* readable when the thread should stop */
+  pthread_t thread;
+  unsigned long events;	/* the counters of the thread */
+  unsigned long batches;
+  unsigned long pushed;
+} sensor_thread;
+
+sensor_thread *
+sensor_start (context *ctx,
+	      Window root,
+	      XDeviceInfo *input,
+	      const orientation_classifier *oc,
+	      orientation_reducer *reducer);
+
+#define sensor_fd(s) ((s)->wake[0])
+
+int
+sensor_read (sensor_thread *s,
+	     sensor_record *latest);
+
+void
+sensor_stop (sensor_thread *s);
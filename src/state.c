@@ -0,0 +1,288 @@
+/*
+ * Original xinput:
+ * Copyright 1996 by Frederic Lepied, France. <Frederic.Lepied@sugix.frmug.org>
+ *
+ * Original xrandr:
+ * Copyright © 2001 Keith Packard, member of The XFree86 Project, Inc.
+ * Copyright © 2002 Hewlett Packard Company, Inc.
+ * Copyright © 2006 Intel Corporation
+ *
+ * xrandr-align:
+ *
+ * Copyright © 2012 Paul Wolneykien <manowar@altlinux.org>, ALT Linux Ltd.
+ *
+ * Permission to use, copy, modify, distribute, and sell this software and its
+ * documentation for any purpose is  hereby granted without fee, provided that
+ * the  above copyright   notice appear  in   all  copies and  that both  that
+ * copyright  notice   and   this  permission   notice  appear  in  supporting
+ * documentation, and that   the  name of  the authors  not  be  used  in
+ * advertising or publicity pertaining to distribution of the software without
+ * specific,  written      prior  permission.     The authors  make  no
+ * representations about the suitability of this software for any purpose.  It
+ * is provided "as is" without express or implied warranty.
+ *
+ * THE AUTHORS DISCLAIM ALL   WARRANTIES WITH REGARD  TO  THIS SOFTWARE,
+ * INCLUDING ALL IMPLIED   WARRANTIES OF MERCHANTABILITY  AND   FITNESS, IN NO
+ * EVENT  SHALL THE AUTHORS  BE   LIABLE   FOR ANY  SPECIAL, INDIRECT   OR
+ * CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM LOSS OF USE,
+ * DATA  OR PROFITS, WHETHER  IN  AN ACTION OF  CONTRACT,  NEGLIGENCE OR OTHER
+ * TORTIOUS  ACTION, ARISING    OUT OF OR   IN  CONNECTION  WITH THE USE    OR
+ * PERFORMANCE OF THIS SOFTWARE.
+ *
+ */
+
+#include "common.h"
+#include "xrandr-align.h"
+#include "state.h"
+#include "profile.h"
+#include <errno.h>
+#include <fcntl.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/file.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+/* ${XDG_CACHE_HOME:-$HOME/.cache}/xrandr-align/state-DISPLAY */
+static int
+default_path (Display *display,
+	      char *path,
+	      size_t size)
+{
+  const char *cache = getenv ("XDG_CACHE_HOME");
+  const char *home = getenv ("HOME");
+  char *p;
+  int len;
+
+  if (cache && strlen (cache) > 0) {
+    len = snprintf (path, size, "%s/xrandr-align", cache);
+  } else if (home && strlen (home) > 0) {
+    len = snprintf (path, size, "%s/.cache", home);
+    mkdir (path, 0700);
+    len = snprintf (path, size, "%s/.cache/xrandr-align", home);
+  } else {
+    return EXIT_FAILURE;
+  }
+  if (len >= size) {
+    return EXIT_FAILURE;
+  }
+  if (mkdir (path, 0700) != 0 && errno != EEXIST) {
+    perror (path);
+    return EXIT_FAILURE;
+  }
+
+  p = path + len;
+  len += snprintf (p, size - len, "/state-%s", DisplayString (display));
+  if (len >= size) {
+    return EXIT_FAILURE;
+  }
+  for (p++; *p; p++) {
+    if (*p == '/') {
+      *p = '_';
+    }
+  }
+
+  return EXIT_SUCCESS;
+}
+
+state_file *
+state_open (context *ctx,
+	    const char *path)
+{
+  Display *display = ctx->display;
+  char defpath[1024];
+  state_data *map;
+  state_file *state;
+  struct stat st;
+  int fd;
+
+  if (path == NULL || strlen (path) == 0) {
+    if (default_path (display, defpath, sizeof (defpath)) == EXIT_FAILURE) {
+      fprintf (stderr, "Unable to locate the state file\n");
+      return NULL;
+    }
+    path = defpath;
+  }
+
+  fd = open (path, O_RDWR | O_CREAT, 0600);
+  if (fd < 0) {
+    perror (path);
+    return NULL;
+  }
+
+  flock (fd, LOCK_EX);
+  if (fstat (fd, &st) != 0 ||
+      (st.st_size != sizeof (state_data) &&
+       (ftruncate (fd, 0) != 0 || ftruncate (fd, sizeof (state_data)) != 0))) {
+    perror (path);
+    flock (fd, LOCK_UN);
+    close (fd);
+    return NULL;
+  }
+
+  map = mmap (NULL, sizeof (state_data), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+  if (map == MAP_FAILED) {
+    perror (path);
+    flock (fd, LOCK_UN);
+    close (fd);
+    return NULL;
+  }
+
+  if (map->magic != STATE_MAGIC ||
+      map->version != STATE_VERSION ||
+      map->size != sizeof (state_data)) {
+    if (ctx->verbose) {
+      fprintf (stderr, "Initialize the state file %s\n", path);
+    }
+    memset (map, 0, sizeof (state_data));
+    map->magic = STATE_MAGIC;
+    map->version = STATE_VERSION;
+    map->size = sizeof (state_data);
+  }
+  flock (fd, LOCK_UN);
+
+  state = calloc (1, sizeof (state_file));
+  state->fd = fd;
+  state->map = map;
+  snprintf (state->display, sizeof (state->display), "%s", DisplayString (display));
+  return state;
+}
+
+void
+state_close (state_file *state)
+{
+  if (state) {
+    munmap (state->map, sizeof (state_data));
+    close (state->fd);
+    free (state);
+  }
+}
+
+state_entry *
+state_lookup (state_file *state,
+	      int screen,
+	      const char *output,
+	      const char *input)
+{
+  int i;
+
+  for (i = 0; i < STATE_ENTRIES; i++) {
+    state_entry *e = &state->map->entries[i];
+    if (e->used && e->screen == screen &&
+	strncmp (e->display, state->display, sizeof (e->display)) == 0 &&
+	strncmp (e->output, output, sizeof (e->output)) == 0 &&
+	strncmp (e->input, input, sizeof (e->input)) == 0) {
+      return e;
+    }
+  }
+
+  return NULL;
+}
+
+/* The entry is valid if the RandR configuration has not changed since
+   the alignment, its output and CRTC are still there, the input still
+   has the same device ID and its matrix is still the one written (read
+   back with a single property request). */
+int
+state_check (context *ctx,
+	     Window root,
+	     const state_entry *entry,
+	     XID deviceid)
+{
+  Display *display = ctx->display;
+  XRRScreenResources *res;
+  float matrix[9];
+  int valid;
+  int i;
+
+  XPROF (display, "XRRGetScreenResourcesCurrent",
+	 res = XRRGetScreenResourcesCurrent (display, root));
+  if (!res) {
+    return 0;
+  }
+
+  valid = (uint32_t) res->timestamp == entry->timestamp &&
+    (uint32_t) res->configTimestamp == entry->config_timestamp;
+
+  for (i = 0; valid && i < res->noutput; i++) {
+    if (res->outputs[i] == entry->outputid) {
+      break;
+    }
+  }
+  valid = valid && i < res->noutput;
+
+  for (i = 0; valid && i < res->ncrtc; i++) {
+    if (res->crtcs[i] == entry->crtc) {
+      break;
+    }
+  }
+  valid = valid && i < res->ncrtc;
+
+  XRRFreeScreenResources (res);
+
+  /* Another device may have taken the ID, or the matrix may have been
+     changed behind our back (xinput, another tool) */
+  valid = valid && entry->deviceid == deviceid;
+  if (valid) {
+    valid = get_float_prop (ctx, deviceid, ctx->conn.matrix_atom, matrix, 9) != EXIT_FAILURE;
+  }
+  for (i = 0; valid && i < 9; i++) {
+    valid = matrix[i] == entry->matrix[i];
+  }
+
+  return valid;
+}
+
+void
+state_store (state_file *state,
+	     int screen,
+	     const char *output,
+	     const char *input,
+	     RROutput outputid,
+	     const alignment *al)
+{
+  state_entry *e;
+  int i;
+
+  if (strlen (output) >= sizeof (e->output) ||
+      strlen (input) >= sizeof (e->input)) {
+    return;
+  }
+
+  flock (state->fd, LOCK_EX);
+
+  e = state_lookup (state, screen, output, input);
+  if (!e) {
+    /* Take a free entry or the least recently stored one */
+    e = &state->map->entries[0];
+    for (i = 0; i < STATE_ENTRIES && e->used; i++) {
+      if (!state->map->entries[i].used ||
+	  state->map->entries[i].generation < e->generation) {
+	e = &state->map->entries[i];
+      }
+    }
+    memset (e, 0, sizeof (state_entry));
+    strcpy (e->display, state->display);
+    e->screen = screen;
+    strcpy (e->output, output);
+    strcpy (e->input, input);
+  }
+
+  e->generation = ++state->map->generation;
+  e->outputid = outputid;
+  e->crtc = al->crtc;
+  e->x = al->x;
+  e->y = al->y;
+  e->width = al->width;
+  e->height = al->height;
+  e->rotation = al->rotation;
+  e->timestamp = al->timestamp;
+  e->config_timestamp = al->config_timestamp;
+  e->deviceid = al->deviceid;
+  memcpy (e->matrix, al->matrix, sizeof (e->matrix));
+  e->used = 1;
+
+  flock (state->fd, LOCK_UN);
+}
+
+/* end of state.c */
@@ -0,0 +1,116 @@
+/*
+ * Original xinput:
+ * Copyright 1996 by Frederic Lepied, France. <Frederic.Lepied@sugix.frmug.org>
+ *
+ * Original xrandr:
+ * Copyright © 2001 Keith Packard, member of The XFree86 Project, Inc.
+ * Copyright © 2002 Hewlett Packard Company, Inc.
+ * Copyright © 2006 Intel Corporation
+ *
+ * xrandr-align:
+ *
+ * Copyright © 2012 Paul Wolneykien <manowar@altlinux.org>, ALT Linux Ltd.
+ *
+ * Permission to use, copy, modify, distribute, and sell this software and its
+ * documentation for any purpose is  hereby granted without fee, provided that
+ * the  above copyright   notice appear  in   all  copies and  that both  that
+ * copyright  notice   and   this  permission   notice  appear  in  supporting
+ * documentation, and that   the  name of  the authors  not  be  used  in
+ * advertising or publicity pertaining to distribution of the software without
+ * specific,  written      prior  permission.     The authors  make  no
+ * representations about the suitability of this software for any purpose.  It
+ * is provided "as is" without express or implied warranty.
+ *
+ * THE AUTHORS DISCLAIM ALL   WARRANTIES WITH REGARD  TO  THIS SOFTWARE,
+ * INCLUDING ALL IMPLIED   WARRANTIES OF MERCHANTABILITY  AND   FITNESS, IN NO
+ * EVENT  SHALL THE AUTHORS  BE   LIABLE   FOR ANY  SPECIAL, INDIRECT   OR
+ * CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM LOSS OF USE,
+ * DATA  OR PROFITS, WHETHER  IN  AN ACTION OF  CONTRACT,  NEGLIGENCE OR OTHER
+ * TORTIOUS  ACTION, ARISING    OUT OF OR   IN  CONNECTION  WITH THE USE    OR
+ * PERFORMANCE OF THIS SOFTWARE.
+ *
+ */
+
+/*
+ * Persistent alignment state.
+ *
+ * The state of the monitored bindings is kept in a small fixed-size
+ * binary file per display, mapped into memory. The entries are keyed
+ * by the display name too, so several displays may share a file
+ * given with --state. Each entry records the
+ * output and CRTC the input was aligned to, the RandR timestamps of
+ * that configuration, the device ID and the applied matrix. On start,
+ * the monitor checks an entry against the current screen resources,
+ * the current ID of the input and its Coordinate Transformation Matrix
+ * read back (one request each) and skips the alignment if nothing has
+ * changed.
+ */
+
+#include <stdint.h>
+
+#define STATE_MAGIC	0x58524153	/* "XRAS" */
+#define STATE_VERSION	2
+#define STATE_ENTRIES	32
+
+typedef struct
+{
+  uint32_t used;
+  uint32_t generation;
+  char display[64];
+  int32_t screen;
+  char output[64];
+  char input[128];
+  uint32_t outputid;
+  uint32_t crtc;
+  int32_t x, y;
+  uint32_t width, height;
+  uint32_t rotation;
+  uint32_t timestamp;
+  uint32_t config_timestamp;
+  uint32_t deviceid;
+  float matrix[9];
+} state_entry;
+
+typedef struct
+{
+  uint32_t magic;
+  uint32_t version;
+  uint32_t size;
+  uint32_t generation;
+  state_entry entries[STATE_ENTRIES];
+} state_data;
+
+/* An open state file, used by the thread of its display only */
+typedef struct
+{
+  int fd;
+  state_data *map;
+  char display[64];	/* the key of the entries of the display */
+} state_file;
+
+state_file *
+state_open (context *ctx,
+	    const char *path);
+
+void
+state_close (state_file *state);
+
+state_entry *
+state_lookup (state_file *state,
+	      int screen,
+	      const char *output,
+	      const char *input);
+
+int
+state_check (context *ctx,
+	     Window root,
+	     const state_entry *entry,
+	     XID deviceid);
+
+void
+state_store (state_file *state,
+	     int screen,
+	     const char *output,
+	     const char *input,
+	     RROutput outputid,
+	     const alignment *al);
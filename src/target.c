@@ -0,0 +1,321 @@
+/*
+ * Original xinput:
+ * Copyright 1996 by Frederic Lepied, France. <Frederic.Lepied@sugix.frmug.org>
+ *
+ * Original xrandr:
+ * Copyright © 2001 Keith Packard, member of The XFree86 Project, Inc.
+ * Copyright © 2002 Hewlett Packard Company, Inc.
+ * Copyright © 2006 Intel Corporation
+ *
+ * xrandr-align:
+ *
+ * Copyright © 2012 Paul Wolneykien <manowar@altlinux.org>, ALT Linux Ltd.
+ *
+ * Permission to use, copy, modify, distribute, and sell this software and its
+ * documentation for any purpose is  hereby granted without fee, provided that
+ * the  above copyright   notice appear  in   all  copies and  that both  that
+ * copyright  notice   and   this  permission   notice  appear  in  supporting
+ * documentation, and that   the  name of  the authors  not  be  used  in
+ * advertising or publicity pertaining to distribution of the software without
+ * specific,  written      prior  permission.     The authors  make  no
+ * representations about the suitability of this software for any purpose.  It
+ * is provided "as is" without express or implied warranty.
+ *
+ * THE AUTHORS DISCLAIM ALL   WARRANTIES WITH REGARD  TO  THIS SOFTWARE,
+ * INCLUDING ALL IMPLIED   WARRANTIES OF MERCHANTABILITY  AND   FITNESS, IN NO
+ * EVENT  SHALL THE AUTHORS  BE   LIABLE   FOR ANY  SPECIAL, INDIRECT   OR
+ * CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM LOSS OF USE,
+ * DATA  OR PROFITS, WHETHER  IN  AN ACTION OF  CONTRACT,  NEGLIGENCE OR OTHER
+ * TORTIOUS  ACTION, ARISING    OUT OF OR   IN  CONNECTION  WITH THE USE    OR
+ * PERFORMANCE OF THIS SOFTWARE.
+ *
+ */
+#include "common.h"
+#include "xrandr-align.h"
+#include "profile.h"
+#include "transform.h"
+#include "target.h"
+#include <string.h>
+
+int
+target_is_group (const char *outname)
+{
+  return strncmp (outname, TARGET_MONITOR_PREFIX, strlen (TARGET_MONITOR_PREFIX)) == 0 ||
+    strchr (outname, '+') != NULL;
+}
+
+static int
+add_member (target *t,
+	    RROutput output,
+	    RRCrtc crtc)
+{
+  if (t->count == TARGET_MEMBERS_MAX) {
+    fprintf (stderr, "Too many outputs in a group, at most %i are used\n", TARGET_MEMBERS_MAX);
+    return EXIT_FAILURE;
+  }
+  t->outputs[t->count] = output;
+  t->crtcs[t->count] = crtc;
+  t->count++;
+
+  return EXIT_SUCCESS;
+}
+
+static int
+find_monitor (Display *display,
+	      Window root,
+	      XRRScreenResources *res,
+	      const char *name,
+	      target *t)
+{
+#if HAVE_RANDR_MONITORS
+  XRRMonitorInfo *monitors;
+  XRROutputInfo *info;
+  Atom atom;
+  int n, m, o;
+
+  XPROF (display, "XInternAtom",
+	 atom = XInternAtom (display, name, True));
+  if (atom == None) {
+    fprintf (stderr, "Monitor '%s' not found\n", name);
+    return EXIT_FAILURE;
+  }
+
+  XPROF (display, "XRRGetMonitors",
+	 monitors = XRRGetMonitors (display, root, True, &n));
+  for (m = 0; m < n; m++) {
+    if (monitors[m].name == atom) {
+      break;
+    }
+  }
+  if (m == n) {
+    fprintf (stderr, "Monitor '%s' not found\n", name);
+    XRRFreeMonitors (monitors);
+    return EXIT_FAILURE;
+  }
+
+  t->monitor = 1;
+  t->x = monitors[m].x;
+  t->y = monitors[m].y;
+  t->width = monitors[m].width;
+  t->height = monitors[m].height;
+  for (o = 0; o < monitors[m].noutput; o++) {
+    XPROF (display, "XRRGetOutputInfo",
+	   info = XRRGetOutputInfo (display, res, monitors[m].outputs[o]));
+    if (info) {
+      add_member (t, monitors[m].outputs[o], info->crtc);
+      XRRFreeOutputInfo (info);
+    }
+  }
+  XRRFreeMonitors (monitors);
+
+  return EXIT_SUCCESS;
+#else
+  fprintf (stderr, "RandR 1.5 monitors are not supported by this build\n");
+  return EXIT_FAILURE;
+#endif
+}
+
+/* Resolves the output of a binding to its member outputs and their
+   current CRTCs. A single output is a target of one member. */
+int
+target_find (Display *display,
+	     Window root,
+	     XRRScreenResources *res,
+	     XRROutputInfo **infos,
+	     const char *outname,
+	     target *t)
+{
+  char name[256];
+  char *p, *save;
+  int o;
+
+  memset (t, 0, sizeof (target));
+
+  if (strncmp (outname, TARGET_MONITOR_PREFIX, strlen (TARGET_MONITOR_PREFIX)) == 0) {
+    return find_monitor (display, root, res, outname + strlen (TARGET_MONITOR_PREFIX), t);
+  }
+
+  snprintf (name, sizeof (name), "%s", outname);
+  for (p = strtok_r (name, "+", &save); p; p = strtok_r (NULL, "+", &save)) {
+    o = find_output (display, root, res, infos, p);
+    if (o < 0 || add_member (t, res->outputs[o], infos[o]->crtc) == EXIT_FAILURE) {
+      return EXIT_FAILURE;
+    }
+  }
+  if (t->count == 0) {
+    o = find_output (display, root, res, infos, "");
+    if (o < 0) {
+      return EXIT_FAILURE;
+    }
+    add_member (t, res->outputs[o], infos[o]->crtc);
+  }
+
+  return EXIT_SUCCESS;
+}
+
+/* Returns the first enabled CRTC, None if there is none */
+RRCrtc
+target_crtc (const target *t)
+{
+  int i;
+
+  for (i = 0; i < t->count; i++) {
+    if (t->crtcs[i]) {
+      return t->crtcs[i];
+    }
+  }
+
+  return None;
+}
+
+int
+target_has_output (const target *t,
+		   RROutput output)
+{
+  int i;
+
+  for (i = 0; i < t->count; i++) {
+    if (t->outputs[i] == output) {
+      return 1;
+    }
+  }
+
+  return 0;
+}
+
+int
+target_has_crtc (const target *t,
+		 RRCrtc crtc)
+{
+  int i;
+
+  for (i = 0; i < t->count; i++) {
+    if (crtc && t->crtcs[i] == crtc) {
+      return 1;
+    }
+  }
+
+  return 0;
+}
+
+/* Computes the matrix of the target from the replies cached for the
+   screen. A single CRTC is aligned as usual; a group is mapped to its
+   bounding box. The CRTC of the alignment is the first enabled one. */
+int
+compute_target_transform (context *ctx,
+			  screen_cache *sc,
+			  const target *t,
+			  alignment *al)
+{
+  Display *display = ctx->display;
+  const screen_crtc *c;
+  XRRCrtcInfo box;
+  const XRRCrtcInfo *crtc;
+  XTransform identity;
+  transform_geometry geometry;
+  XRRScreenSize *ssize;
+  Rotation srot;
+  Rotation rotation = RR_Rotate_0;
+  int mixed = 0;
+  RRCrtc first = None;
+  int x2 = 0, y2 = 0;
+  int enabled = 0;
+  int nsizes;
+  int ret;
+  int i, j;
+
+  first = target_crtc (t);
+  for (i = 0; i < t->count; i++) {
+    if (t->crtcs[i]) {
+      enabled++;
+    }
+  }
+  if (!first) {
+    fprintf (stderr, "No output of the group is enabled\n");
+    return EXIT_FAILURE;
+  }
+  if (target_is_single (t)) {
+    return screen_transform (ctx, sc, first, al);
+  }
+
+  memset (&box, 0, sizeof (box));
+  enabled = 0;
+  for (i = 0; i < t->count; i++) {
+    if (!t->crtcs[i]) {
+      continue;
+    }
+    for (j = 0; j < i; j++) {
+      if (t->crtcs[j] == t->crtcs[i]) {
+	break;
+      }
+    }
+    if (j < i) {
+      /* A clone */
+      continue;
+    }
+    c = screen_get_crtc (display, sc, t->crtcs[i]);
+    if (!c) {
+      continue;
+    }
+    crtc = c->info;
+    if (enabled == 0) {
+      box.x = crtc->x;
+      box.y = crtc->y;
+      x2 = crtc->x + crtc->width;
+      y2 = crtc->y + crtc->height;
+      rotation = crtc->rotation;
+    } else {
+      box.x = crtc->x < box.x ? crtc->x : box.x;
+      box.y = crtc->y < box.y ? crtc->y : box.y;
+      x2 = crtc->x + (int) crtc->width > x2 ? crtc->x + (int) crtc->width : x2;
+      y2 = crtc->y + (int) crtc->height > y2 ? crtc->y + (int) crtc->height : y2;
+      if (crtc->rotation != rotation && !mixed) {
+	fprintf (stderr, "The CRTCs of the group are rotated differently: the group is not rotated\n");
+	mixed = 1;
+      }
+    }
+    enabled++;
+  }
+  box.rotation = mixed ? RR_Rotate_0 : rotation;
+  box.width = x2 - box.x;
+  box.height = y2 - box.y;
+  if (t->monitor) {
+    box.x = t->x;
+    box.y = t->y;
+    box.width = t->width;
+    box.height = t->height;
+  }
+  if (box.width == 0 || box.height == 0) {
+    fprintf (stderr, "The group has no area\n");
+    return EXIT_FAILURE;
+  }
+
+  ssize = XRRConfigSizes (sc->sconf, &nsizes) + XRRConfigCurrentConfiguration (sc->sconf, &srot);
+  if (ctx->verbose) {
+    fprintf (stderr, "Group: (%i, %i) (%u, %u) 0x%02x, %i CRTCs\n",
+	     box.x, box.y, box.width, box.height, box.rotation, enabled);
+  }
+
+  memset (&identity, 0, sizeof (identity));
+  for (i = 0; i < 3; i++) {
+    identity.matrix[i][i] = XDoubleToFixed (1);
+  }
+
+  ret = transform_geometry_init (&geometry, srot, ssize->width, ssize->height,
+				 &box, &identity);
+  if (ret != EXIT_FAILURE) {
+    transform_matrix (&geometry, al->matrix);
+    al->timestamp = sc->res->timestamp;
+    al->config_timestamp = sc->res->configTimestamp;
+    al->crtc = first;
+    al->x = box.x;
+    al->y = box.y;
+    al->width = box.width;
+    al->height = box.height;
+    al->rotation = box.rotation;
+  }
+
+  return ret;
+}
+
+/* end of target.c */
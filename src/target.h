@@ -0,0 +1,97 @@
+/*
+ * Original xinput:
+ * Copyright 1996 by Frederic Lepied, France. <Frederic.Lepied@sugix.frmug.org>
+ *
+ * Original xrandr:
+ * Copyright © 2001 Keith Packard, member of The XFree86 Project, Inc.
+ * Copyright © 2002 Hewlett Packard Company, Inc.
+ * Copyright © 2006 Intel Corporation
+ *
+ * xrandr-align:
+ *
+ * Copyright © 2012 Paul Wolneykien <manowar@altlinux.org>, ALT Linux Ltd.
+ *
+ * Permission to use, copy, modify, distribute, and sell this software and its
+ * documentation for any purpose is  hereby granted without fee, provided that
+ * the  above copyright   notice appear  in   all  copies and  that both  that
+ * copyright  notice   and   this  permission   notice  appear  in  supporting
+ * documentation, and that   the  name of  the authors  not  be  used  in
+ * advertising or publicity pertaining to distribution of the software without
+ * specific,  written      prior  permission.     The authors  make  no
+ * representations about the suitability of this software for any purpose.  It
+ * is provided "as is" without express or implied warranty.
+ *
+ * THE AUTHORS DISCLAIM ALL   WARRANTIES WITH REGARD  TO  THIS SOFTWARE,
+ * INCLUDING ALL IMPLIED   WARRANTIES OF MERCHANTABILITY  AND   FITNESS, IN NO
+ * EVENT  SHALL THE AUTHORS  BE   LIABLE   FOR ANY  SPECIAL, INDIRECT   OR
+ * CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM LOSS OF USE,
+ * DATA  OR PROFITS, WHETHER  IN  AN ACTION OF  CONTRACT,  NEGLIGENCE OR OTHER
+ * TORTIOUS  ACTION, ARISING    OUT OF OR   IN  CONNECTION  WITH THE USE    OR
+ * PERFORMANCE OF THIS SOFTWARE.
+ *
+ */
+
+/*
+ * Binding targets spanning several CRTCs.
+ *
+ * Besides a single output, the output of a binding can be:
+ *
+ *   OUTPUT+OUTPUT[+OUTPUT]...  the union of the CRTCs of the outputs
+ *                              (a tiled panel, a video wall);
+ *   monitor:NAME               a RandR 1.5 monitor (xrandr --listmonitors).
+ *
+ * The input is mapped to the bounding box of the enabled CRTCs, or to
+ * the geometry of the monitor, rotated as the member CRTCs are if they
+ * all agree (the CRTC transforms are not applied to a group).
+ */
+
+#define TARGET_MEMBERS_MAX 16
+#define TARGET_MONITOR_PREFIX "monitor:"
+
+typedef struct
+{
+  int count;
+  RROutput outputs[TARGET_MEMBERS_MAX];
+  RRCrtc crtcs[TARGET_MEMBERS_MAX];	/* 0 for a disabled output */
+  int monitor;		/* the geometry is the one of the monitor */
+  int x, y;
+  unsigned int width, height;
+} target;
+
+#define target_is_single(t) ((t)->count == 1 && !(t)->monitor)
+
+int
+target_is_group (const char *outname);
+
+RRCrtc
+target_crtc (const target *t);
+
+int
+target_find (Display *display,
+	     Window root,
+	     XRRScreenResources *res,
+	     XRROutputInfo **infos,
+	     const char *outname,
+	     target *t);
+
+int
+target_has_output (const target *t,
+		   RROutput output);
+
+int
+target_has_crtc (const target *t,
+		 RRCrtc crtc);
+
+int
+align_bindings (context *ctx,
+		screen_cache *sc,
+		binding *bindings,
+		int count,
+		alignment *retals,
+		target *rettargets);
+
+int
+compute_target_transform (context *ctx,
+			  screen_cache *sc,
+			  const target *t,
+			  alignment *al);
@@ -0,0 +1,345 @@
+/*
+ * Original xinput:
+ * Copyright 1996 by Frederic Lepied, France. <Frederic.Lepied@sugix.frmug.org>
+ *
+ * Original xrandr:
+ * Copyright © 2001 Keith Packard, member of The XFree86 Project, Inc.
+ * Copyright © 2002 Hewlett Packard Company, Inc.
+ * Copyright © 2006 Intel Corporation
+ *
+ * xrandr-align:
+ *
+ * Copyright © 2012 Paul Wolneykien <manowar@altlinux.org>, ALT Linux Ltd.
+ *
+ * Permission to use, copy, modify, distribute, and sell this software and its
+ * documentation for any purpose is  hereby granted without fee, provided that
+ * the  above copyright   notice appear  in   all  copies and  that both  that
+ * copyright  notice   and   this  permission   notice  appear  in  supporting
+ * documentation, and that   the  name of  the authors  not  be  used  in
+ * advertising or publicity pertaining to distribution of the software without
+ * specific,  written      prior  permission.     The authors  make  no
+ * representations about the suitability of this software for any purpose.  It
+ * is provided "as is" without express or implied warranty.
+ *
+ * THE AUTHORS DISCLAIM ALL   WARRANTIES WITH REGARD  TO  THIS SOFTWARE,
+ * INCLUDING ALL IMPLIED   WARRANTIES OF MERCHANTABILITY  AND   FITNESS, IN NO
+ * EVENT  SHALL THE AUTHORS  BE   LIABLE   FOR ANY  SPECIAL, INDIRECT   OR
+ * CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM LOSS OF USE,
+ * DATA  OR PROFITS, WHETHER  IN  AN ACTION OF  CONTRACT,  NEGLIGENCE OR OTHER
+ * TORTIOUS  ACTION, ARISING    OUT OF OR   IN  CONNECTION  WITH THE USE    OR
+ * PERFORMANCE OF THIS SOFTWARE.
+ *
+ */
+#include "common.h"
+#include "xrandr-align.h"
+#include "control.h"
+#include "trace.h"
+#include <errno.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+static trace_record ring[TRACE_SIZE];
+static uint32_t head = 0;
+static __thread uint8_t source = 0;
+
+/* Set up once, before the handlers are installed */
+static char dump_path[256];
+static int installed = 0;
+
+static const char *type_names[TRACE_TYPES] = {
+  "none",
+  "screen-change",
+  "output-change",
+  "crtc-change",
+  "align",
+  "write-failed",
+  "sensor",
+  "rotate",
+  "rotate-failed"
+};
+
+/* Tags the records of the calling thread with the display it serves */
+void
+trace_set_source (int n)
+{
+  source = n;
+}
+
+void
+trace_event (trace_type type,
+	     Time xtime,
+	     XID id0,
+	     XID id1,
+	     int x,
+	     int y,
+	     unsigned int width,
+	     unsigned int height,
+	     Rotation rotation,
+	     const float *v,
+	     int nv,
+	     unsigned long arg)
+{
+  uint32_t i = __atomic_fetch_add (&head, 1, __ATOMIC_RELAXED);
+  trace_record *r = &ring[i & (TRACE_SIZE - 1)];
+  struct timespec ts;
+  int k;
+
+  clock_gettime (CLOCK_MONOTONIC, &ts);
+
+  /* Invalid while being written: the fence keeps the fields below
+     from being seen before the invalidation */
+  __atomic_store_n (&r->seq, 0, __ATOMIC_RELAXED);
+  __atomic_thread_fence (__ATOMIC_RELEASE);
+  r->ns = (uint64_t) ts.tv_sec * 1000000000 + ts.tv_nsec;
+  r->xtime = xtime;
+  r->type = type;
+  r->source = source;
+  r->rotation = rotation;
+  r->id[0] = id0;
+  r->id[1] = id1;
+  r->x = x;
+  r->y = y;
+  r->width = width;
+  r->height = height;
+  for (k = 0; k < 6; k++) {
+    r->v[k] = k < nv ? v[k] : 0;
+  }
+  r->arg = arg;
+  __atomic_store_n (&r->seq, i + 1, __ATOMIC_RELEASE);
+}
+
+void
+trace_alignment (const alignment *al)
+{
+  trace_event (TRACE_ALIGN, al->timestamp, al->deviceid, al->crtc,
+	       al->x, al->y, al->width, al->height, al->rotation,
+	       al->matrix, 6, 0);
+}
+
+/* Writes the ring as it is: async-signal-safe */
+static int
+dump_fd (int fd)
+{
+  trace_header h;
+
+  h.magic = TRACE_MAGIC;
+  h.version = TRACE_VERSION;
+  h.size = sizeof (trace_record);
+  h.count = TRACE_SIZE;
+  h.head = __atomic_load_n (&head, __ATOMIC_ACQUIRE);
+  h.pad = 0;
+
+  if (write (fd, &h, sizeof (h)) != sizeof (h) ||
+      write (fd, ring, sizeof (ring)) != sizeof (ring)) {
+    return EXIT_FAILURE;
+  }
+
+  return EXIT_SUCCESS;
+}
+
+int
+trace_dump (const char *path)
+{
+  int fd;
+  int ret;
+
+  fd = open (path, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0600);
+  if (fd < 0) {
+    return EXIT_FAILURE;
+  }
+  ret = dump_fd (fd);
+  if (close (fd) != 0) {
+    ret = EXIT_FAILURE;
+  }
+
+  return ret;
+}
+
+static void
+dump_handler (int sig)
+{
+  int saved = errno;
+
+  trace_dump (dump_path);
+  errno = saved;
+}
+
+/* Dumps the ring and dies of the signal with the default action */
+static void
+crash_handler (int sig)
+{
+  trace_dump (dump_path);
+  raise (sig);
+}
+
+/* Installs the dump handlers once per process. The dump is named
+   after the first display served. */
+void
+trace_install (Display *display)
+{
+  static const int crashes[] = { SIGSEGV, SIGBUS, SIGFPE, SIGILL, SIGABRT };
+  struct sigaction sa;
+  int i;
+
+  if (__atomic_exchange_n (&installed, 1, __ATOMIC_ACQ_REL)) {
+    return;
+  }
+  if (control_path (display, "trace", dump_path, sizeof (dump_path)) == EXIT_FAILURE) {
+    fprintf (stderr, "Unable to locate the trace dump: the trace is not dumped on signals\n");
+    return;
+  }
+
+  memset (&sa, 0, sizeof (sa));
+  sigemptyset (&sa.sa_mask);
+  sa.sa_handler = dump_handler;
+  sa.sa_flags = SA_RESTART;
+  sigaction (SIGUSR2, &sa, NULL);
+
+  sa.sa_handler = crash_handler;
+  sa.sa_flags = SA_RESETHAND;
+  for (i = 0; i < sizeof (crashes) / sizeof (crashes[0]); i++) {
+    sigaction (crashes[i], &sa, NULL);
+  }
+}
+
+/* Copies the valid records of the slots in the order they were made.
+   A record overwritten meanwhile is skipped. */
+static int
+collect (const trace_record *slots,
+	 uint32_t last,
+	 trace_record *out)
+{
+  uint32_t i, start;
+  int n = 0;
+
+  start = last >= TRACE_SIZE ? last - TRACE_SIZE : 0;
+  for (i = start; i != last; i++) {
+    const trace_record *r = &slots[i & (TRACE_SIZE - 1)];
+    if (__atomic_load_n (&r->seq, __ATOMIC_ACQUIRE) != i + 1) {
+      continue;
+    }
+    out[n] = *r;
+    /* The copy is done before the sequence is read again */
+    __atomic_thread_fence (__ATOMIC_ACQUIRE);
+    if (__atomic_load_n (&r->seq, __ATOMIC_RELAXED) == i + 1) {
+      n++;
+    }
+  }
+
+  return n;
+}
+
+static void
+print_records (FILE *out,
+	       const trace_record *recs,
+	       int n)
+{
+  int i, k;
+
+  for (i = 0; i < n; i++) {
+    const trace_record *r = &recs[i];
+
+    fprintf (out, "%12.6f d%u %-13s", (double) (r->ns - recs[0].ns) / 1e9,
+	     (unsigned int) r->source,
+	     r->type < TRACE_TYPES ? type_names[r->type] : "unknown");
+    switch (r->type) {
+    case TRACE_SCREEN_CHANGE:
+      fprintf (out, " root=0x%x %ux%u rot=%u",
+	       r->id[0], r->width, r->height, r->rotation);
+      break;
+    case TRACE_OUTPUT_CHANGE:
+      fprintf (out, " output=%u crtc=%u rot=%u", r->id[0], r->id[1], r->rotation);
+      break;
+    case TRACE_CRTC_CHANGE:
+      fprintf (out, " crtc=%u %ux%u+%i+%i rot=%u",
+	       r->id[0], r->width, r->height, r->x, r->y, r->rotation);
+      break;
+    case TRACE_ALIGN:
+      fprintf (out, " device=%u crtc=%u %ux%u+%i+%i rot=%u matrix=",
+	       r->id[0], r->id[1], r->width, r->height, r->x, r->y, r->rotation);
+      for (k = 0; k < 6; k++) {
+	fprintf (out, "%s%.6f", k ? "," : "", r->v[k]);
+      }
+      break;
+    case TRACE_WRITE_FAILED:
+      fprintf (out, " device=%u", r->id[0]);
+      break;
+    case TRACE_SENSOR:
+      fprintf (out, " g=%.3f,%.3f,%.3f samples=%u rot=%u",
+	       r->v[0], r->v[1], r->v[2], r->arg, r->rotation);
+      break;
+    case TRACE_ROTATE:
+      fprintf (out, " root=0x%x rot=%u->%u", r->id[0], r->arg, r->rotation);
+      break;
+    case TRACE_ROTATE_FAILED:
+      fprintf (out, " root=0x%x rot=%u", r->id[0], r->rotation);
+      break;
+    }
+    if (r->xtime) {
+      fprintf (out, " xtime=%u", r->xtime);
+    }
+    fprintf (out, "\n");
+  }
+}
+
+/* Prints the timeline of the live ring */
+void
+trace_print (FILE *out)
+{
+  trace_record *recs;
+  int n;
+
+  recs = malloc (sizeof (ring));
+  if (!recs) {
+    return;
+  }
+  n = collect (ring, __atomic_load_n (&head, __ATOMIC_ACQUIRE), recs);
+  print_records (out, recs, n);
+  free (recs);
+}
+
+/* Prints the timeline of a dump file */
+int
+trace_decode (const char *path)
+{
+  trace_header h;
+  trace_record *slots, *recs;
+  FILE *f;
+  int ret = EXIT_FAILURE;
+  int n;
+
+  f = fopen (path, "rb");
+  if (!f) {
+    perror (path);
+    return EXIT_FAILURE;
+  }
+
+  if (fread (&h, sizeof (h), 1, f) != 1 ||
+      h.magic != TRACE_MAGIC || h.version != TRACE_VERSION ||
+      h.size != sizeof (trace_record) || h.count != TRACE_SIZE) {
+    fprintf (stderr, "%s: not a trace dump of this version\n", path);
+    fclose (f);
+    return EXIT_FAILURE;
+  }
+
+  slots = malloc (sizeof (ring));
+  recs = malloc (sizeof (ring));
+  if (slots && recs && fread (slots, sizeof (ring), 1, f) == 1) {
+    n = collect (slots, h.head, recs);
+    print_records (stdout, recs, n);
+    ret = EXIT_SUCCESS;
+  } else {
+    fprintf (stderr, "%s: truncated trace dump\n", path);
+  }
+
+  free (slots);
+  free (recs);
+  fclose (f);
+
+  return ret;
+}
+
+/* end of trace.c */
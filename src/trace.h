@@ -0,0 +1,127 @@
+/*
+ * Original xinput:
+ * Copyright 1996 by Frederic Lepied, France. <Frederic.Lepied@sugix.frmug.org>
+ *
+ * Original xrandr:
+ * Copyright © 2001 Keith Packard, member of The XFree86 Project, Inc.
+ * Copyright © 2002 Hewlett Packard Company, Inc.
+ * Copyright © 2006 Intel Corporation
+ *
+ * xrandr-align:
+ *
+ * Copyright © 2012 Paul Wolneykien <manowar@altlinux.org>, ALT Linux Ltd.
+ *
+ * Permission to use, copy, modify, distribute, and sell this software and its
+ * documentation for any purpose is  hereby granted without fee, provided that
+ * the  above copyright   notice appear  in   all  copies and  that both  that
+ * copyright  notice   and   this  permission   notice  appear  in  supporting
+ * documentation, and that   the  name of  the authors  not  be  used  in
+ * advertising or publicity pertaining to distribution of the software without
+ * specific,  written      prior  permission.     The authors  make  no
+ * representations about the suitability of this software for any purpose.  It
+ * is provided "as is" without express or implied warranty.
+ *
+ * THE AUTHORS DISCLAIM ALL   WARRANTIES WITH REGARD  TO  THIS SOFTWARE,
+ * INCLUDING ALL IMPLIED   WARRANTIES OF MERCHANTABILITY  AND   FITNESS, IN NO
+ * EVENT  SHALL THE AUTHORS  BE   LIABLE   FOR ANY  SPECIAL, INDIRECT   OR
+ * CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM LOSS OF USE,
+ * DATA  OR PROFITS, WHETHER  IN  AN ACTION OF  CONTRACT,  NEGLIGENCE OR OTHER
+ * TORTIOUS  ACTION, ARISING    OUT OF OR   IN  CONNECTION  WITH THE USE    OR
+ * PERFORMANCE OF THIS SOFTWARE.
+ *
+ */
+
+/*
+ * Binary trace ring.
+ *
+ * The daemons record what they do (the RandR events, the matrices
+ * written, the sensor decisions, the rotations and the failures) in
+ * a fixed-size in-memory ring of compact records. Recording is always
+ * on: a record costs a clock read, an atomic increment and a 64 byte
+ * store, with no formatting and no I/O. The ring is written out on
+ * SIGUSR2 and on a crash to $XDG_RUNTIME_DIR/xrandr-align/trace-DISPLAY
+ * and decoded into a timeline with "xrandr-align trace-decode FILE".
+ * The trace-dump control command prints the timeline of a running
+ * daemon. The ring is shared by the threads of the process; each
+ * record is tagged with the display of the thread.
+ */
+
+#include <stdint.h>
+
+/* The ring capacity in records, a power of two */
+#define TRACE_SIZE 4096
+
+#define TRACE_MAGIC	0x54415258	/* "XRAT" */
+#define TRACE_VERSION	1
+
+typedef enum
+{
+  TRACE_NONE,
+  TRACE_SCREEN_CHANGE,	/* id: root; geometry, rotation */
+  TRACE_OUTPUT_CHANGE,	/* id: output, CRTC; rotation */
+  TRACE_CRTC_CHANGE,	/* id: CRTC; geometry, rotation */
+  TRACE_ALIGN,		/* id: device, CRTC; geometry, rotation, matrix */
+  TRACE_WRITE_FAILED,	/* id: device */
+  TRACE_SENSOR,		/* arg: samples; v: gravity; rotation: decision */
+  TRACE_ROTATE,		/* id: root; arg: previous rotation; rotation */
+  TRACE_ROTATE_FAILED,	/* id: root; rotation */
+  TRACE_TYPES
+} trace_type;
+
+typedef struct
+{
+  uint64_t ns;		/* CLOCK_MONOTONIC */
+  uint32_t seq;		/* the record number + 1, written last */
+  uint32_t xtime;	/* the X server time, 0 if none */
+  uint16_t type;
+  uint8_t source;	/* the display of the thread */
+  uint8_t rotation;
+  uint32_t id[2];
+  int16_t x, y;
+  uint16_t width, height;
+  float v[6];		/* the matrix (the last row is 0 0 1) */
+  uint32_t arg;
+} trace_record;
+
+/* The dump file: the header and the slots of the ring as they are */
+typedef struct
+{
+  uint32_t magic;
+  uint32_t version;
+  uint32_t size;	/* of a record */
+  uint32_t count;	/* of the slots */
+  uint32_t head;	/* the records ever made */
+  uint32_t pad;
+} trace_header;
+
+void
+trace_install (Display *display);
+
+void
+trace_set_source (int source);
+
+void
+trace_event (trace_type type,
+	     Time xtime,
+	     XID id0,
+	     XID id1,
+	     int x,
+	     int y,
+	     unsigned int width,
+	     unsigned int height,
+	     Rotation rotation,
+	     const float *v,
+	     int nv,
+	     unsigned long arg);
+
+void
+trace_alignment (const alignment *al);
+
+int
+trace_dump (const char *path);
+
+void
+trace_print (FILE *out);
+
+int
+trace_decode (const char *path);
@@ -0,0 +1,183 @@
+/*
+ * Original xinput:
+ * Copyright 1996 by Frederic Lepied, France. <Frederic.Lepied@sugix.frmug.org>
+ *
+ * Original xrandr:
+ * Copyright © 2001 Keith Packard, member of The XFree86 Project, Inc.
+ * Copyright © 2002 Hewlett Packard Company, Inc.
+ * Copyright © 2006 Intel Corporation
+ *
+ * xrandr-align:
+ *
+ * Copyright © 2012 Paul Wolneykien <manowar@altlinux.org>, ALT Linux Ltd.
+ *
+ * Permission to use, copy, modify, distribute, and sell this software and its
+ * documentation for any purpose is  hereby granted without fee, provided that
+ * the  above copyright   notice appear  in   all  copies and  that both  that
+ * copyright  notice   and   this  permission   notice  appear  in  supporting
+ * documentation, and that   the  name of  the authors  not  be  used  in
+ * advertising or publicity pertaining to distribution of the software without
+ * specific,  written      prior  permission.     The authors  make  no
+ * representations about the suitability of this software for any purpose.  It
+ * is provided "as is" without express or implied warranty.
+ *
+ * THE AUTHORS DISCLAIM ALL   WARRANTIES WITH REGARD  TO  THIS SOFTWARE,
+ * INCLUDING ALL IMPLIED   WARRANTIES OF MERCHANTABILITY  AND   FITNESS, IN NO
+ * EVENT  SHALL THE AUTHORS  BE   LIABLE   FOR ANY  SPECIAL, INDIRECT   OR
+ * CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM LOSS OF USE,
+ * DATA  OR PROFITS, WHETHER  IN  AN ACTION OF  CONTRACT,  NEGLIGENCE OR OTHER
+ * TORTIOUS  ACTION, ARISING    OUT OF OR   IN  CONNECTION  WITH THE USE    OR
+ * PERFORMANCE OF THIS SOFTWARE.
+ *
+ */
+
+#include "common.h"
+#include "xrandr-align.h"
+#include "transform.h"
+#include <string.h>
+
+/* The rotation in the normalized CRTC space:
+ *
+ *   | C  -S  H |
+ *   | S   C  V |
+ *
+ * followed by the reflections x' = 1 - x (RX) and y' = 1 - y (RY).
+ */
+#define A00(C, S, H, V, RX, RY) ((RX) ? -(C) : (C))
+#define A01(C, S, H, V, RX, RY) ((RX) ? (S) : -(S))
+#define A02(C, S, H, V, RX, RY) ((RX) ? 1 - (H) : (H))
+#define A10(C, S, H, V, RX, RY) ((RY) ? -(S) : (S))
+#define A11(C, S, H, V, RX, RY) ((RY) ? -(C) : (C))
+#define A12(C, S, H, V, RX, RY) ((RY) ? 1 - (V) : (V))
+
+#define KERNEL(name, C, S, H, V, RX, RY)				\
+static void								\
+name##_id (const transform_geometry *g,					\
+	   float m[9])							\
+{									\
+  m[0] = A00 (C, S, H, V, RX, RY) * g->hscale;				\
+  m[1] = A01 (C, S, H, V, RX, RY) * g->hscale;				\
+  m[2] = A02 (C, S, H, V, RX, RY) * g->hscale + g->xoffs;		\
+  m[3] = A10 (C, S, H, V, RX, RY) * g->vscale;				\
+  m[4] = A11 (C, S, H, V, RX, RY) * g->vscale;				\
+  m[5] = A12 (C, S, H, V, RX, RY) * g->vscale + g->yoffs;		\
+  m[6] = 0;								\
+  m[7] = 0;								\
+  m[8] = 1;								\
+}									\
+									\
+static void								\
+name##_mx (const transform_geometry *g,					\
+	   float m[9])							\
+{									\
+  const double a00 = A00 (C, S, H, V, RX, RY) * g->hscale;		\
+  const double a01 = A01 (C, S, H, V, RX, RY) * g->hscale;		\
+  const double a02 = A02 (C, S, H, V, RX, RY) * g->hscale + g->xoffs;	\
+  const double a10 = A10 (C, S, H, V, RX, RY) * g->vscale;		\
+  const double a11 = A11 (C, S, H, V, RX, RY) * g->vscale;		\
+  const double a12 = A12 (C, S, H, V, RX, RY) * g->vscale + g->yoffs;	\
+  int i;								\
+									\
+  for (i = 0; i < 3; i++) {						\
+    m[i] = a00 * g->mx[0][i] + a01 * g->mx[1][i] + a02 * g->mx[2][i];	\
+    m[i + 3] = a10 * g->mx[0][i] + a11 * g->mx[1][i] + a12 * g->mx[2][i]; \
+    m[i + 6] = g->mx[2][i];						\
+  }									\
+}
+
+#define KERNELS(name, C, S, H, V)		\
+  KERNEL (name, C, S, H, V, 0, 0)		\
+  KERNEL (name##_rx, C, S, H, V, 1, 0)		\
+  KERNEL (name##_ry, C, S, H, V, 0, 1)		\
+  KERNEL (name##_rxy, C, S, H, V, 1, 1)
+
+KERNELS (rot0, 1, 0, 0, 0)
+KERNELS (rot90, 0, 1, 1, 0)
+KERNELS (rot180, -1, 0, 1, 1)
+KERNELS (rot270, 0, -1, 0, 1)
+
+#define KERNEL_ROW(name)					\
+  { { name##_id, name##_mx }, { name##_rx_id, name##_rx_mx },	\
+    { name##_ry_id, name##_ry_mx }, { name##_rxy_id, name##_rxy_mx } }
+
+/* By the rotation, the reflection (RR_Reflect_X and RR_Reflect_Y bits)
+   and the CRTC transform (identity or not) */
+static const transform_kernel kernels[4][4][2] =
+{
+  KERNEL_ROW (rot0),
+  KERNEL_ROW (rot90),
+  KERNEL_ROW (rot180),
+  KERNEL_ROW (rot270)
+};
+
+/* The index of a single rotation bit, -1 if not a single one */
+static int
+rotation_index (Rotation rotation)
+{
+  switch (rotation & 0x0f) {
+  case RR_Rotate_0:
+    return 0;
+  case RR_Rotate_90:
+    return 1;
+  case RR_Rotate_180:
+    return 2;
+  case RR_Rotate_270:
+    return 3;
+  }
+
+  return -1;
+}
+
+/* Computes the geometry of the CRTC on the screen and selects the
+   kernel for it */
+int
+transform_geometry_init (transform_geometry *g,
+			 Rotation screen_rotation,
+			 int screen_width,
+			 int screen_height,
+			 const XRRCrtcInfo *crtc,
+			 const XTransform *current)
+{
+  int srot = rotation_index (screen_rotation);
+  int rot = rotation_index (crtc->rotation);
+  int identity = 1;
+  int i, j;
+
+  if (srot < 0) {
+    fprintf (stderr, "The screen rotation/reflection 0x%02x is not supported yet. Sorry.\n", screen_rotation);
+    return EXIT_FAILURE;
+  }
+  if (rot < 0) {
+    fprintf (stderr, "The rotation/reflection 0x%02x is not supported yet. Sorry.\n", crtc->rotation);
+    return EXIT_FAILURE;
+  }
+
+  /* The screen sizes are listed unrotated */
+  if (srot & 1) {
+    int w = screen_width;
+    screen_width = screen_height;
+    screen_height = w;
+  }
+
+  g->hscale = (double) crtc->width / screen_width;
+  g->vscale = (double) crtc->height / screen_height;
+  g->xoffs = (double) crtc->x / screen_width;
+  g->yoffs = (double) crtc->y / screen_height;
+
+  for (j = 0; j < 3; j++) {
+    for (i = 0; i < 3; i++) {
+      g->mx[j][i] = XFixedToDouble (current->matrix[j][i]);
+      if (current->matrix[j][i] != (i == j ? XDoubleToFixed (1) : 0)) {
+	identity = 0;
+      }
+    }
+  }
+
+  g->kernel = kernels[rot]
+    [((crtc->rotation & RR_Reflect_X) ? 1 : 0) + ((crtc->rotation & RR_Reflect_Y) ? 2 : 0)]
+    [identity ? 0 : 1];
+
+  return EXIT_SUCCESS;
+}
+
+/* end of transform.c */
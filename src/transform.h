@@ -0,0 +1,70 @@
+/*
+ * Original xinput:
+ * Copyright 1996 by Frederic Lepied, France. <Frederic.Lepied@sugix.frmug.org>
+ *
+ * Original xrandr:
+ * Copyright © 2001 Keith Packard, member of The XFree86 Project, Inc.
+ * Copyright © 2002 Hewlett Packard Company, Inc.
+ * Copyright © 2006 Intel Corporation
+ *
+ * xrandr-align:
+ *
+ * Copyright © 2012 Paul Wolneykien <manowar@altlinux.org>, ALT Linux Ltd.
+ *
+ * Permission to use, copy, modify, distribute, and sell this software and its
+ * documentation for any purpose is  hereby granted without fee, provided that
+ * the  above copyright   notice appear  in   all  copies and  that both  that
+ * copyright  notice   and   this  permission   notice  appear  in  supporting
+ * documentation, and that   the  name of  the authors  not  be  used  in
+ * advertising or publicity pertaining to distribution of the software without
+ * specific,  written      prior  permission.     The authors  make  no
+ * representations about the suitability of this software for any purpose.  It
+ * is provided "as is" without express or implied warranty.
+ *
+ * THE AUTHORS DISCLAIM ALL   WARRANTIES WITH REGARD  TO  THIS SOFTWARE,
+ * INCLUDING ALL IMPLIED   WARRANTIES OF MERCHANTABILITY  AND   FITNESS, IN NO
+ * EVENT  SHALL THE AUTHORS  BE   LIABLE   FOR ANY  SPECIAL, INDIRECT   OR
+ * CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM LOSS OF USE,
+ * DATA  OR PROFITS, WHETHER  IN  AN ACTION OF  CONTRACT,  NEGLIGENCE OR OTHER
+ * TORTIOUS  ACTION, ARISING    OUT OF OR   IN  CONNECTION  WITH THE USE    OR
+ * PERFORMANCE OF THIS SOFTWARE.
+ *
+ */
+
+/*
+ * Coordinate transformation matrix kernels.
+ *
+ * The matrix of an input bound to a CRTC maps the normalized device
+ * coordinates to the normalized screen ones: the CRTC rotation, then
+ * its reflection (taken in the screen space, as RandR does), the
+ * scale and the offset of the CRTC on the screen and finally the
+ * current CRTC transform. The rotation and reflection coefficients
+ * are all -1, 0 or 1, so there is a kernel specialized at compile
+ * time for each of the 4 rotations x 4 reflections, in two variants:
+ * for the identity CRTC transform (the common case, a few multiply-
+ * adds) and for any other one. The kernel is selected from the table
+ * once per geometry.
+ */
+
+typedef struct transform_geometry transform_geometry;
+
+typedef void (*transform_kernel) (const transform_geometry *g,
+				  float matrix[9]);
+
+struct transform_geometry
+{
+  double hscale, vscale;	/* the CRTC size relative to the screen */
+  double xoffs, yoffs;		/* the CRTC position relative to the screen */
+  double mx[3][3];		/* the current CRTC transform */
+  transform_kernel kernel;
+};
+
+int
+transform_geometry_init (transform_geometry *g,
+			 Rotation screen_rotation,
+			 int screen_width,
+			 int screen_height,
+			 const XRRCrtcInfo *crtc,
+			 const XTransform *current);
+
+#define transform_matrix(g, matrix) ((g)->kernel ((g), (matrix)))
@@ -0,0 +1,253 @@
+/*
+ * Original xinput:
+ * Copyright 1996 by Frederic Lepied, France. <Frederic.Lepied@sugix.frmug.org>
+ *
+ * Original xrandr:
+ * Copyright © 2001 Keith Packard, member of The XFree86 Project, Inc.
+ * Copyright © 2002 Hewlett Packard Company, Inc.
+ * Copyright © 2006 Intel Corporation
+ *
+ * xrandr-align:
+ *
+ * Copyright © 2012 Paul Wolneykien <manowar@altlinux.org>, ALT Linux Ltd.
+ *
+ * Permission to use, copy, modify, distribute, and sell this software and its
+ * documentation for any purpose is  hereby granted without fee, provided that
+ * the  above copyright   notice appear  in   all  copies and  that both  that
+ * copyright  notice   and   this  permission   notice  appear  in  supporting
+ * documentation, and that   the  name of  the authors  not  be  used  in
+ * advertising or publicity pertaining to distribution of the software without
+ * specific,  written      prior  permission.     The authors  make  no
+ * representations about the suitability of this software for any purpose.  It
+ * is provided "as is" without express or implied warranty.
+ *
+ * THE AUTHORS DISCLAIM ALL   WARRANTIES WITH REGARD  TO  THIS SOFTWARE,
+ * INCLUDING ALL IMPLIED   WARRANTIES OF MERCHANTABILITY  AND   FITNESS, IN NO
+ * EVENT  SHALL THE AUTHORS  BE   LIABLE   FOR ANY  SPECIAL, INDIRECT   OR
+ * CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM LOSS OF USE,
+ * DATA  OR PROFITS, WHETHER  IN  AN ACTION OF  CONTRACT,  NEGLIGENCE OR OTHER
+ * TORTIOUS  ACTION, ARISING    OUT OF OR   IN  CONNECTION  WITH THE USE    OR
+ * PERFORMANCE OF THIS SOFTWARE.
+ *
+ */
+
+#include "common.h"
+#include "xrandr-align.h"
+#include "xerror.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <pthread.h>
+
+typedef struct
+{
+  Display *display;
+  unsigned long serial;
+  XID deviceid;		/* None to absorb the error quietly */
+  int error_code;	/* Success if none so far */
+} tracked_request;
+
+/* A FIFO of the tracked requests in the serial order. The handler is
+   process wide and may be called on another connection by another
+   thread, hence the lock. */
+static tracked_request *tracked = NULL;
+static int size = 0;
+static int first = 0;
+static int count = 0;
+static pthread_mutex_t lock = PTHREAD_MUTEX_INITIALIZER;
+
+/* The errors received by each connection */
+typedef struct
+{
+  Display *display;
+  unsigned long errors;
+} connection_errors;
+
+static connection_errors counted[XERROR_DISPLAYS_MAX];
+static int ncounted = 0;
+
+/* Counts the error and matches it to the tracked request it is about.
+   Returns 1 if it is one of them: the failure is then picked up by
+   xerror_failed (). For an error handler of its own, such as the one
+   of a program using the library. */
+int
+xerror_match (Display *display,
+	      XErrorEvent *error)
+{
+  int matched = 0;
+  int i;
+
+  pthread_mutex_lock (&lock);
+  for (i = 0; i < ncounted; i++) {
+    if (counted[i].display == display) {
+      break;
+    }
+  }
+  if (i == ncounted && ncounted < XERROR_DISPLAYS_MAX) {
+    counted[ncounted++].display = display;
+  }
+  if (i < ncounted) {
+    counted[i].errors++;
+  }
+
+  for (i = 0; i < count; i++) {
+    tracked_request *t = &tracked[(first + i) % size];
+    if (t->display == display && t->serial == error->serial) {
+      t->error_code = error->error_code;
+      matched = 1;
+      break;
+    }
+  }
+  pthread_mutex_unlock (&lock);
+
+  return matched;
+}
+
+static int
+xerror_handler (Display *display,
+		XErrorEvent *error)
+{
+  char text[128];
+
+  if (!xerror_match (display, error)) {
+    XGetErrorText (display, error->error_code, text, sizeof (text));
+    fprintf (stderr, "X error: %s (request %u.%u, serial %lu)\n", text,
+	     (unsigned int) error->request_code,
+	     (unsigned int) error->minor_code, error->serial);
+  }
+
+  return 0;
+}
+
+void
+xerror_install (void)
+{
+  XSetErrorHandler (xerror_handler);
+}
+
+/* Drops the requests of the connection the server processed without
+   an error, keeping the others in order. Called with the lock held by
+   the thread of the connection. */
+static void
+retire_succeeded (Display *display)
+{
+  unsigned long processed = LastKnownRequestProcessed (display);
+  int i, k;
+
+  for (i = 0, k = 0; i < count; i++) {
+    tracked_request *t = &tracked[(first + i) % size];
+    if (t->display == display && t->serial <= processed &&
+	t->error_code == Success) {
+      continue;
+    }
+    tracked[(first + k++) % size] = *t;
+  }
+  count = k;
+}
+
+/* Doubles the FIFO, unrolled from the first request */
+static int
+grow (void)
+{
+  tracked_request *bigger;
+  int newsize = size ? 2 * size : XERROR_TRACK_MAX;
+  int i;
+
+  bigger = malloc (newsize * sizeof (tracked_request));
+  if (!bigger) {
+    return EXIT_FAILURE;
+  }
+  for (i = 0; i < count; i++) {
+    bigger[i] = tracked[(first + i) % size];
+  }
+  free (tracked);
+  tracked = bigger;
+  size = newsize;
+  first = 0;
+
+  return EXIT_SUCCESS;
+}
+
+/* Notes the request issued with the serial (NextRequest () taken
+   before the call) as a write to the device */
+void
+xerror_track (Display *display,
+	      unsigned long serial,
+	      XID deviceid)
+{
+  tracked_request *t;
+
+  pthread_mutex_lock (&lock);
+  if (count == size) {
+    retire_succeeded (display);
+  }
+  if (count == size && grow () == EXIT_FAILURE) {
+    if (size == 0) {
+      pthread_mutex_unlock (&lock);
+      return;
+    }
+    fprintf (stderr, "Unable to track more X requests: the oldest is forgotten\n");
+    first = (first + 1) % size;
+    count--;
+  }
+  t = &tracked[(first + count) % size];
+  t->display = display;
+  t->serial = serial;
+  t->deviceid = deviceid;
+  t->error_code = Success;
+  count++;
+  pthread_mutex_unlock (&lock);
+}
+
+/* Retires the tracked requests already processed by the server and
+   returns the devices of the failed ones (up to max, the others are
+   kept for the next call) */
+int
+xerror_failed (Display *display,
+	       XID *deviceids,
+	       int max)
+{
+  unsigned long processed = LastKnownRequestProcessed (display);
+  int n = 0;
+  int i, k;
+
+  pthread_mutex_lock (&lock);
+  for (i = 0, k = 0; i < count; i++) {
+    tracked_request *t = &tracked[(first + i) % size];
+    if (t->display == display && t->serial <= processed) {
+      if (t->error_code == Success || t->deviceid == None) {
+	continue;
+      }
+      if (n < max) {
+	deviceids[n++] = t->deviceid;
+	continue;
+      }
+    }
+    /* Keep the others in order */
+    tracked[(first + k++) % size] = *t;
+  }
+  count = k;
+  pthread_mutex_unlock (&lock);
+
+  return n;
+}
+
+/* Returns the errors received by the connection so far */
+unsigned long
+xerror_count (Display *display)
+{
+  unsigned long n = 0;
+  int i;
+
+  pthread_mutex_lock (&lock);
+  for (i = 0; i < ncounted; i++) {
+    if (counted[i].display == display) {
+      n = counted[i].errors;
+      break;
+    }
+  }
+  pthread_mutex_unlock (&lock);
+
+  return n;
+}
+
+/* end of xerror.c */
@@ -0,0 +1,74 @@
+/*
+ * Original xinput:
+ * Copyright 1996 by Frederic Lepied, France. <Frederic.Lepied@sugix.frmug.org>
+ *
+ * Original xrandr:
+ * Copyright © 2001 Keith Packard, member of The XFree86 Project, Inc.
+ * Copyright © 2002 Hewlett Packard Company, Inc.
+ * Copyright © 2006 Intel Corporation
+ *
+ * xrandr-align:
+ *
+ * Copyright © 2012 Paul Wolneykien <manowar@altlinux.org>, ALT Linux Ltd.
+ *
+ * Permission to use, copy, modify, distribute, and sell this software and its
+ * documentation for any purpose is  hereby granted without fee, provided that
+ * the  above copyright   notice appear  in   all  copies and  that both  that
+ * copyright  notice   and   this  permission   notice  appear  in  supporting
+ * documentation, and that   the  name of  the authors  not  be  used  in
+ * advertising or publicity pertaining to distribution of the software without
+ * specific,  written      prior  permission.     The authors  make  no
+ * representations about the suitability of this software for any purpose.  It
+ * is provided "as is" without express or implied warranty.
+ *
+ * THE AUTHORS DISCLAIM ALL   WARRANTIES WITH REGARD  TO  THIS SOFTWARE,
+ * INCLUDING ALL IMPLIED   WARRANTIES OF MERCHANTABILITY  AND   FITNESS, IN NO
+ * EVENT  SHALL THE AUTHORS  BE   LIABLE   FOR ANY  SPECIAL, INDIRECT   OR
+ * CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM LOSS OF USE,
+ * DATA  OR PROFITS, WHETHER  IN  AN ACTION OF  CONTRACT,  NEGLIGENCE OR OTHER
+ * TORTIOUS  ACTION, ARISING    OUT OF OR   IN  CONNECTION  WITH THE USE    OR
+ * PERFORMANCE OF THIS SOFTWARE.
+ *
+ */
+
+/*
+ * Asynchronous X error tracking.
+ *
+ * The default Xlib error handler exits on any error, so a property
+ * write to a device unplugged meanwhile would kill a daemon, and the
+ * only way to check a write would be a round trip. Instead the
+ * request serials of the writes are noted and the errors reported
+ * asynchronously are matched back to them: the writes stay fire-and-
+ * forget while the failed ones are picked up later by the device ID
+ * and retried. Errors of the requests not tracked are printed.
+ */
+
+/* The writes awaiting the server tracked initially. When the FIFO is
+   full the requests of the connection already processed without an
+   error are retired, and it grows if they are all pending: no write
+   is forgotten. */
+#define XERROR_TRACK_MAX 128
+
+/* The connections whose errors are counted apart at most, as many as
+   the displays served by a process */
+#define XERROR_DISPLAYS_MAX 1024
+
+void
+xerror_install (void);
+
+int
+xerror_match (Display *display,
+	      XErrorEvent *error);
+
+void
+xerror_track (Display *display,
+	      unsigned long serial,
+	      XID deviceid);
+
+int
+xerror_failed (Display *display,
+	       XID *deviceids,
+	       int max);
+
+unsigned long
+xerror_count (Display *display);
@@ -31,15 +31,18 @@
  *
  */
 
+#include "common.h"
 #include "xrandr-align.h"
+#include "profile.h"
+#include "control.h"
+#include "xerror.h"
+#include "trace.h"
 #include <ctype.h>
 #include <string.h>
+#include <limits.h>
+#include <pthread.h>
 
-int xi_opcode;
-int verbose = 0;
-
-typedef int (*prog)(Display* display, int argc, const char *argv[],
-		    const char *prog_name, const char *prog_desc);
+typedef int (*prog)(context *ctx);
 
 typedef struct
 {
@@ -59,17 +62,27 @@ static entry drivers[] =
      list_output
     },
     {"[align]",
-     "[--screen=INT] [--input=INDEV] [--output=OUTDEV] [--pre-script=PRE] [--post-script=POST]",
+     "[--screen=INT] [--input=INDEV] [--output=OUTDEV]... [--all --config=FILE | --auto] [--pre-script=PRE] [--post-script=POST] [--calibration=FILE]",
      align
     },
     {"monitor",
-     "[--screen=INT] [--input=INDEV] [--output=OUTDEV] [--pre-script=PRE] [--post-script=POST]",
+     "[--screen=INT|all] [--input=INDEV] [--output=OUTDEV]... [--all --config=FILE | --auto] [--pre-script=PRE] [--post-script=POST] [--calibration=FILE] [--state=FILE | --no-state] [--control=PATH | --no-control] [--name=NAME] [--mlock] [--sched-fifo=PRIO] [--cpus=LIST] [--metrics-dir=DIR [--metrics-interval=SECONDS] [--metrics-name=NAME]]",
      monitor
     },
     {"gravitate",
-     "[--screen=INT] [--input=INDEV] [--ratio=FLOAT] [--threshold=FLOAT]",
+     "[--screen=INT] [--input=INDEV] [--output=OUTDEV]... [--ratio=FLOAT] [--threshold=FLOAT | --range-threshold=FRACTION] [--flat=DEGREES] [--axes=MAP] [--reduce=latest|mean|filter] [--rotations=LIST] [--docked=ROTATION] [--tablet-switch=DEVICE|auto|none] [--no-float] [--calibration=FILE] [--control=PATH | --no-control] [--name=NAME] [--mlock] [--sched-fifo=PRIO] [--cpus=LIST] [--metrics-dir=DIR [--metrics-interval=SECONDS] [--metrics-name=NAME]]",
      gravitate
     },
+#if HAVE_XI2
+    {"calibrate",
+     "[--screen=INT] [--input=INDEV] [--output=OUTDEV] [--points=N] [--calibration=FILE]",
+     calibrate
+    },
+#endif
+    {"control",
+     "[--daemon=monitor|gravitate] [--control=PATH | --name=NAME] COMMAND [ARG]...",
+     control
+    },
     {NULL, NULL, NULL
     }
 };
@@ -127,237 +140,181 @@ print_version()
     return 1;
 }
 
-int
-xinput_version(Display	*display)
+static void
+usage(void)
 {
-    XExtensionVersion	*version;
-    static int vers = -1;
-
-    if (vers != -1)
-        return vers;
+    entry	*pdriver = drivers;
 
-    version = XGetExtensionVersion(display, INAME);
+    fprintf(stderr, "usage txrandr-align [ -v | --verbose ] [ --profile-x ] [ --display=DISPLAY[,DISPLAY]... ]... [function-name]:\n");
 
-    if (version && (version != (XExtensionVersion*) NoSuchExtension)) {
-	vers = version->major_version;
-	XFree(version);
+    fprintf(stderr, "\txrandr-align version\n");
+    fprintf(stderr, "\txrandr-align trace-decode FILE\n");
+    while(pdriver->func_name) {
+	fprintf(stderr, "\txrandr-align %s %s\n", pdriver->func_name,
+		pdriver->arg_desc);
+	pdriver++;
     }
-
-    return vers;
 }
 
-#if HAVE_XI2
-int
-check_xi2 (Display *display)
-{
-    int major = XI_2_Major, minor = XI_2_Minor;
+/* The displays served concurrently, one thread each */
+#define MAX_DISPLAYS 1024
 
-    return xinput_version(display) == XI_2_Major &&
-	   XIQueryVersion(display, &major, &minor) == Success &&
-	   (major * 1000 + minor) >= (XI_2_Major * 1000 + XI_2_Minor);
-}
-#endif
+/* The stack of a display thread: the functions keep their data on
+   the heap, so a small one bounds the memory of many displays */
+#define DISPLAY_STACK_SIZE (256 * 1024)
 
-int check_valuator (XDeviceInfo *info,
-		    unsigned char mode,
-		    unsigned char min_axes,
-		    Bool axes_signed)
+typedef struct
 {
-    XAnyClassPtr any;
-    XValuatorInfoPtr v;
-    XAxisInfoPtr a;
-    int i, j;
-
-    if (info->num_classes > 0) {
-        any = (XAnyClassPtr) (info->inputclassinfo);
-	for (i = 0; i < info->num_classes; i++) {
-	    if (any->class == ValuatorClass) {
-		v = (XValuatorInfoPtr) any;
-		if (mode && v->mode != mode) {
-		    continue;
-		}
-		if (min_axes && v->num_axes < min_axes) {
-		    continue;
-		}
-
-		if (axes_signed) {
-		    a = (XAxisInfoPtr) ((char *) v + sizeof (XValuatorInfo));
-		    for (j = 0; j < v->num_axes; j++) {
-		        if (a->min_value >= 0) {
-			    break;
-			}
-			a++;
-		    }
-		    if (j < v->num_axes) {
-		        continue;
-		    }
-		}
-
-		return 1;
-	    }
-	    any = (XAnyClassPtr) ((char *) any + any->length);
-	}
-    }
+    const entry *driver;
+    const char *func;
+    const char *name;	/* NULL for the default display */
+    int index;
+    int verbose;
+    int argc;
+    const char **argv;
+    int ret;
+    pthread_t thread;
+} display_job;
+
+/* Connects to the display and runs the function on it */
+static int
+run_display(const entry *driver, const char *func, const char *name,
+	    int verbose, int argc, const char **argv)
+{
+    context	ctx;
 
-    return 0;
-}
+    memset(&ctx, 0, sizeof (ctx));
+    ctx.verbose = verbose;
+    ctx.display = XOpenDisplay(name);
 
-XDeviceInfo*
-find_device_info_ext (Display		*display,
-		      const char    	*name,
-		      Bool		only_extended,
-		      unsigned char	mode,
-		      unsigned char	min_axes,
-		      Bool		axes_signed)
-{
-    XDeviceInfo	*devices;
-    XDeviceInfo *found = NULL;
-    int		loop;
-    int		num_devices;
-    int		len = strlen(name);
-    Bool	is_id = True;
-    XID		id = (XID)-1;
-
-    for(loop=0; loop<len; loop++) {
-	if (!isdigit(name[loop])) {
-	    is_id = False;
-	    break;
-	}
+    if (ctx.display == NULL) {
+	fprintf(stderr, "Unable to connect to X server %s\n", XDisplayName(name));
+	return EXIT_FAILURE;
     }
 
-    if (is_id) {
-	id = atoi(name);
+    xprof_init(ctx.display);
+
+    if (connection_init(&ctx.conn, ctx.display) == EXIT_FAILURE) {
+        XCloseDisplay(ctx.display);
+        return EXIT_FAILURE;
     }
 
-    devices = XListInputDevices(display, &num_devices);
-
-    for(loop=0; loop<num_devices; loop++) {
-	if ((!only_extended || (devices[loop].use >= IsXExtensionDevice)) &&
-	    ((!is_id && strcmp(devices[loop].name, name) == 0) ||
-	     (is_id && devices[loop].id == id))) {
-	    if ((mode || min_axes) && \
-		! check_valuator (&devices[loop], mode, min_axes, axes_signed)) {
-	        continue;
-	    }
-	    if (found) {
-	        fprintf(stderr,
-	                "Warning: There are multiple devices named \"%s\".\n"
-	                "To ensure the correct one is selected, please use "
-	                "the device ID instead.\n\n", name);
-		return NULL;
-	    } else {
-		found = &devices[loop];
-	    }
-	}
+    /* The options are parsed once and passed to the function with
+       the connection context */
+    if (parse_options(ctx.display, argc, argv,
+		      driver->func_name, driver->arg_desc, &ctx.opts) == EXIT_SUCCESS) {
+	int r = (*driver->func)(&ctx);
+	XPROF(ctx.display, "XSync", XSync(ctx.display, False));
+	xprof_report(func);
+	free_calibration(&ctx.cal);
+	free_options(&ctx.opts);
+	connection_close(&ctx.conn);
+	XCloseDisplay(ctx.display);
+	return r;
     }
-    return found;
-}
 
-XDeviceInfo*
-find_device_info(Display	*display,
-		 const char    	*name,
-		 Bool		only_extended)
-{
-    return find_device_info_ext (display, name, only_extended, 0, 0, 0);
-}
+    connection_close(&ctx.conn);
+    XCloseDisplay(ctx.display);
 
-#ifdef HAVE_XI2
-Bool is_pointer(int use)
-{
-    return use == XIMasterPointer || use == XISlavePointer;
-}
+    usage();
 
-Bool is_keyboard(int use)
-{
-    return use == XIMasterKeyboard || use == XISlaveKeyboard;
+    return EXIT_FAILURE;
 }
 
-Bool device_matches(XIDeviceInfo *info, const char *name)
+static void *
+display_main(void *arg)
 {
-    if (strcmp(info->name, name) == 0) {
-        return True;
-    }
-
-    if (strncmp(name, "pointer:", strlen("pointer:")) == 0 &&
-        strcmp(info->name, name + strlen("pointer:")) == 0 &&
-        is_pointer(info->use)) {
-        return True;
-    }
+    display_job *job = arg;
 
-    if (strncmp(name, "keyboard:", strlen("keyboard:")) == 0 &&
-        strcmp(info->name, name + strlen("keyboard:")) == 0 &&
-        is_keyboard(info->use)) {
-        return True;
+    trace_set_source(job->index);
+    job->ret = run_display(job->driver, job->func, job->name, job->verbose,
+			   job->argc, job->argv);
+    if (job->ret == EXIT_FAILURE) {
+	fprintf(stderr, "%s failed on %s\n", job->func, job->name);
     }
 
-    return False;
+    return NULL;
 }
 
-XIDeviceInfo*
-xi2_find_device_info(Display *display, const char *name)
+/* Runs the function on each display in a thread of its own. Each
+   thread has its own connection, caches and control socket. */
+static int
+run_displays(const entry *driver, const char *func, const char **names,
+	     int count, int verbose, int argc, const char **argv)
 {
-    XIDeviceInfo *info;
-    XIDeviceInfo *found = NULL;
-    int ndevices;
-    Bool is_id = True;
-    int i, id = -1;
-
-    for(i = 0; i < strlen(name); i++) {
-	if (!isdigit(name[i])) {
-	    is_id = False;
-	    break;
-	}
+    display_job *jobs;
+    pthread_attr_t attr;
+    size_t stack = DISPLAY_STACK_SIZE;
+    int ret = EXIT_SUCCESS;
+    int i, started;
+
+    if (!XInitThreads()) {
+	fprintf(stderr, "Unable to initialize the X threads\n");
+	return EXIT_FAILURE;
     }
 
-    if (is_id) {
-	id = atoi(name);
+    jobs = calloc(count, sizeof (display_job));
+    pthread_attr_init(&attr);
+    if (stack < PTHREAD_STACK_MIN) {
+	stack = PTHREAD_STACK_MIN;
     }
+    pthread_attr_setstacksize(&attr, stack);
+
+    for (started = 0; started < count; started++) {
+	display_job *job = &jobs[started];
+
+	job->driver = driver;
+	job->func = func;
+	job->name = names[started];
+	job->index = started;
+	job->verbose = verbose;
+	job->argc = argc;
+	job->argv = argv;
+	if (pthread_create(&job->thread, &attr, display_main, job) != 0) {
+	    fprintf(stderr, "Unable to start the thread of %s\n", job->name);
+	    ret = EXIT_FAILURE;
+	    break;
+	}
+    }
+    pthread_attr_destroy(&attr);
 
-    info = XIQueryDevice(display, XIAllDevices, &ndevices);
-    for(i = 0; i < ndevices; i++)
-    {
-        if (is_id ? info[i].deviceid == id : device_matches (&info[i], name)) {
-            if (found) {
-                fprintf(stderr,
-                        "Warning: There are multiple devices matching '%s'.\n"
-                        "To ensure the correct one is selected, please use "
-                        "the device ID, or prefix the\ndevice name with "
-                        "'pointer:' or 'keyboard:' as appropriate.\n\n", name);
-                XIFreeDeviceInfo(info);
-                return NULL;
-            } else {
-                found = &info[i];
-            }
-        }
+    for (i = 0; i < started; i++) {
+	pthread_join(jobs[i].thread, NULL);
+	if (jobs[i].ret == EXIT_FAILURE) {
+	    ret = EXIT_FAILURE;
+	}
     }
+    free(jobs);
 
-    return found;
+    return ret;
 }
-#endif
 
-static void
-usage(void)
+/* Adds the comma separated display names to the list */
+static int
+add_displays(char *list, const char **names, int *count)
 {
-    entry	*pdriver = drivers;
+    char *name, *save;
 
-    fprintf(stderr, "usage txrandr-align [ -v | --verbose ] [function-name]:\n");
-
-    fprintf(stderr, "\txrandr-align version\n");
-    while(pdriver->func_name) {
-	fprintf(stderr, "\txrandr-align %s %s\n", pdriver->func_name,
-		pdriver->arg_desc);
-	pdriver++;
+    for (name = strtok_r(list, ",", &save); name; name = strtok_r(NULL, ",", &save)) {
+	if (*count == MAX_DISPLAYS) {
+	    fprintf(stderr, "Too many displays, at most %i are served\n", MAX_DISPLAYS);
+	    return EXIT_FAILURE;
+	}
+	names[(*count)++] = name;
     }
+
+    return EXIT_SUCCESS;
 }
 
 int
 main(int argc, const char * argv[])
 {
-    Display	*display;
     entry	*driver = drivers;
     const char  *func;
-    int event, error;
     int argoffs;
+    int verbose = 0;
+    static const char *displays[MAX_DISPLAYS];
+    int ndisplays = 0;
 
     if (argc < 2) {
       func = "align";
@@ -368,6 +325,12 @@ main(int argc, const char * argv[])
 	if (strncmp (argv[i], "-v", 2) == 0 || \
 	    strncmp (argv[i], "--verbose", 9) == 0) {
 	  verbose = 1;
+	} else if (strcmp (argv[i], "--profile-x") == 0) {
+	  profile_x = 1;
+	} else if (strncmp (argv[i], "--display=", 10) == 0) {
+	  if (add_displays (strdup (argv[i] + 10), displays, &ndisplays) == EXIT_FAILURE) {
+	    return EXIT_FAILURE;
+	  }
 	} else if (strncmp (argv[i], "-h", 2) == 0 ||	\
 		   strncmp (argv[i], "--help", 6) == 0 || \
 		   strncmp (argv[i], "--usage", 7) == 0) {
@@ -391,38 +354,35 @@ main(int argc, const char * argv[])
         return print_version(argv[0]);
     }
 
-    display = XOpenDisplay(NULL);
-
-    if (display == NULL) {
-	fprintf(stderr, "Unable to connect to X server\n");
-	return EXIT_FAILURE;
-    }
-
-    if (!XQueryExtension(display, "XInputExtension", &xi_opcode, &event, &error)) {
-        printf("X Input extension not available.\n");
-        return EXIT_FAILURE;
-    }
-
-    if (!xinput_version(display)) {
-	fprintf(stderr, "%s extension not available\n", INAME);
-	return EXIT_FAILURE;
+    if (strcmp("trace-decode", func) == 0) {
+        if (argoffs >= argc) {
+            usage();
+            return EXIT_FAILURE;
+        }
+        return trace_decode(argv[argoffs]);
     }
 
     while(driver->func_name) {
       if (strcmp (driver->func_name, func) == 0 ||
 	  *driver->func_name == '[' && strncmp (driver->func_name + 1, func, strlen (func)) == 0) {
-	    int	r = (*driver->func)(display, argc - argoffs, argv + argoffs,
-				    driver->func_name, driver->arg_desc);
-	    XSync(display, False);
-	    XCloseDisplay(display);
-	    return r;
+	    break;
 	}
 	driver++;
     }
+    if (!driver->func_name) {
+	usage();
+	return EXIT_FAILURE;
+    }
 
-    usage();
+    xerror_install();
 
-    return EXIT_FAILURE;
+    if (ndisplays > 1) {
+	return run_displays(driver, func, displays, ndisplays, verbose,
+			    argc - argoffs, argv + argoffs);
+    }
+
+    return run_display(driver, func, ndisplays ? displays[0] : NULL, verbose,
+		       argc - argoffs, argv + argoffs);
 }
 
 /* end of xrandr-align.c */
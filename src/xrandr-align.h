@@ -44,6 +44,7 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <X11/extensions/Xrandr.h>
+#include <sys/types.h>
 
 #ifndef EXIT_SUCCESS
 #define EXIT_SUCCESS 1
@@ -52,25 +53,133 @@
 #define EXIT_FAILURE 0
 #endif
 
-extern int xi_opcode; /* xinput extension op code */
+/* The capabilities of the X connection, negotiated once at the
+   start, and the XI 1 devices kept open for the property writes */
+typedef struct
+{
+  Display *display;
+  int xi_opcode;	/* xinput extension op code */
+  int xi_version;	/* XI major version on the server, -1 if none */
+  int xi2;		/* XI 2 requests and events are usable */
+  Atom float_atom;	/* FLOAT */
+  Atom matrix_atom;	/* Coordinate Transformation Matrix */
+  XDevice *devices[256];	/* XI 1 devices by ID (IDs are 8 bit) */
+} connection;
+
+int connection_init (connection *conn, Display *display);
+void connection_close (connection *conn);
+XDevice *connection_device (connection *conn, XID deviceid);
+void connection_forget (connection *conn, XID deviceid);
 XDeviceInfo* find_device_info( Display *display, const char *name, Bool only_extended);
 XDeviceInfo* find_device_info_ext (Display *display, const char *name, Bool only_extended, unsigned char mode, unsigned char min_axes, Bool signed_axes);
+int check_valuator (XDeviceInfo *info, unsigned char mode, unsigned char min_axes, Bool axes_signed);
+XDeviceInfo* find_device_in_list (XDeviceInfo *devices, int num_devices, const char *name, Bool only_extended, unsigned char mode, unsigned char min_axes, Bool signed_axes);
 #if HAVE_XI2
 XIDeviceInfo* xi2_find_device_info(Display *display, const char *name);
-int xinput_version(Display* display);
-int check_xi2 (Display *display);
+XIDeviceInfo* xi2_find_device_in_list(XIDeviceInfo *info, int ndevices, const char *name);
 #endif
+int xinput_version(Display* display);
+
+/* A stored correction of an input: an affine transformation of the
+   normalized device coordinates */
+typedef struct
+{
+  char *input;
+  double c[6];
+} correction;
+
+/* The calibration file of a display, loaded on the first use and again
+   whenever it is replaced or modified */
+typedef struct
+{
+  int located;		/* the path is set, empty if there is none */
+  char path[1024];
+  int loaded;
+  time_t mtime;		/* the file loaded, all 0 if it is missing */
+  off_t size;
+  ino_t ino;
+  correction *corrections;
+  int count;
+} calibration;
 
-extern int verbose;
+/* Everything a function needs, set up once by main(): the display,
+   its negotiated capabilities and the parsed options */
+typedef struct
+{
+  Display *display;
+  connection conn;
+  options opts;
+  calibration cal;
+  int verbose;
+} context;
 
-int list_input( Display* display, int argc, const char *argv[], const char *prog_name, const char *prog_desc);
-int list_output( Display* display, int argc, const char *argv[], const char *prog_name, const char *prog_desc);
-int align (Display *display, int argc, const char *argv[], const char *funcname, const char *usage);
-int apply_transform (Display *display, Window root, RRCrtc crtcnum, const char *input_name);
-int monitor (Display *display, int argc, const char *argv[], const char *funcname, const char *usage);
-int gravitate (Display *display, int argc, const char *argv[], const char *funcname, const char *usage);
+/* The result of an alignment: the CRTC geometry and the RandR
+   timestamps it was computed from, the device and the matrix. */
+typedef struct
+{
+  Time timestamp;
+  Time config_timestamp;
+  RRCrtc crtc;
+  int x, y;
+  unsigned int width, height;
+  Rotation rotation;
+  XID deviceid;
+  float matrix[9];
+} alignment;
+
+/* The RandR configuration of a screen, fetched on the first use after
+   a RandR event on the screen and kept until the next one: the output
+   infos and the CRTC infos and transforms are fetched one by one on
+   demand. Aligning the bindings of the screen again and again between
+   two events issues no request and allocates nothing. */
+typedef struct
+{
+  XRRCrtcInfo *info;	/* NULL until fetched */
+  XTransform transform;	/* the current transform */
+} screen_crtc;
+
+typedef struct
+{
+  Window root;
+  int selected;		/* the RandR events are selected */
+  int dirty;		/* fetched again on the next use */
+  XRRScreenResources *res;
+  XRRScreenConfiguration *sconf;
+  XRROutputInfo **infos;	/* in the order of res->outputs */
+  int ninfos;		/* the allocated size of infos */
+  screen_crtc *crtcs;	/* in the order of res->crtcs */
+  int ncrtcs;		/* the allocated size of crtcs */
+} screen_cache;
+
+void screen_refresh (Display *display, screen_cache *sc);
+void screen_free (screen_cache *sc);
+const screen_crtc *screen_get_crtc (Display *display, screen_cache *sc, RRCrtc crtc);
+int screen_transform (context *ctx, screen_cache *sc, RRCrtc crtcnum, alignment *al);
+
+int list_input (context *ctx);
+int list_output (context *ctx);
+int align (context *ctx);
+int apply_transform (context *ctx, Window root, RRCrtc crtcnum, const char *input_name);
+int apply_transform_ext (context *ctx, Window root, RRCrtc crtcnum, const char *input_name, alignment *al);
+int find_inputs (Display *display, int xi2, const char **names, int count, XID *ids);
+int write_transform (context *ctx, const char *input_name, alignment *al);
+int write_transform_id (context *ctx, const char *input_name, XID deviceid, alignment *al);
+int compute_transform (context *ctx, XRRScreenResources *res, XRRScreenConfiguration *sconf, RRCrtc crtcnum, alignment *al);
+int compute_crtc_transform (context *ctx, XRRScreenResources *res, XRRScreenConfiguration *sconf, RRCrtc crtcnum, const XRRCrtcInfo *crtc, const XTransform *current, alignment *al);
+int monitor (context *ctx);
+int gravitate (context *ctx);
+int calibrate (context *ctx);
+void correct_matrix (context *ctx, const char *input_name, float matrix[9]);
+void free_calibration (calibration *cal);
+int fit_affine (const double raw[][2], const double expected[][2], int n, double c[6]);
+int unalign_point (const float m[9], double sx, double sy, double *dx, double *dy);
+int auto_bindings (context *ctx, Window root, binding **bindings, int *count);
 
 /* X Input 1.5 */
-int set_float_prop( Display* display, int argc, const char *argv[], const char *prog_name, const char *prog_desc);
+#define FLOAT_PROP_MAX 16	/* the most values written at once */
+
+int set_float_prop (context *ctx);
+int change_float_prop (context *ctx, XID deviceid, Atom prop, const float *values, int nvalues);
+int get_float_prop (context *ctx, XID deviceid, Atom prop, float *values, int nvalues);
 
 /* end of xrandr-align.h */
@@ -0,0 +1,74 @@
+/*
+ * Original xinput:
+ * Copyright 1996 by Frederic Lepied, France. <Frederic.Lepied@sugix.frmug.org>
+ *
+ * Original xrandr:
+ * Copyright © 2001 Keith Packard, member of The XFree86 Project, Inc.
+ * Copyright © 2002 Hewlett Packard Company, Inc.
+ * Copyright © 2006 Intel Corporation
+ *
+ * xrandr-align:
+ *
+ * Copyright © 2012 Paul Wolneykien <manowar@altlinux.org>, ALT Linux Ltd.
+ *
+ * Permission to use, copy, modify, distribute, and sell this software and its
+ * documentation for any purpose is  hereby granted without fee, provided that
+ * the  above copyright   notice appear  in   all  copies and  that both  that
+ * copyright  notice   and   this  permission   notice  appear  in  supporting
+ * documentation, and that   the  name of  the authors  not  be  used  in
+ * advertising or publicity pertaining to distribution of the software without
+ * specific,  written      prior  permission.     The authors  make  no
+ * representations about the suitability of this software for any purpose.  It
+ * is provided "as is" without express or implied warranty.
+ *
+ * THE AUTHORS DISCLAIM ALL   WARRANTIES WITH REGARD  TO  THIS SOFTWARE,
+ * INCLUDING ALL IMPLIED   WARRANTIES OF MERCHANTABILITY  AND   FITNESS, IN NO
+ * EVENT  SHALL THE AUTHORS  BE   LIABLE   FOR ANY  SPECIAL, INDIRECT   OR
+ * CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM LOSS OF USE,
+ * DATA  OR PROFITS, WHETHER  IN  AN ACTION OF  CONTRACT,  NEGLIGENCE OR OTHER
+ * TORTIOUS  ACTION, ARISING    OUT OF OR   IN  CONNECTION  WITH THE USE    OR
+ * PERFORMANCE OF THIS SOFTWARE.
+ *
+ */
+
+/*
+ * The checks shared by the tests: a failed check is reported and
+ * counted, the test goes on and exits with 1 at the end.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+
+static int check_failures;
+
+#define CHECK(cond)							\
+  do {									\
+    if (!(cond)) {							\
+      fprintf (stderr, "%s:%i: check failed: %s\n",			\
+	       __FILE__, __LINE__, #cond);				\
+      check_failures++;							\
+    }									\
+  } while (0)
+
+/* The template of the scratch directory of a test */
+#define CHECK_TMPDIR "/tmp/xrandr-align-test-XXXXXX"
+
+/* Makes the scratch directory, giving up with the hard error status
+   of the test harness if it can't */
+static inline void
+check_tmpdir (char *dir)
+{
+  if (!mkdtemp (dir)) {
+    perror (dir);
+    exit (99);
+  }
+}
+
+/* The exit status of the test */
+static inline int
+check_status (void)
+{
+  return check_failures ? 1 : 0;
+}
+
+/* end of check.h */
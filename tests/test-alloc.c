@@ -0,0 +1,381 @@
+/*
+ * Original xinput:
+ * Copyright 1996 by Frederic Lepied, France. <Frederic.Lepied@sugix.frmug.org>
+ *
+ * Original xrandr:
+ * Copyright © 2001 Keith Packard, member of The XFree86 Project, Inc.
+ * Copyright © 2002 Hewlett Packard Company, Inc.
+ * Copyright © 2006 Intel Corporation
+ *
+ * xrandr-align:
+ *
+ * Copyright © 2012 Paul Wolneykien <manowar@altlinux.org>, ALT Linux Ltd.
+ *
+ * Permission to use, copy, modify, distribute, and sell this software and its
+ * documentation for any purpose is  hereby granted without fee, provided that
+ * the  above copyright   notice appear  in   all  copies and  that both  that
+ * copyright  notice   and   this  permission   notice  appear  in  supporting
+ * documentation, and that   the  name of  the authors  not  be  used  in
+ * advertising or publicity pertaining to distribution of the software without
+ * specific,  written      prior  permission.     The authors  make  no
+ * representations about the suitability of this software for any purpose.  It
+ * is provided "as is" without express or implied warranty.
+ *
+ * THE AUTHORS DISCLAIM ALL   WARRANTIES WITH REGARD  TO  THIS SOFTWARE,
+ * INCLUDING ALL IMPLIED   WARRANTIES OF MERCHANTABILITY  AND   FITNESS, IN NO
+ * EVENT  SHALL THE AUTHORS  BE   LIABLE   FOR ANY  SPECIAL, INDIRECT   OR
+ * CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM LOSS OF USE,
+ * DATA  OR PROFITS, WHETHER  IN  AN ACTION OF  CONTRACT,  NEGLIGENCE OR OTHER
+ * TORTIOUS  ACTION, ARISING    OUT OF OR   IN  CONNECTION  WITH THE USE    OR
+ * PERFORMANCE OF THIS SOFTWARE.
+ *
+ */
+
+
+/*
+ * The allocations of the alignment path: a rotation storm on a fake
+ * screen, the RandR replies and the property writes being stubbed
+ * here in place of the X libraries, with malloc() counted.
+ *
+ * Each event fetches the screen configuration and the replies of the
+ * CRTCs in use once, whatever the number of bindings; between two
+ * events the alignments allocate nothing.
+ */
+
+#include "common.h"
+#include "xrandr-align.h"
+#include "target.h"
+#include "check.h"
+#include <string.h>
+#include <unistd.h>
+
+#define SCREEN_WIDTH 3840
+#define SCREEN_HEIGHT 1080
+#define NCRTCS 2
+#define NOUTPUTS 3
+#define NBINDINGS 8
+#define STORM_EVENTS 200
+#define STEADY_ALIGNMENTS 1000
+
+/* The allocator: counted while counting is set */
+
+#ifdef __GLIBC__
+extern void *__libc_malloc (size_t size);
+extern void *__libc_calloc (size_t nmemb, size_t size);
+extern void *__libc_realloc (void *ptr, size_t size);
+
+static int counting;
+static unsigned long allocations;
+
+void *
+malloc (size_t size)
+{
+  if (counting) {
+    allocations++;
+  }
+  return __libc_malloc (size);
+}
+
+void *
+calloc (size_t nmemb,
+	size_t size)
+{
+  if (counting) {
+    allocations++;
+  }
+  return __libc_calloc (nmemb, size);
+}
+
+void *
+realloc (void *ptr,
+	 size_t size)
+{
+  if (counting) {
+    allocations++;
+  }
+  return __libc_realloc (ptr, size);
+}
+#endif
+
+/* The fake server: two CRTCs side by side, rotated on each event */
+
+struct _XRRScreenConfiguration
+{
+  XRRScreenSize size;
+};
+
+static Rotation rotation = RR_Rotate_0;
+static unsigned long replies;	/* the replies allocated by the stubs */
+static unsigned long crtc_fetches;
+static unsigned long writes;
+
+XRRScreenResources *
+XRRGetScreenResourcesCurrent (Display *display,
+			      Window window)
+{
+  XRRScreenResources *res;
+  int i;
+
+  res = calloc (1, sizeof (XRRScreenResources) +
+		NCRTCS * sizeof (RRCrtc) + NOUTPUTS * sizeof (RROutput));
+  replies++;
+  res->timestamp = replies;
+  res->configTimestamp = 1;
+  res->ncrtc = NCRTCS;
+  res->crtcs = (RRCrtc *) (res + 1);
+  res->noutput = NOUTPUTS;
+  res->outputs = (RROutput *) (res->crtcs + NCRTCS);
+  for (i = 0; i < NCRTCS; i++) {
+    res->crtcs[i] = 0x40 + i;
+  }
+  for (i = 0; i < NOUTPUTS; i++) {
+    res->outputs[i] = 0x50 + i;
+  }
+
+  return res;
+}
+
+void
+XRRFreeScreenResources (XRRScreenResources *res)
+{
+  free (res);
+}
+
+XRRScreenConfiguration *
+XRRGetScreenInfo (Display *display,
+		  Window window)
+{
+  XRRScreenConfiguration *sconf;
+
+  sconf = calloc (1, sizeof (XRRScreenConfiguration));
+  replies++;
+  sconf->size.width = SCREEN_WIDTH;
+  sconf->size.height = SCREEN_HEIGHT;
+
+  return sconf;
+}
+
+void
+XRRFreeScreenConfigInfo (XRRScreenConfiguration *sconf)
+{
+  free (sconf);
+}
+
+XRRScreenSize *
+XRRConfigSizes (XRRScreenConfiguration *sconf,
+		int *nsizes)
+{
+  *nsizes = 1;
+  return &sconf->size;
+}
+
+SizeID
+XRRConfigCurrentConfiguration (XRRScreenConfiguration *sconf,
+			       Rotation *srot)
+{
+  *srot = RR_Rotate_0;
+  return 0;
+}
+
+XRRCrtcInfo *
+XRRGetCrtcInfo (Display *display,
+		XRRScreenResources *res,
+		RRCrtc crtc)
+{
+  XRRCrtcInfo *info;
+
+  info = calloc (1, sizeof (XRRCrtcInfo));
+  replies++;
+  crtc_fetches++;
+  info->timestamp = res->timestamp;
+  info->x = (crtc - 0x40) * (SCREEN_WIDTH / NCRTCS);
+  info->width = SCREEN_WIDTH / NCRTCS;
+  info->height = SCREEN_HEIGHT;
+  info->rotation = rotation;
+
+  return info;
+}
+
+void
+XRRFreeCrtcInfo (XRRCrtcInfo *info)
+{
+  free (info);
+}
+
+Status
+XRRGetCrtcTransform (Display *display,
+		     RRCrtc crtc,
+		     XRRCrtcTransformAttributes **attributes)
+{
+  int i;
+
+  *attributes = calloc (1, sizeof (XRRCrtcTransformAttributes));
+  replies++;
+  for (i = 0; i < 3; i++) {
+    (*attributes)->currentTransform.matrix[i][i] = XDoubleToFixed (1);
+  }
+
+  return 1;
+}
+
+/* A write is a request the server processes at once, as the alignments
+   then find it retired */
+static void
+serve_request (Display *display)
+{
+  _XPrivDisplay dpy = (_XPrivDisplay) display;
+
+  dpy->last_request_read = ++dpy->request;
+}
+
+#if HAVE_XI2
+void
+XIChangeProperty (Display *display,
+		  int deviceid,
+		  Atom property,
+		  Atom type,
+		  int format,
+		  int mode,
+		  unsigned char *data,
+		  int num_items)
+{
+  serve_request (display);
+  writes++;
+}
+#endif
+
+void
+XChangeDeviceProperty (Display *display,
+		       XDevice *device,
+		       Atom property,
+		       Atom type,
+		       int format,
+		       int mode,
+		       const unsigned char *data,
+		       int num_items)
+{
+  serve_request (display);
+  writes++;
+}
+
+/* Aligns the bindings as the monitor does on an event: from the
+   screen cache, to the device IDs already looked up */
+static void
+align_all (context *ctx,
+	   screen_cache *sc,
+	   const target *group)
+{
+  alignment al;
+  int i;
+
+  for (i = 0; i < NBINDINGS; i++) {
+    if (i == NBINDINGS - 1) {
+      CHECK (compute_target_transform (ctx, sc, group, &al) == EXIT_SUCCESS);
+    } else {
+      CHECK (screen_transform (ctx, sc, 0x40 + i % NCRTCS, &al) == EXIT_SUCCESS);
+    }
+    CHECK (write_transform_id (ctx, "test", 2 + i, &al) == EXIT_SUCCESS);
+  }
+}
+
+static void
+test_storm (void)
+{
+  static XDevice devices[NBINDINGS];
+  unsigned long stub_replies;
+  context ctx;
+  screen_cache sc;
+  target group;
+  alignment al;
+  int i;
+
+  memset (&ctx, 0, sizeof (ctx));
+  /* Only the request serials of the display are read */
+  ctx.display = calloc (1, sizeof (*(_XPrivDisplay) NULL));
+  ctx.conn.display = ctx.display;
+#if HAVE_XI2
+  ctx.conn.xi2 = 1;
+#endif
+  ctx.conn.float_atom = 1;
+  ctx.conn.matrix_atom = 2;
+  for (i = 0; i < NBINDINGS; i++) {
+    devices[i].device_id = 2 + i;
+    ctx.conn.devices[2 + i] = &devices[i];
+  }
+
+  memset (&group, 0, sizeof (group));
+  group.count = NCRTCS;
+  for (i = 0; i < NCRTCS; i++) {
+    group.outputs[i] = 0x50 + i;
+    group.crtcs[i] = 0x40 + i;
+  }
+
+  memset (&sc, 0, sizeof (sc));
+  sc.dirty = 1;
+
+  /* The unrotated left CRTC maps to the left half */
+  CHECK (screen_transform (&ctx, &sc, 0x40, &al) == EXIT_SUCCESS);
+  CHECK (al.matrix[0] == 0.5f && al.matrix[2] == 0.0f && al.matrix[4] == 1.0f);
+  CHECK (compute_target_transform (&ctx, &sc, &group, &al) == EXIT_SUCCESS);
+  CHECK (al.width == SCREEN_WIDTH && al.matrix[0] == 1.0f);
+  /* The first alignment loads the (missing) calibration file */
+  align_all (&ctx, &sc, &group);
+
+#ifdef __GLIBC__
+  counting = 1;
+#endif
+
+  /* The storm: the replies are fetched once per event and CRTC */
+  stub_replies = replies;
+  crtc_fetches = 0;
+  writes = 0;
+  for (i = 0; i < STORM_EVENTS; i++) {
+    rotation = rotation == RR_Rotate_0 ? RR_Rotate_90 : RR_Rotate_0;
+    sc.dirty = 1;
+    align_all (&ctx, &sc, &group);
+  }
+  stub_replies = replies - stub_replies;
+  CHECK (crtc_fetches == STORM_EVENTS * NCRTCS);
+  CHECK (stub_replies == STORM_EVENTS * (2 + 2 * NCRTCS));
+  CHECK (writes == STORM_EVENTS * NBINDINGS);
+  CHECK (screen_transform (&ctx, &sc, 0x40, &al) == EXIT_SUCCESS);
+  CHECK (al.rotation == rotation);
+
+  /* The steady state: no event, no request, no allocation */
+  stub_replies = replies;
+  for (i = 0; i < STEADY_ALIGNMENTS / NBINDINGS; i++) {
+    align_all (&ctx, &sc, &group);
+  }
+  CHECK (replies == stub_replies);
+
+#ifdef __GLIBC__
+  counting = 0;
+  /* Only the stubbed replies were allocated */
+  if (allocations != STORM_EVENTS * (2 + 2 * NCRTCS)) {
+    fprintf (stderr, "%lu allocations for %lu replies\n", allocations,
+	     (unsigned long) STORM_EVENTS * (2 + 2 * NCRTCS));
+    check_failures++;
+  }
+#endif
+
+  screen_free (&sc);
+  free (ctx.display);
+}
+
+int
+main (void)
+{
+  char dir[] = CHECK_TMPDIR;
+
+  check_tmpdir (dir);
+  /* No calibration of the user is applied */
+  setenv ("HOME", dir, 1);
+
+  test_storm ();
+
+  rmdir (dir);
+
+  return check_status ();
+}
+
+/* end of test-alloc.c */
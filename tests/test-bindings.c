@@ -0,0 +1,107 @@
+/*
+ * Original xinput:
+ * Copyright 1996 by Frederic Lepied, France. <Frederic.Lepied@sugix.frmug.org>
+ *
+ * Original xrandr:
+ * Copyright © 2001 Keith Packard, member of The XFree86 Project, Inc.
+ * Copyright © 2002 Hewlett Packard Company, Inc.
+ * Copyright © 2006 Intel Corporation
+ *
+ * xrandr-align:
+ *
+ * Copyright © 2012 Paul Wolneykien <manowar@altlinux.org>, ALT Linux Ltd.
+ *
+ * Permission to use, copy, modify, distribute, and sell this software and its
+ * documentation for any purpose is  hereby granted without fee, provided that
+ * the  above copyright   notice appear  in   all  copies and  that both  that
+ * copyright  notice   and   this  permission   notice  appear  in  supporting
+ * documentation, and that   the  name of  the authors  not  be  used  in
+ * advertising or publicity pertaining to distribution of the software without
+ * specific,  written      prior  permission.     The authors  make  no
+ * representations about the suitability of this software for any purpose.  It
+ * is provided "as is" without express or implied warranty.
+ *
+ * THE AUTHORS DISCLAIM ALL   WARRANTIES WITH REGARD  TO  THIS SOFTWARE,
+ * INCLUDING ALL IMPLIED   WARRANTIES OF MERCHANTABILITY  AND   FITNESS, IN NO
+ * EVENT  SHALL THE AUTHORS  BE   LIABLE   FOR ANY  SPECIAL, INDIRECT   OR
+ * CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM LOSS OF USE,
+ * DATA  OR PROFITS, WHETHER  IN  AN ACTION OF  CONTRACT,  NEGLIGENCE OR OTHER
+ * TORTIOUS  ACTION, ARISING    OUT OF OR   IN  CONNECTION  WITH THE USE    OR
+ * PERFORMANCE OF THIS SOFTWARE.
+ *
+ */
+
+/*
+ * The configuration file of the bindings: the quoted output and input
+ * followed by the pre: and post: scripts, whose commands may contain
+ * colons.
+ */
+
+#include "common.h"
+#include "xrandr-align.h"
+#include "check.h"
+#include <string.h>
+#include <unistd.h>
+
+static void
+test_options (const char *dir)
+{
+  char path[1024];
+  binding *bindings;
+  int count;
+  FILE *f;
+
+  snprintf (path, sizeof (path), "%s/bindings", dir);
+  f = fopen (path, "w");
+  if (!f) {
+    perror (path);
+    check_failures++;
+    return;
+  }
+  fputs ("# output input options\n"
+	 "\"LVDS1\" \"touch\"\n"
+	 "\"HDMI1\" \"pen\" post: logger -t align status:ok\n"
+	 "\"DP1\" \"tablet\" pre: curl http://localhost:8080/x post: true\n"
+	 "\"DP2\" \"panel\" unknown:1 post:echo a:b\n",
+	 f);
+  fclose (f);
+
+  CHECK (read_bindings (path, "default-pre", "default-post", &bindings, &count) == EXIT_SUCCESS);
+  CHECK (count == 4);
+  if (count != 4) {
+    return;
+  }
+
+  CHECK (strcmp (bindings[0].pre_script, "default-pre") == 0);
+  CHECK (strcmp (bindings[0].post_script, "default-post") == 0);
+
+  CHECK (strcmp (bindings[1].input, "pen") == 0);
+  CHECK (strcmp (bindings[1].pre_script, "default-pre") == 0);
+  CHECK (strcmp (bindings[1].post_script, "logger -t align status:ok") == 0);
+
+  CHECK (strcmp (bindings[2].pre_script, "curl http://localhost:8080/x") == 0);
+  CHECK (strcmp (bindings[2].post_script, "true") == 0);
+
+  /* The words before the first key are not a key */
+  CHECK (strcmp (bindings[3].pre_script, "default-pre") == 0);
+  CHECK (strcmp (bindings[3].post_script, "echo a:b") == 0);
+
+  free_bindings (bindings, count);
+  unlink (path);
+}
+
+int
+main (void)
+{
+  char dir[] = CHECK_TMPDIR;
+
+  check_tmpdir (dir);
+
+  test_options (dir);
+
+  rmdir (dir);
+
+  return check_status ();
+}
+
+/* end of test-bindings.c */
@@ -0,0 +1,214 @@
+/*
+ * Original xinput:
+ * Copyright 1996 by Frederic Lepied, France. <Frederic.Lepied@sugix.frmug.org>
+ *
+ * Original xrandr:
+ * Copyright © 2001 Keith Packard, member of The XFree86 Project, Inc.
+ * Copyright © 2002 Hewlett Packard Company, Inc.
+ * Copyright © 2006 Intel Corporation
+ *
+ * xrandr-align:
+ *
+ * Copyright © 2012 Paul Wolneykien <manowar@altlinux.org>, ALT Linux Ltd.
+ *
+ * Permission to use, copy, modify, distribute, and sell this software and its
+ * documentation for any purpose is  hereby granted without fee, provided that
+ * the  above copyright   notice appear  in   all  copies and  that both  that
+ * copyright  notice   and   this  permission   notice  appear  in  supporting
+ * documentation, and that   the  name of  the authors  not  be  used  in
+ * advertising or publicity pertaining to distribution of the software without
+ * specific,  written      prior  permission.     The authors  make  no
+ * representations about the suitability of this software for any purpose.  It
+ * is provided "as is" without express or implied warranty.
+ *
+ * THE AUTHORS DISCLAIM ALL   WARRANTIES WITH REGARD  TO  THIS SOFTWARE,
+ * INCLUDING ALL IMPLIED   WARRANTIES OF MERCHANTABILITY  AND   FITNESS, IN NO
+ * EVENT  SHALL THE AUTHORS  BE   LIABLE   FOR ANY  SPECIAL, INDIRECT   OR
+ * CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM LOSS OF USE,
+ * DATA  OR PROFITS, WHETHER  IN  AN ACTION OF  CONTRACT,  NEGLIGENCE OR OTHER
+ * TORTIOUS  ACTION, ARISING    OUT OF OR   IN  CONNECTION  WITH THE USE    OR
+ * PERFORMANCE OF THIS SOFTWARE.
+ *
+ */
+
+
+/*
+ * The calibration: the least squares fit of the correction from the
+ * touched points, and the stored corrections read from the
+ * --calibration file of the context and read again when the file is
+ * replaced or modified.
+ */
+
+#include "common.h"
+#include "xrandr-align.h"
+#include "check.h"
+#include <math.h>
+#include <string.h>
+#include <unistd.h>
+
+/* The touched points: the corners, the center and the edge middles
+   as calibrate shows them */
+static const double points[9][2] =
+{
+  { 0.1, 0.1 }, { 0.9, 0.1 }, { 0.9, 0.9 }, { 0.1, 0.9 }, { 0.5, 0.5 },
+  { 0.5, 0.1 }, { 0.9, 0.5 }, { 0.5, 0.9 }, { 0.1, 0.5 }
+};
+
+static void
+write_file (const char *path,
+	    const char *content)
+{
+  char tmppath[1100];
+  FILE *f;
+
+  /* Replaced as calibrate does it */
+  snprintf (tmppath, sizeof (tmppath), "%s.new", path);
+  f = fopen (tmppath, "w");
+  if (!f || fputs (content, f) < 0 || fclose (f) != 0 ||
+      rename (tmppath, path) != 0) {
+    perror (path);
+    check_failures++;
+  }
+}
+
+static void
+correct (context *ctx,
+	 const char *input,
+	 float m[9])
+{
+  static const float identity[9] = { 1, 0, 0, 0, 1, 0, 0, 0, 1 };
+
+  memcpy (m, identity, sizeof (identity));
+  correct_matrix (ctx, input, m);
+}
+
+static void
+test_reload (const char *dir)
+{
+  char path[1024];
+  context ctx;
+  float m[9];
+
+  snprintf (path, sizeof (path), "%s/calibration", dir);
+  memset (&ctx, 0, sizeof (ctx));
+  ctx.opts.calibration = path;
+
+  /* No file: no correction */
+  correct (&ctx, "touch", m);
+  CHECK (m[0] == 1 && m[2] == 0);
+
+  write_file (path, "\"touch\" 2 0 0.5 0 1 0\n\"other\" 1 0 0 0 1 0\n");
+  correct (&ctx, "touch", m);
+  CHECK (m[0] == 2 && m[2] == 0.5f && m[4] == 1);
+  CHECK (ctx.cal.count == 2);
+
+  /* Replaced within the same second */
+  write_file (path, "\"touch\" 1 0 0 0 3 0.25\n");
+  correct (&ctx, "touch", m);
+  CHECK (m[0] == 1 && m[2] == 0 && m[4] == 3 && m[5] == 0.25f);
+  CHECK (ctx.cal.count == 1);
+  correct (&ctx, "other", m);
+  CHECK (m[0] == 1 && m[4] == 1);
+
+  /* Removed */
+  unlink (path);
+  correct (&ctx, "touch", m);
+  CHECK (m[4] == 1 && ctx.cal.count == 0);
+
+  free_calibration (&ctx.cal);
+}
+
+/* A scale, a skew and an offset are recovered from 4 to 9 points */
+static void
+test_fit (void)
+{
+  static const double known[6] = { 1.1, 0.05, -0.02, -0.03, 0.95, 0.04 };
+  double raw[9][2], expected[9][2];
+  double c[6];
+  int n, i, k;
+
+  for (i = 0; i < 9; i++) {
+    raw[i][0] = points[i][0];
+    raw[i][1] = points[i][1];
+    expected[i][0] = known[0]*raw[i][0] + known[1]*raw[i][1] + known[2];
+    expected[i][1] = known[3]*raw[i][0] + known[4]*raw[i][1] + known[5];
+  }
+
+  for (n = 4; n <= 9; n++) {
+    CHECK (fit_affine (raw, expected, n, c) == EXIT_SUCCESS);
+    for (k = 0; k < 6; k++) {
+      CHECK (fabs (c[k] - known[k]) < 1e-9);
+    }
+  }
+
+  /* The touches off by a little are averaged out */
+  for (i = 0; i < 9; i++) {
+    expected[i][0] += (i % 2 ? 0.002 : -0.002);
+    expected[i][1] += (i % 3 ? 0.001 : -0.002);
+  }
+  CHECK (fit_affine (raw, expected, 9, c) == EXIT_SUCCESS);
+  for (k = 0; k < 6; k++) {
+    CHECK (fabs (c[k] - known[k]) < 0.01);
+  }
+}
+
+/* The points on a line give no transformation */
+static void
+test_collinear (void)
+{
+  double raw[5][2], expected[5][2];
+  double c[6];
+  int i;
+
+  for (i = 0; i < 5; i++) {
+    raw[i][0] = 0.1 + 0.2 * i;
+    raw[i][1] = 0.5 * raw[i][0] + 0.1;
+    expected[i][0] = raw[i][0];
+    expected[i][1] = raw[i][1];
+  }
+  CHECK (fit_affine (raw, expected, 5, c) == EXIT_FAILURE);
+
+  /* All on one point */
+  for (i = 0; i < 5; i++) {
+    raw[i][0] = raw[i][1] = 0.5;
+  }
+  CHECK (fit_affine (raw, expected, 5, c) == EXIT_FAILURE);
+}
+
+/* The touched point is mapped back to the device space through the
+   inverse of the alignment */
+static void
+test_unalign (void)
+{
+  static const float m[9] = { 0.5, 0.1, 0.25, -0.05, 0.8, 0.1, 0, 0, 1 };
+  static const float singular[9] = { 1, 2, 0, 0.5, 1, 0, 0, 0, 1 };
+  double dx, dy;
+  int i;
+
+  for (i = 0; i < 9; i++) {
+    double sx = m[0]*points[i][0] + m[1]*points[i][1] + m[2];
+    double sy = m[3]*points[i][0] + m[4]*points[i][1] + m[5];
+    CHECK (unalign_point (m, sx, sy, &dx, &dy) == EXIT_SUCCESS);
+    CHECK (fabs (dx - points[i][0]) < 1e-6 && fabs (dy - points[i][1]) < 1e-6);
+  }
+  CHECK (unalign_point (singular, 0.5, 0.5, &dx, &dy) == EXIT_FAILURE);
+}
+
+int
+main (void)
+{
+  char dir[] = CHECK_TMPDIR;
+
+  check_tmpdir (dir);
+
+  test_fit ();
+  test_collinear ();
+  test_unalign ();
+  test_reload (dir);
+
+  rmdir (dir);
+
+  return check_status ();
+}
+
+/* end of test-calibration.c */
@@ -0,0 +1,274 @@
+/*
+ * Original xinput:
+ * Copyright 1996 by Frederic Lepied, France. <Frederic.Lepied@sugix.frmug.org>
+ *
+ * Original xrandr:
+ * Copyright © 2001 Keith Packard, member of The XFree86 Project, Inc.
+ * Copyright © 2002 Hewlett Packard Company, Inc.
+ * Copyright © 2006 Intel Corporation
+ *
+ * xrandr-align:
+ *
+ * Copyright © 2012 Paul Wolneykien <manowar@altlinux.org>, ALT Linux Ltd.
+ *
+ * Permission to use, copy, modify, distribute, and sell this software and its
+ * documentation for any purpose is  hereby granted without fee, provided that
+ * the  above copyright   notice appear  in   all  copies and  that both  that
+ * copyright  notice   and   this  permission   notice  appear  in  supporting
+ * documentation, and that   the  name of  the authors  not  be  used  in
+ * advertising or publicity pertaining to distribution of the software without
+ * specific,  written      prior  permission.     The authors  make  no
+ * representations about the suitability of this software for any purpose.  It
+ * is provided "as is" without express or implied warranty.
+ *
+ * THE AUTHORS DISCLAIM ALL   WARRANTIES WITH REGARD  TO  THIS SOFTWARE,
+ * INCLUDING ALL IMPLIED   WARRANTIES OF MERCHANTABILITY  AND   FITNESS, IN NO
+ * EVENT  SHALL THE AUTHORS  BE   LIABLE   FOR ANY  SPECIAL, INDIRECT   OR
+ * CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM LOSS OF USE,
+ * DATA  OR PROFITS, WHETHER  IN  AN ACTION OF  CONTRACT,  NEGLIGENCE OR OTHER
+ * TORTIOUS  ACTION, ARISING    OUT OF OR   IN  CONNECTION  WITH THE USE    OR
+ * PERFORMANCE OF THIS SOFTWARE.
+ *
+ */
+
+/*
+ * The control protocol: the command line parser, the socket round
+ * trip between control_open() and control() and the check of the
+ * socket directory.
+ */
+
+#include "common.h"
+#include "xrandr-align.h"
+#include "control.h"
+#include "check.h"
+#include <errno.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <sys/wait.h>
+
+static void
+test_split_args (void)
+{
+  char line[CONTROL_LINE_MAX];
+  char *argv[CONTROL_ARGS_MAX];
+  int argc;
+
+  snprintf (line, sizeof (line), "  realign\n");
+  argc = control_split_args (line, argv);
+  CHECK (argc == 1);
+  CHECK (argc == 1 && strcmp (argv[0], "realign") == 0);
+
+  snprintf (line, sizeof (line), "lock\t90 \r\n");
+  argc = control_split_args (line, argv);
+  CHECK (argc == 2);
+  CHECK (argc == 2 && strcmp (argv[1], "90") == 0);
+
+  snprintf (line, sizeof (line), " \t\r\n");
+  CHECK (control_split_args (line, argv) == 0);
+
+  /* The words beyond the limit are dropped */
+  snprintf (line, sizeof (line), "a b c d e f g h i j k");
+  CHECK (control_split_args (line, argv) == CONTROL_ARGS_MAX);
+}
+
+/* Replies with the arguments, fails the "fail" command */
+static int
+echo_handler (void *data,
+	      int argc,
+	      char *argv[],
+	      FILE *out)
+{
+  int i;
+
+  (*(int *) data)++;
+  if (strcmp (argv[0], "fail") == 0) {
+    fprintf (out, "failed as asked\n");
+    return EXIT_FAILURE;
+  }
+  for (i = 0; i < argc; i++) {
+    fprintf (out, "%s%s", i ? " " : "", argv[i]);
+  }
+  fprintf (out, "\n");
+
+  return EXIT_SUCCESS;
+}
+
+static void
+set_options (context *ctx,
+	     const char **argv,
+	     int argc)
+{
+  memset (ctx, 0, sizeof (context));
+  ctx->opts.argc = argc;
+  ctx->opts.argv = argv;
+  ctx->opts.funcname = "control";
+  ctx->opts.usage = "";
+}
+
+/* Sends the command with control() from a child process and serves
+   it. Returns the exit status of the client, its output in reply. */
+static int
+round_trip (control_server *srv,
+	    const char *sockopt,
+	    const char *command,
+	    char *reply,
+	    size_t size)
+{
+  int pfd[2];
+  pid_t pid;
+  int status;
+  ssize_t n, len;
+
+  if (pipe (pfd) != 0) {
+    return -1;
+  }
+
+  pid = fork ();
+  if (pid == 0) {
+    const char *argv[] = { sockopt, command, "x" };
+    context ctx;
+
+    close (pfd[0]);
+    dup2 (pfd[1], STDOUT_FILENO);
+    set_options (&ctx, argv, 3);
+    status = control (&ctx);
+    fflush (stdout);
+    _exit (status == EXIT_SUCCESS ? 0 : 1);
+  }
+  close (pfd[1]);
+
+  control_serve (srv);
+
+  len = 0;
+  while (len < size - 1 && (n = read (pfd[0], reply + len, size - 1 - len)) > 0) {
+    len += n;
+  }
+  reply[len] = '\0';
+  close (pfd[0]);
+
+  if (waitpid (pid, &status, 0) != pid || !WIFEXITED (status)) {
+    return -1;
+  }
+  return WEXITSTATUS (status);
+}
+
+/* Sends the command and closes the connection before the reply is
+   served */
+static int
+hang_up (control_server *srv,
+	 const char *command)
+{
+  struct sockaddr_un addr;
+  int fd;
+
+  fd = socket (AF_UNIX, SOCK_STREAM, 0);
+  if (fd < 0) {
+    return -1;
+  }
+  memset (&addr, 0, sizeof (addr));
+  addr.sun_family = AF_UNIX;
+  snprintf (addr.sun_path, sizeof (addr.sun_path), "%s", srv->path);
+  if (connect (fd, (struct sockaddr *) &addr, sizeof (addr)) != 0 ||
+      write (fd, command, strlen (command)) != strlen (command)) {
+    close (fd);
+    return -1;
+  }
+  close (fd);
+
+  control_serve (srv);
+  return 0;
+}
+
+static void
+test_round_trip (const char *dir)
+{
+  char sockopt[128];
+  char reply[256];
+  const char *argv[1];
+  control_server *srv;
+  context ctx;
+  struct stat st;
+  int served = 0;
+
+  snprintf (sockopt, sizeof (sockopt), "--control=%s/socket", dir);
+  argv[0] = sockopt;
+  set_options (&ctx, argv, 1);
+  srv = control_open (&ctx, "test", echo_handler, &served);
+  CHECK (srv != NULL);
+  if (!srv) {
+    return;
+  }
+
+  CHECK (lstat (srv->path, &st) == 0 && (st.st_mode & 0777) == 0600);
+
+  CHECK (round_trip (srv, sockopt, "echo", reply, sizeof (reply)) == 0);
+  CHECK (strcmp (reply, "echo x\n") == 0);
+
+  /* The generic commands do not reach the handler */
+  CHECK (round_trip (srv, sockopt, "ping", reply, sizeof (reply)) == 0);
+  CHECK (served == 1);
+
+  CHECK (round_trip (srv, sockopt, "fail", reply, sizeof (reply)) == 1);
+  CHECK (strcmp (reply, "failed as asked\n") == 0);
+  CHECK (served == 2);
+  CHECK (srv->commands == 3);
+
+  /* The reply to a client gone is dropped, the server lives on */
+  CHECK (hang_up (srv, "echo gone\n") == 0);
+  CHECK (round_trip (srv, sockopt, "echo", reply, sizeof (reply)) == 0);
+  CHECK (strcmp (reply, "echo x\n") == 0);
+  CHECK (served == 4);
+
+  /* A second daemon on the same path gives way */
+  CHECK (control_open (&ctx, "test", echo_handler, &served) == NULL);
+
+  control_close (srv);
+  CHECK (access (sockopt + strlen ("--control="), F_OK) != 0);
+}
+
+static void
+test_private_dir (const char *dir)
+{
+  char path[108];
+  char sockdir[128];
+  char link[128];
+
+  setenv ("XDG_RUNTIME_DIR", dir, 1);
+  snprintf (sockdir, sizeof (sockdir), "%s/xrandr-align", dir);
+
+  CHECK (control_path (NULL, "test", path, sizeof (path)) == EXIT_SUCCESS);
+
+  chmod (sockdir, 0755);
+  CHECK (control_path (NULL, "test", path, sizeof (path)) == EXIT_FAILURE);
+  chmod (sockdir, 0700);
+  CHECK (control_path (NULL, "test", path, sizeof (path)) == EXIT_SUCCESS);
+
+  /* A symbolic link is not followed even to a good directory */
+  snprintf (link, sizeof (link), "%s/real", dir);
+  rename (sockdir, link);
+  CHECK (symlink (link, sockdir) == 0);
+  CHECK (control_path (NULL, "test", path, sizeof (path)) == EXIT_FAILURE);
+  unlink (sockdir);
+  rmdir (link);
+}
+
+int
+main (void)
+{
+  char dir[] = CHECK_TMPDIR;
+
+  check_tmpdir (dir);
+
+  test_split_args ();
+  test_round_trip (dir);
+  test_private_dir (dir);
+
+  rmdir (dir);
+
+  return check_status ();
+}
+
+/* end of test-control.c */
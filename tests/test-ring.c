@@ -0,0 +1,171 @@
+/*
+ * Original xinput:
+ * Copyright 1996 by Frederic Lepied, France. <Frederic.Lepied@sugix.frmug.org>
+ *
+ * Original xrandr:
+ * Copyright © 2001 Keith Packard, member of The XFree86 Project, Inc.
+ * Copyright © 2002 Hewlett Packard Company, Inc.
+ * Copyright © 2006 Intel Corporation
+ *
+ * xrandr-align:
+ *
+ * Copyright © 2012 Paul Wolneykien <manowar@altlinux.org>, ALT Linux Ltd.
+ *
+ * Permission to use, copy, modify, distribute, and sell this software and its
+ * documentation for any purpose is  hereby granted without fee, provided that
+ * the  above copyright   notice appear  in   all  copies and  that both  that
+ * copyright  notice   and   this  permission   notice  appear  in  supporting
+ * documentation, and that   the  name of  the authors  not  be  used  in
+ * advertising or publicity pertaining to distribution of the software without
+ * specific,  written      prior  permission.     The authors  make  no
+ * representations about the suitability of this software for any purpose.  It
+ * is provided "as is" without express or implied warranty.
+ *
+ * THE AUTHORS DISCLAIM ALL   WARRANTIES WITH REGARD  TO  THIS SOFTWARE,
+ * INCLUDING ALL IMPLIED   WARRANTIES OF MERCHANTABILITY  AND   FITNESS, IN NO
+ * EVENT  SHALL THE AUTHORS  BE   LIABLE   FOR ANY  SPECIAL, INDIRECT   OR
+ * CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM LOSS OF USE,
+ * DATA  OR PROFITS, WHETHER  IN  AN ACTION OF  CONTRACT,  NEGLIGENCE OR OTHER
+ * TORTIOUS  ACTION, ARISING    OUT OF OR   IN  CONNECTION  WITH THE USE    OR
+ * PERFORMANCE OF THIS SOFTWARE.
+ *
+ */
+
+
+/*
+ * The sensor ring: a producer thread pushing at 2 kHz while the main
+ * thread pops, every record arriving once and in order, and the
+ * overflow count of a ring left full. The rate is not checked: a
+ * loaded builder may not hold it.
+ */
+
+#include "common.h"
+#include "xrandr-align.h"
+#include "orientation.h"
+#include "sensor.h"
+#include "check.h"
+#include <string.h>
+#include <time.h>
+
+/* The records pushed and the producer period (ns): 2 kHz for 2 s */
+#define RING_RECORDS 4000
+#define RING_PERIOD 500000
+
+static sensor_ring ring;
+
+/* Pushes the records on absolute deadlines, so the rate holds
+   whatever the time spent in the push */
+static void *
+producer (void *data)
+{
+  unsigned long *lost = data;
+  struct timespec next;
+  sensor_record rec;
+  unsigned int i;
+
+  memset (&rec, 0, sizeof (rec));
+  clock_gettime (CLOCK_MONOTONIC, &next);
+  for (i = 0; i < RING_RECORDS; i++) {
+    rec.time = i;
+    rec.rotation = i % 4 + 1;
+    rec.samples = i % SENSOR_BATCH;
+    rec.g[0] = i;
+    if (!sensor_ring_push (&ring, &rec)) {
+      (*lost)++;
+    }
+    next.tv_nsec += RING_PERIOD;
+    if (next.tv_nsec >= 1000000000) {
+      next.tv_nsec -= 1000000000;
+      next.tv_sec++;
+    }
+    clock_nanosleep (CLOCK_MONOTONIC, TIMER_ABSTIME, &next, NULL);
+  }
+
+  return NULL;
+}
+
+static void
+test_stress (void)
+{
+  struct timespec pause = { 0, 100000 };
+  unsigned long lost = 0;
+  unsigned long popped = 0;
+  unsigned long expected = 0;
+  unsigned long misordered = 0;
+  unsigned long corrupt = 0;
+  sensor_record rec;
+  pthread_t thread;
+  int running = 1;
+
+  memset (&ring, 0, sizeof (ring));
+  if (pthread_create (&thread, NULL, producer, &lost) != 0) {
+    perror ("pthread_create");
+    check_failures++;
+    return;
+  }
+
+  while (running) {
+    /* The producer is done once it pushed the last record, which
+       the drain below still sees */
+    running = __atomic_load_n (&ring.head, __ATOMIC_ACQUIRE)
+      < RING_RECORDS;
+    while (sensor_ring_pop (&ring, &rec)) {
+      if (rec.time != expected) {
+	misordered++;
+      }
+      if (rec.rotation != rec.time % 4 + 1
+	  || rec.g[0] != (float) rec.time) {
+	corrupt++;
+      }
+      expected = rec.time + 1;
+      popped++;
+    }
+    if (running) {
+      nanosleep (&pause, NULL);
+    }
+  }
+  pthread_join (thread, NULL);
+
+  CHECK (popped == RING_RECORDS);
+  CHECK (misordered == 0);
+  CHECK (corrupt == 0);
+  CHECK (lost == 0);
+  CHECK (ring.overflows == 0);
+  CHECK (ring.head == RING_RECORDS && ring.tail == RING_RECORDS);
+}
+
+static void
+test_overflow (void)
+{
+  sensor_record rec;
+  unsigned int i;
+
+  memset (&ring, 0, sizeof (ring));
+  memset (&rec, 0, sizeof (rec));
+  for (i = 0; i < SENSOR_RING_SIZE + 3; i++) {
+    rec.time = i;
+    CHECK (sensor_ring_push (&ring, &rec) == (i < SENSOR_RING_SIZE));
+  }
+  CHECK (ring.overflows == 3);
+
+  /* The oldest records are kept, the newest dropped */
+  CHECK (sensor_ring_pop (&ring, &rec) && rec.time == 0);
+  rec.time = SENSOR_RING_SIZE;
+  CHECK (sensor_ring_push (&ring, &rec));
+  for (i = 1; sensor_ring_pop (&ring, &rec); i++) {
+    CHECK (rec.time == i);
+  }
+  CHECK (i == SENSOR_RING_SIZE + 1);
+  CHECK (ring.overflows == 3);
+}
+
+int
+main (void)
+{
+  test_overflow ();
+  test_stress ();
+
+  return check_status ();
+}
+
+/* end of test-ring.c */
@@ -0,0 +1,118 @@
+/*
+ * Original xinput:
+ * Copyright 1996 by Frederic Lepied, France. <Frederic.Lepied@sugix.frmug.org>
+ *
+ * Original xrandr:
+ * Copyright © 2001 Keith Packard, member of The XFree86 Project, Inc.
+ * Copyright © 2002 Hewlett Packard Company, Inc.
+ * Copyright © 2006 Intel Corporation
+ *
+ * xrandr-align:
+ *
+ * Copyright © 2012 Paul Wolneykien <manowar@altlinux.org>, ALT Linux Ltd.
+ *
+ * Permission to use, copy, modify, distribute, and sell this software and its
+ * documentation for any purpose is  hereby granted without fee, provided that
+ * the  above copyright   notice appear  in   all  copies and  that both  that
+ * copyright  notice   and   this  permission   notice  appear  in  supporting
+ * documentation, and that   the  name of  the authors  not  be  used  in
+ * advertising or publicity pertaining to distribution of the software without
+ * specific,  written      prior  permission.     The authors  make  no
+ * representations about the suitability of this software for any purpose.  It
+ * is provided "as is" without express or implied warranty.
+ *
+ * THE AUTHORS DISCLAIM ALL   WARRANTIES WITH REGARD  TO  THIS SOFTWARE,
+ * INCLUDING ALL IMPLIED   WARRANTIES OF MERCHANTABILITY  AND   FITNESS, IN NO
+ * EVENT  SHALL THE AUTHORS  BE   LIABLE   FOR ANY  SPECIAL, INDIRECT   OR
+ * CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM LOSS OF USE,
+ * DATA  OR PROFITS, WHETHER  IN  AN ACTION OF  CONTRACT,  NEGLIGENCE OR OTHER
+ * TORTIOUS  ACTION, ARISING    OUT OF OR   IN  CONNECTION  WITH THE USE    OR
+ * PERFORMANCE OF THIS SOFTWARE.
+ *
+ */
+
+/*
+ * The persistent alignment state: each open file keeps its own
+ * descriptor, and the displays sharing a file keep their entries
+ * apart.
+ */
+
+#include "common.h"
+#include "xrandr-align.h"
+#include "state.h"
+#include "check.h"
+#include <fcntl.h>
+#include <string.h>
+#include <unistd.h>
+
+/* Only the display name is read */
+static Display *
+fake_display (const char *name)
+{
+  _XPrivDisplay dpy = calloc (1, sizeof (*dpy));
+
+  dpy->display_name = (char *) name;
+  return (Display *) dpy;
+}
+
+static void
+test_shared (const char *dir)
+{
+  char path[1024];
+  context ctx1, ctx2;
+  state_file *s1, *s2;
+  state_entry *e;
+  alignment al;
+
+  snprintf (path, sizeof (path), "%s/state", dir);
+  memset (&ctx1, 0, sizeof (ctx1));
+  memset (&ctx2, 0, sizeof (ctx2));
+  ctx1.display = fake_display (":0");
+  ctx2.display = fake_display (":1");
+
+  s1 = state_open (&ctx1, path);
+  s2 = state_open (&ctx2, path);
+  CHECK (s1 && s2);
+  if (!s1 || !s2) {
+    return;
+  }
+
+  memset (&al, 0, sizeof (al));
+  al.crtc = 10;
+  state_store (s1, 0, "LVDS1", "touch", 100, &al);
+  al.crtc = 20;
+  state_store (s2, 0, "LVDS1", "touch", 200, &al);
+
+  /* The same binding on two displays takes two entries */
+  e = state_lookup (s1, 0, "LVDS1", "touch");
+  CHECK (e && e->outputid == 100 && e->crtc == 10);
+  e = state_lookup (s2, 0, "LVDS1", "touch");
+  CHECK (e && e->outputid == 200 && e->crtc == 20);
+
+  /* Each handle closes its own descriptor */
+  state_close (s1);
+  CHECK (fcntl (s2->fd, F_GETFD) != -1);
+  e = state_lookup (s2, 0, "LVDS1", "touch");
+  CHECK (e && e->crtc == 20);
+  state_close (s2);
+
+  free (ctx1.display);
+  free (ctx2.display);
+  unlink (path);
+}
+
+int
+main (void)
+{
+  char dir[] = CHECK_TMPDIR;
+
+  check_tmpdir (dir);
+
+  test_shared (dir);
+
+  rmdir (dir);
+
+  return check_status ();
+}
+
+/* end of test-state.c */
@@ -0,0 +1,216 @@
+/*
+ * Original xinput:
+ * Copyright 1996 by Frederic Lepied, France. <Frederic.Lepied@sugix.frmug.org>
+ *
+ * Original xrandr:
+ * Copyright © 2001 Keith Packard, member of The XFree86 Project, Inc.
+ * Copyright © 2002 Hewlett Packard Company, Inc.
+ * Copyright © 2006 Intel Corporation
+ *
+ * xrandr-align:
+ *
+ * Copyright © 2012 Paul Wolneykien <manowar@altlinux.org>, ALT Linux Ltd.
+ *
+ * Permission to use, copy, modify, distribute, and sell this software and its
+ * documentation for any purpose is  hereby granted without fee, provided that
+ * the  above copyright   notice appear  in   all  copies and  that both  that
+ * copyright  notice   and   this  permission   notice  appear  in  supporting
+ * documentation, and that   the  name of  the authors  not  be  used  in
+ * advertising or publicity pertaining to distribution of the software without
+ * specific,  written      prior  permission.     The authors  make  no
+ * representations about the suitability of this software for any purpose.  It
+ * is provided "as is" without express or implied warranty.
+ *
+ * THE AUTHORS DISCLAIM ALL   WARRANTIES WITH REGARD  TO  THIS SOFTWARE,
+ * INCLUDING ALL IMPLIED   WARRANTIES OF MERCHANTABILITY  AND   FITNESS, IN NO
+ * EVENT  SHALL THE AUTHORS  BE   LIABLE   FOR ANY  SPECIAL, INDIRECT   OR
+ * CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM LOSS OF USE,
+ * DATA  OR PROFITS, WHETHER  IN  AN ACTION OF  CONTRACT,  NEGLIGENCE OR OTHER
+ * TORTIOUS  ACTION, ARISING    OUT OF OR   IN  CONNECTION  WITH THE USE    OR
+ * PERFORMANCE OF THIS SOFTWARE.
+ *
+ */
+
+
+/*
+ * The asynchronous error tracking: no write is forgotten however many
+ * are pending, the failed ones come back by their device and the
+ * errors are counted by connection.
+ */
+
+#include "common.h"
+#include "xrandr-align.h"
+#include "xerror.h"
+#include "check.h"
+#include <string.h>
+
+/* Several times the initial size of the FIFO */
+#define PENDING (8 * XERROR_TRACK_MAX)
+
+static XErrorHandler handler;
+
+/* Only the request serials of the display are read */
+static Display *
+fake_display (void)
+{
+  return calloc (1, sizeof (*(_XPrivDisplay) NULL));
+}
+
+static void
+set_processed (Display *display,
+	       unsigned long serial)
+{
+  ((_XPrivDisplay) display)->last_request_read = serial;
+}
+
+static void
+raise_error (Display *display,
+	     unsigned long serial)
+{
+  XErrorEvent error;
+
+  memset (&error, 0, sizeof (error));
+  error.type = 0;
+  error.display = display;
+  error.serial = serial;
+  error.error_code = BadValue;
+  handler (display, &error);
+}
+
+static void
+test_pending (Display *d1,
+	      Display *d2)
+{
+  XID failed[16];
+  unsigned long s;
+  int n;
+
+  /* Nothing processed yet: the first write outlives the others */
+  for (s = 1; s <= PENDING; s++) {
+    xerror_track (d1, s, 100 + s % 50);
+    xerror_track (d2, s, 200);
+  }
+  raise_error (d1, 1);
+  raise_error (d1, PENDING);
+
+  set_processed (d1, PENDING);
+  n = xerror_failed (d1, failed, 16);
+  CHECK (n == 2);
+  CHECK (n == 2 && failed[0] == 101 && failed[1] == 100 + PENDING % 50);
+  CHECK (xerror_failed (d1, failed, 16) == 0);
+
+  /* The other connection is untouched */
+  raise_error (d2, 7);
+  set_processed (d2, PENDING);
+  n = xerror_failed (d2, failed, 16);
+  CHECK (n == 1 && failed[0] == 200);
+}
+
+static void
+test_retired (Display *d1)
+{
+  XID failed[16];
+  unsigned long s;
+  int n;
+
+  /* A long run of processed writes with a failure early on */
+  for (s = PENDING + 1; s <= 20 * PENDING; s++) {
+    xerror_track (d1, s, 300);
+    if (s == PENDING + 2) {
+      set_processed (d1, s);
+      raise_error (d1, s);
+    } else {
+      set_processed (d1, s - 1);
+    }
+  }
+  set_processed (d1, 20 * PENDING);
+  n = xerror_failed (d1, failed, 16);
+  CHECK (n == 1 && failed[0] == 300);
+}
+
+static void
+test_many_failed (Display *d1)
+{
+  XID failed[16];
+  unsigned long base = 20 * PENDING;
+  unsigned long s;
+  int n;
+
+  /* More failures than asked for are kept for the next call */
+  for (s = base + 1; s <= base + 20; s++) {
+    xerror_track (d1, s, 400 + s - base);
+    raise_error (d1, s);
+  }
+  set_processed (d1, base + 20);
+  n = xerror_failed (d1, failed, 16);
+  CHECK (n == 16 && failed[0] == 401 && failed[15] == 416);
+  n = xerror_failed (d1, failed, 16);
+  CHECK (n == 4 && failed[0] == 417 && failed[3] == 420);
+  CHECK (xerror_failed (d1, failed, 16) == 0);
+}
+
+static void
+test_count (Display *d1,
+	    Display *d2)
+{
+  Display *d3 = fake_display ();
+  XID failed[16];
+
+  /* 2 + 1 + 20 errors above on the first connection, 1 on the other */
+  CHECK (xerror_count (d1) == 23);
+  CHECK (xerror_count (d2) == 1);
+  CHECK (xerror_count (d3) == 0);
+  xerror_track (d3, 1, 500);
+  raise_error (d3, 1);
+  set_processed (d3, 1);
+  CHECK (xerror_failed (d3, failed, 16) == 1);
+  CHECK (xerror_count (d3) == 1);
+  CHECK (xerror_count (d1) == 23);
+  free (d3);
+}
+
+/* The matching for the error handler of a library user: the errors
+   not tracked are left to it */
+static void
+test_match (Display *d1)
+{
+  unsigned long serial = 30 * PENDING;
+  XErrorEvent error;
+  XID failed[16];
+
+  memset (&error, 0, sizeof (error));
+  error.display = d1;
+  error.serial = serial;
+  error.error_code = BadValue;
+  CHECK (xerror_match (d1, &error) == 0);
+
+  xerror_track (d1, serial + 1, 600);
+  error.serial = serial + 1;
+  CHECK (xerror_match (d1, &error) == 1);
+  set_processed (d1, serial + 1);
+  CHECK (xerror_failed (d1, failed, 16) == 1 && failed[0] == 600);
+}
+
+int
+main (void)
+{
+  Display *d1 = fake_display ();
+  Display *d2 = fake_display ();
+
+  /* The installed handler, called as Xlib would */
+  xerror_install ();
+  handler = XSetErrorHandler (NULL);
+
+  test_pending (d1, d2);
+  test_retired (d1);
+  test_many_failed (d1);
+  test_count (d1, d2);
+  test_match (d1);
+
+  free (d1);
+  free (d2);
+
+  return check_status ();
+}
+
+/* end of test-xerror.c */